@@ -73,6 +73,8 @@
  *   - initial version
  */
 
+#include "spmv.h"
+
 #ifdef HAVE_PAPI
 #include "papi_util.h"
 #include <papi.h>
@@ -88,6 +90,26 @@
 #include <zlib.h>
 #endif
 
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#ifdef __AVX512F__
+#include <immintrin.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#ifdef __ARM_FEATURE_SVE
+#include <arm_sve.h>
+#endif
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 #include <float.h>
@@ -121,12 +143,66 @@ typedef int64_t idx_t;
 #define parse_idx_t parse_int64_t
 #endif
 
+#ifndef VALTYPEWIDTH
+#define VALTYPEWIDTH 64
+#endif
+#if VALTYPEWIDTH == 32
+typedef float val_t;
+#elif VALTYPEWIDTH == 64
+typedef double val_t;
+#else
+#error "VALTYPEWIDTH must be 32 or 64"
+#endif
+
+#ifndef VECTYPEWIDTH
+#define VECTYPEWIDTH 64
+#endif
+#if VECTYPEWIDTH == 32
+typedef float vec_t;
+#define VEC_DIG FLT_DIG
+#elif VECTYPEWIDTH == 64
+typedef double vec_t;
+#define VEC_DIG DBL_DIG
+#else
+#error "VECTYPEWIDTH must be 32 or 64"
+#endif
+
+/*
+ * The kernels that use AVX-512 or SVE intrinsics are written for
+ * double precision matrix and vector values.
+ */
+#if defined(__AVX512F__) && VALTYPEWIDTH == 64 && VECTYPEWIDTH == 64
+#define USE_AVX512_KERNELS
+#endif
+#if defined(__ARM_FEATURE_SVE) && VALTYPEWIDTH == 64 && VECTYPEWIDTH == 64
+#define USE_SVE_KERNELS
+#endif
+
 #ifdef USE_A64FX_SECTOR_CACHE
 #ifndef A64FX_SECTOR_CACHE_L2_WAYS
 #define A64FX_SECTOR_CACHE_L2_WAYS 4
 #endif
 #endif
 
+#ifdef SPMV_DRIVER
+/*
+ * When the program is linked into the ‘spmv’ driver, together with
+ * the other benchmark program, its global symbols are renamed.
+ */
+#define main                          ellspmv_main
+#define program_name                  ellspmv_program_name
+#define program_version               ellspmv_program_version
+#define program_copyright             ellspmv_program_copyright
+#define program_license               ellspmv_program_license
+#define program_invocation_name       ellspmv_program_invocation_name
+#define program_invocation_short_name ellspmv_program_invocation_short_name
+#define parse_int                     ellspmv_parse_int
+#define parse_int32_t                 ellspmv_parse_int32_t
+#define parse_int64_t                 ellspmv_parse_int64_t
+#define parse_double                  ellspmv_parse_double
+#define stream_close                  ellspmv_stream_close
+#endif
+
 const char * program_name = "ellspmv";
 const char * program_version = "1.8";
 const char * program_copyright =
@@ -138,21 +214,127 @@ const char * program_license =
 const char * program_invocation_name;
 const char * program_invocation_short_name;
 
+/*
+ * The kernels for multiplying with several vectors at once accumulate
+ * the results for each row in a local buffer, which limits the number
+ * of vectors.
+ */
+#ifndef MAX_NUM_VECTORS
+#define MAX_NUM_VECTORS 64
+#endif
+
+/*
+ * With ‘--compress-colidx’, column offsets are compressed separately
+ * for each block of consecutive rows of the following size.
+ */
+#ifndef COLIDX_BLOCK_SIZE
+#define COLIDX_BLOCK_SIZE 64
+#endif
+
+/*
+ * The rows of a chunk in sliced ELLPACK format are accumulated in a
+ * local buffer, which limits the number of rows per chunk.
+ */
+#ifndef SELL_MAX_CHUNK_SIZE
+#define SELL_MAX_CHUNK_SIZE 256
+#endif
+
+enum format
+{
+    format_ell,
+    format_sell,
+    format_hyb,
+};
+
+enum kernel
+{
+    kernel_auto,
+    kernel_scalar,
+    kernel_avx512,
+    kernel_sve,
+};
+
+enum device
+{
+    device_host,
+    device_gpu,
+};
+
+enum hugepages
+{
+    hugepages_none,
+    hugepages_thp,
+    hugepages_2M,
+    hugepages_1G,
+};
+
+enum reorder
+{
+    reorder_none,
+    reorder_rcm,
+};
+
+enum generator
+{
+    generate_none,
+    generate_5pt,
+    generate_7pt,
+    generate_27pt,
+    generate_banded,
+    generate_rmat,
+};
+
+enum output_format
+{
+    output_none,
+    output_json,
+    output_csv,
+};
+
 /**
  * ‘program_options’ contains data to related program options.
  */
 struct program_options
 {
     char * Apath;
+    int Apath_index;
     char * xpath;
     char * ypath;
 #ifdef HAVE_LIBZ
     int gzip;
 #endif
+    char * load_binary_path;
+    char * save_binary_path;
+    enum format format;
+    int chunk_size;
+    int sigma;
+    idx_t hyb_width;
     bool separate_diagonal;
     bool sort_rows;
+    bool column_major;
+    bool compress_colidx;
+    enum kernel kernel;
+    enum device device;
+    int sw_prefetch_distance;
+    bool nontemporal;
+    bool stream_baseline;
+    bool thread_stats;
+    enum reorder reorder;
+    enum generator generate;
+    int64_t generate_size;
+    int64_t generate_bandwidth;
+    int64_t generate_rowsize;
+    char * generate_spec;
+    int num_vectors;
+    bool numa_first_touch;
+    enum hugepages hugepages;
     int repeat;
     int warmup;
+    int batch_size;
+    enum output_format output;
+    char * result_path;
+    bool autotune;
+    char * tuning_file;
     int verbose;
     int quiet;
 #ifdef HAVE_PAPI
@@ -170,15 +352,44 @@ static int program_options_init(
     struct program_options * args)
 {
     args->Apath = NULL;
+    args->Apath_index = 0;
     args->xpath = NULL;
     args->ypath = NULL;
 #ifdef HAVE_LIBZ
     args->gzip = 0;
 #endif
+    args->load_binary_path = NULL;
+    args->save_binary_path = NULL;
+    args->format = format_ell;
+    args->chunk_size = 8;
+    args->sigma = 1;
+    args->hyb_width = 0;
     args->separate_diagonal = false;
     args->sort_rows = false;
+    args->column_major = false;
+    args->compress_colidx = false;
+    args->kernel = kernel_auto;
+    args->device = device_host;
+    args->sw_prefetch_distance = 0;
+    args->nontemporal = false;
+    args->stream_baseline = false;
+    args->thread_stats = false;
+    args->reorder = reorder_none;
+    args->generate = generate_none;
+    args->generate_size = 0;
+    args->generate_bandwidth = 0;
+    args->generate_rowsize = 0;
+    args->generate_spec = NULL;
+    args->num_vectors = 1;
+    args->numa_first_touch = true;
+    args->hugepages = hugepages_none;
     args->repeat = 1;
     args->warmup = 0;
+    args->batch_size = 0;
+    args->output = output_none;
+    args->autotune = false;
+    args->tuning_file = NULL;
+    args->result_path = NULL;
     args->quiet = 0;
     args->verbose = 0;
 #ifdef HAVE_PAPI
@@ -200,6 +411,11 @@ static void program_options_free(
 #ifdef HAVE_PAPI
     if (args->papi_event_file) free(args->papi_event_file);
 #endif
+    if (args->tuning_file) free(args->tuning_file);
+    if (args->result_path) free(args->result_path);
+    if (args->save_binary_path) free(args->save_binary_path);
+    if (args->generate_spec) free(args->generate_spec);
+    if (args->load_binary_path) free(args->load_binary_path);
     if (args->ypath) free(args->ypath);
     if (args->xpath) free(args->xpath);
     if (args->Apath) free(args->Apath);
@@ -212,6 +428,8 @@ static void program_options_print_usage(
     FILE * f)
 {
     fprintf(f, "Usage: %s [OPTION..] A [x] [y]\n", program_name);
+    fprintf(f, "  or:  %s [OPTION..] --load-binary=FILE [x] [y]\n", program_name);
+    fprintf(f, "  or:  %s [OPTION..] --generate=KIND:N.. [x] [y]\n", program_name);
 }
 
 /**
@@ -236,10 +454,81 @@ static void program_options_print_help(
 #ifdef HAVE_LIBZ
     fprintf(f, "  -z, --gzip, --gunzip, --ungzip    filter files through gzip\n");
 #endif
+    fprintf(f, "  --load-binary=FILE   load the matrix in ELLPACK format from a binary file\n");
+    fprintf(f, "                       instead of reading A from a Matrix Market file\n");
+    fprintf(f, "  --generate=KIND:N..  generate the matrix A instead of reading it: 5pt:N,\n");
+    fprintf(f, "                       7pt:N or 27pt:N for a 2D or 3D stencil on a grid with\n");
+    fprintf(f, "                       N points per dimension, banded:N:B:D for N rows with\n");
+    fprintf(f, "                       D random nonzeros within distance B of the diagonal,\n");
+    fprintf(f, "                       or rmat:S:D for a 2^S-by-2^S R-MAT matrix with D\n");
+    fprintf(f, "                       nonzeros per row on average\n");
+    fprintf(f, "  --save-binary=FILE   save the matrix in ELLPACK format to a binary file\n");
+    fprintf(f, "  --format=FORMAT      matrix storage format: ell, sell or hyb. [ell]\n");
+    fprintf(f, "  --chunk-size=C       number of rows per chunk for sell format. [8]\n");
+    fprintf(f, "  --sigma=S            number of rows in each window of rows that are sorted\n");
+    fprintf(f, "                       by length for sell format. [1]\n");
+    fprintf(f, "  --hyb-width=K        number of nonzeros per row that are stored in ELLPACK\n");
+    fprintf(f, "                       format for hyb format, with the remaining nonzeros\n");
+    fprintf(f, "                       stored in coordinate format. If K is 0, the width\n");
+    fprintf(f, "                       that minimises the size of the matrix is chosen. [0]\n");
     fprintf(f, "  --separate-diagonal  store diagonal nonzeros separately\n");
     fprintf(f, "  --sort-rows          sort nonzeros by column within each row\n");
+    fprintf(f, "  --column-major       store the l-th nonzero of every row contiguously\n");
+    fprintf(f, "                       for ell format, instead of storing each row\n");
+    fprintf(f, "                       contiguously\n");
+    fprintf(f, "  --compress-colidx    store column offsets as 16-bit offsets from a base\n");
+    fprintf(f, "                       column for every block of %d rows, where they fit,\n", COLIDX_BLOCK_SIZE);
+    fprintf(f, "                       for ell and hyb formats\n");
+    fprintf(f, "  --kernel=KERNEL      kernel for ell format: auto, scalar, avx512 or sve.\n");
+    fprintf(f, "                       The auto kernel uses AVX-512 or SVE if enabled at\n");
+    fprintf(f, "                       compile time. [auto]\n");
+    fprintf(f, "  --device=DEVICE      device for ell format: host, or gpu for OpenMP target\n");
+    fprintf(f, "                       offloading, where the matrix and vectors are copied\n");
+    fprintf(f, "                       to the device only once. [host]\n");
+    fprintf(f, "  --sw-prefetch-distance=D\n");
+    fprintf(f, "                       for ell and hyb formats, prefetch the source vector\n");
+    fprintf(f, "                       entries that are needed D nonzeros ahead, and the\n");
+    fprintf(f, "                       column offsets another D nonzeros ahead, or 0 to\n");
+    fprintf(f, "                       disable. [0]\n");
+    fprintf(f, "  --nontemporal        for ell and hyb formats, overwrite y with y = A*x\n");
+    fprintf(f, "                       using non-temporal stores, and load the matrix with\n");
+    fprintf(f, "                       streaming prefetch hints\n");
+    fprintf(f, "  --reorder=ORDERING   reorder rows and columns of a square matrix before\n");
+    fprintf(f, "                       conversion: none or rcm (Reverse Cuthill-McKee).\n");
+    fprintf(f, "                       [none]\n");
+    fprintf(f, "  --num-vectors=K      multiply with K vectors at once, which are read\n");
+    fprintf(f, "                       as the columns of a dense matrix. [1]\n");
+#ifdef _OPENMP
+    fprintf(f, "  --numa-first-touch   initialise matrix and vector pages from the threads that\n");
+    fprintf(f, "                       use them, so that pages are placed on the NUMA nodes of\n");
+    fprintf(f, "                       those threads (default)\n");
+    fprintf(f, "  --no-numa-first-touch\n");
+    fprintf(f, "                       let matrix and vector pages be first touched during\n");
+    fprintf(f, "                       conversion, mostly by a single thread\n");
+#endif
+    fprintf(f, "  --hugepages=TYPE     allocate the matrix and vectors in huge pages: none,\n");
+    fprintf(f, "                       thp (transparent huge pages), or 2M or 1G pages\n");
+    fprintf(f, "                       from hugetlbfs, which fall back to transparent huge\n");
+    fprintf(f, "                       pages if none are available. [none]\n");
     fprintf(f, "  --repeat=N           repeat matrix-vector multiplication N times\n");
     fprintf(f, "  --warmup=N                perform N additional warmup iterations\n");
+    fprintf(f, "  --stream-baseline    measure the host memory bandwidth with STREAM-style\n");
+    fprintf(f, "                       triad and read kernels before the multiplications,\n");
+    fprintf(f, "                       and compare the kernel with it in a roofline model\n");
+    fprintf(f, "  --batch-size=N       time batches of N back-to-back multiplications,\n");
+    fprintf(f, "                       with per-thread timestamps and barrier wait\n");
+    fprintf(f, "  --thread-stats       for ell format, show the rows, entries, columns of x,\n");
+    fprintf(f, "                       kernel time and barrier wait of every thread, and\n");
+    fprintf(f, "                       their imbalance\n");
+    fprintf(f, "  --output=FORMAT      write a benchmark report in json or csv format\n");
+    fprintf(f, "                       instead of the Matrix Market output\n");
+    fprintf(f, "  --result-file=FILE   write the Matrix Market output to FILE instead of\n");
+    fprintf(f, "                       standard output, also with --output\n");
+    fprintf(f, "  --autotune           run with each of a set of candidate options, and\n");
+    fprintf(f, "                       report the fastest\n");
+    fprintf(f, "  --tuning-file=FILE   with --autotune, save the fastest options for the\n");
+    fprintf(f, "                       matrix to FILE, or, otherwise, use the options that\n");
+    fprintf(f, "                       were saved for the matrix in FILE\n");
     fprintf(f, "  -q, --quiet          do not print Matrix Market output\n");
     fprintf(f, "  -v, --verbose        be more verbose\n");
     fprintf(f, "\n");
@@ -451,6 +740,134 @@ int parse_double(
     return 0;
 }
 
+/**
+ * ‘parse_int64_t_fast()’ parses a string to produce a number that may
+ * be represented as a signed, 64-bit integer.
+ *
+ * Unlike ‘parse_int64_t()’, the number is parsed directly rather than
+ * through ‘strtoll()’, which makes it considerably faster and
+ * independent of the current locale.  Leading blanks are skipped, and
+ * parsing stops at the first character that is not a decimal digit.
+ * The parsed number is stored in ‘x’, and the address of the first
+ * character beyond those that were consumed is stored in ‘endptr’.
+ *
+ * On success, ‘0’ is returned. Otherwise, if no digits were found,
+ * ‘EINVAL’ is returned. If the resulting number cannot be represented
+ * as a signed, 64-bit integer, ‘ERANGE’ is returned.
+ */
+static inline int parse_int64_t_fast(
+    int64_t * x,
+    const char * s,
+    const char ** endptr)
+{
+    while (*s == ' ' || *s == '\t') s++;
+    bool negative = *s == '-';
+    if (*s == '-' || *s == '+') s++;
+    const char * t = s;
+    uint64_t y = 0;
+    while (*t >= '0' && *t <= '9') {
+        unsigned int d = *t - '0';
+        if (y > UINT64_MAX/10 || (y == UINT64_MAX/10 && d > UINT64_MAX%10))
+            return ERANGE;
+        y = 10*y + d;
+        t++;
+    }
+    if (s == t) return EINVAL;
+    if (!negative && y > INT64_MAX) return ERANGE;
+    if (negative && y > (uint64_t) INT64_MAX + 1) return ERANGE;
+    *x = negative ? (y == 0 ? 0 : -(int64_t) (y-1) - 1) : (int64_t) y;
+    *endptr = t;
+    return 0;
+}
+
+/**
+ * ‘parse_double_fast()’ parses a string to produce a number that may
+ * be represented as ‘double’.
+ *
+ * Numbers with at most 19 significant digits, whose value is an
+ * integer of at most 2^53 scaled by a power of ten between 10^-22 and
+ * 10^22, are converted exactly (and therefore correctly rounded)
+ * without calling ‘strtod()’ and without consulting the current
+ * locale.  This covers most numbers found in Matrix Market files.
+ * Any other number is handed over to ‘strtod()’, so that the result
+ * is always the same as that of ‘parse_double()’.  Leading blanks are
+ * skipped.  The parsed number is stored in ‘x’, and the address of the
+ * first character beyond those that were consumed is stored in
+ * ‘endptr’.
+ *
+ * On success, ‘0’ is returned. Otherwise, if the input contained
+ * invalid characters, ‘EINVAL’ is returned. If the resulting number
+ * cannot be represented as a double, ‘ERANGE’ is returned.
+ */
+static inline int parse_double_fast(
+    double * x,
+    const char * s,
+    const char ** endptr)
+{
+    static const double pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+    while (*s == ' ' || *s == '\t') s++;
+    const char * t = s;
+    bool negative = *t == '-';
+    if (*t == '-' || *t == '+') t++;
+    uint64_t m = 0;
+    int ndigits = 0, exp10 = 0;
+    bool digits = false;
+    while (*t == '0') { digits = true; t++; }
+    while (*t >= '0' && *t <= '9') {
+        if (ndigits >= 19) goto slow;
+        m = 10*m + (*t - '0'); ndigits++;
+        digits = true; t++;
+    }
+    if (*t == '.') {
+        t++;
+        if (ndigits == 0) {
+            while (*t == '0') { digits = true; exp10--; t++; }
+        }
+        while (*t >= '0' && *t <= '9') {
+            if (ndigits >= 19) goto slow;
+            m = 10*m + (*t - '0'); ndigits++; exp10--;
+            digits = true; t++;
+        }
+    }
+    if (!digits) goto slow;
+    if (*t == 'e' || *t == 'E') {
+        const char * u = t+1;
+        bool expnegative = *u == '-';
+        if (*u == '-' || *u == '+') u++;
+        if (*u >= '0' && *u <= '9') {
+            int e = 0;
+            while (*u >= '0' && *u <= '9') {
+                if (e < 100000) e = 10*e + (*u - '0');
+                u++;
+            }
+            exp10 += expnegative ? -e : e;
+            t = u;
+        }
+    }
+    if (m == 0) {
+        *x = negative ? -0.0 : 0.0;
+        *endptr = t;
+        return 0;
+    }
+    if (m > (UINT64_C(1) << 53) || exp10 < -22 || exp10 > 22) goto slow;
+    double y = exp10 < 0 ? (double) m / pow10[-exp10] : (double) m * pow10[exp10];
+    *x = negative ? -y : y;
+    *endptr = t;
+    return 0;
+
+slow:
+    errno = 0;
+    char * u;
+    *x = strtod(s, &u);
+    if (u == s) return EINVAL;
+    if (errno == ERANGE && (*x == HUGE_VAL || *x == -HUGE_VAL)) return ERANGE;
+    *endptr = u;
+    return 0;
+}
+
 /**
  * ‘parse_program_options()’ parses program options.
  */
@@ -471,6 +888,104 @@ static int parse_program_options(
     /* Parse program options. */
     int num_positional_arguments_consumed = 0;
     while (*nargs < argc) {
+        if (strstr(argv[0], "--load-binary") == argv[0]) {
+            int n = strlen("--load-binary");
+            const char * s = &argv[0][n];
+            if (*s == '=') { s++; }
+            else if (*s == '\0' && argc-*nargs > 1) { (*nargs)++; argv++; s=argv[0]; }
+            else { program_options_free(args); return EINVAL; }
+            free(args->load_binary_path);
+            args->load_binary_path = strdup(s);
+            if (!args->load_binary_path) { program_options_free(args); return errno; }
+            (*nargs)++; argv++; continue;
+        }
+        if (strstr(argv[0], "--generate") == argv[0]) {
+            int n = strlen("--generate");
+            const char * s = &argv[0][n];
+            if (*s == '=') { s++; }
+            else if (*s == '\0' && argc-*nargs > 1) { (*nargs)++; argv++; s=argv[0]; }
+            else { program_options_free(args); return EINVAL; }
+            free(args->generate_spec);
+            args->generate_spec = strdup(s);
+            if (!args->generate_spec) { program_options_free(args); return errno; }
+            if (strncmp(s, "5pt:", 4) == 0) { args->generate = generate_5pt; s += 4; }
+            else if (strncmp(s, "7pt:", 4) == 0) { args->generate = generate_7pt; s += 4; }
+            else if (strncmp(s, "27pt:", 5) == 0) { args->generate = generate_27pt; s += 5; }
+            else if (strncmp(s, "banded:", 7) == 0) { args->generate = generate_banded; s += 7; }
+            else if (strncmp(s, "rmat:", 5) == 0) { args->generate = generate_rmat; s += 5; }
+            else { program_options_free(args); return EINVAL; }
+            err = parse_int64_t(&args->generate_size, s, (char **) &s, NULL);
+            if (err || args->generate_size <= 0) { program_options_free(args); return EINVAL; }
+            if (args->generate == generate_banded) {
+                if (*s != ':') { program_options_free(args); return EINVAL; }
+                s++;
+                err = parse_int64_t(&args->generate_bandwidth, s, (char **) &s, NULL);
+                if (err || args->generate_bandwidth < 0) { program_options_free(args); return EINVAL; }
+            }
+            if (args->generate == generate_banded || args->generate == generate_rmat) {
+                if (*s != ':') { program_options_free(args); return EINVAL; }
+                s++;
+                err = parse_int64_t(&args->generate_rowsize, s, (char **) &s, NULL);
+                if (err || args->generate_rowsize <= 0) { program_options_free(args); return EINVAL; }
+            }
+            if (*s != '\0') { program_options_free(args); return EINVAL; }
+            (*nargs)++; argv++; continue;
+        }
+        if (strstr(argv[0], "--save-binary") == argv[0]) {
+            int n = strlen("--save-binary");
+            const char * s = &argv[0][n];
+            if (*s == '=') { s++; }
+            else if (*s == '\0' && argc-*nargs > 1) { (*nargs)++; argv++; s=argv[0]; }
+            else { program_options_free(args); return EINVAL; }
+            free(args->save_binary_path);
+            args->save_binary_path = strdup(s);
+            if (!args->save_binary_path) { program_options_free(args); return errno; }
+            (*nargs)++; argv++; continue;
+        }
+        if (strstr(argv[0], "--format") == argv[0]) {
+            int n = strlen("--format");
+            const char * s = &argv[0][n];
+            if (*s == '=') { s++; }
+            else if (*s == '\0' && argc-*nargs > 1) { (*nargs)++; argv++; s=argv[0]; }
+            else { program_options_free(args); return EINVAL; }
+            if (strcmp(s, "ell") == 0) args->format = format_ell;
+            else if (strcmp(s, "sell") == 0) args->format = format_sell;
+            else if (strcmp(s, "hyb") == 0) args->format = format_hyb;
+            else { program_options_free(args); return EINVAL; }
+            (*nargs)++; argv++; continue;
+        }
+        if (strstr(argv[0], "--chunk-size") == argv[0]) {
+            int n = strlen("--chunk-size");
+            const char * s = &argv[0][n];
+            if (*s == '=') { s++; }
+            else if (*s == '\0' && argc-*nargs > 1) { (*nargs)++; argv++; s=argv[0]; }
+            else { program_options_free(args); return EINVAL; }
+            err = parse_int(&args->chunk_size, s, (char **) &s, NULL);
+            if (err || *s != '\0' || args->chunk_size <= 0 || args->chunk_size > SELL_MAX_CHUNK_SIZE) {
+                program_options_free(args); return EINVAL;
+            }
+            (*nargs)++; argv++; continue;
+        }
+        if (strstr(argv[0], "--hyb-width") == argv[0]) {
+            int n = strlen("--hyb-width");
+            const char * s = &argv[0][n];
+            if (*s == '=') { s++; }
+            else if (*s == '\0' && argc-*nargs > 1) { (*nargs)++; argv++; s=argv[0]; }
+            else { program_options_free(args); return EINVAL; }
+            err = parse_idx_t(&args->hyb_width, s, (char **) &s, NULL);
+            if (err || *s != '\0' || args->hyb_width < 0) { program_options_free(args); return EINVAL; }
+            (*nargs)++; argv++; continue;
+        }
+        if (strstr(argv[0], "--sigma") == argv[0]) {
+            int n = strlen("--sigma");
+            const char * s = &argv[0][n];
+            if (*s == '=') { s++; }
+            else if (*s == '\0' && argc-*nargs > 1) { (*nargs)++; argv++; s=argv[0]; }
+            else { program_options_free(args); return EINVAL; }
+            err = parse_int(&args->sigma, s, (char **) &s, NULL);
+            if (err || *s != '\0' || args->sigma <= 0) { program_options_free(args); return EINVAL; }
+            (*nargs)++; argv++; continue;
+        }
         if (strcmp(argv[0], "--separate-diagonal") == 0) {
             args->separate_diagonal = true;
             (*nargs)++; argv++; continue;
@@ -479,6 +994,117 @@ static int parse_program_options(
             args->sort_rows = true;
             (*nargs)++; argv++; continue;
         }
+        if (strcmp(argv[0], "--column-major") == 0) {
+            args->column_major = true;
+            (*nargs)++; argv++; continue;
+        }
+        if (strcmp(argv[0], "--compress-colidx") == 0) {
+            args->compress_colidx = true;
+            (*nargs)++; argv++; continue;
+        }
+        if (strstr(argv[0], "--num-vectors") == argv[0]) {
+            int n = strlen("--num-vectors");
+            const char * s = &argv[0][n];
+            if (*s == '=') { s++; }
+            else if (*s == '\0' && argc-*nargs > 1) { (*nargs)++; argv++; s=argv[0]; }
+            else { program_options_free(args); return EINVAL; }
+            err = parse_int(&args->num_vectors, s, (char **) &s, NULL);
+            if (err || *s != '\0' || args->num_vectors <= 0 ||
+                args->num_vectors > MAX_NUM_VECTORS)
+            {
+                program_options_free(args); return EINVAL;
+            }
+            (*nargs)++; argv++; continue;
+        }
+        if (strstr(argv[0], "--kernel") == argv[0]) {
+            int n = strlen("--kernel");
+            const char * s = &argv[0][n];
+            if (*s == '=') { s++; }
+            else if (*s == '\0' && argc-*nargs > 1) { (*nargs)++; argv++; s=argv[0]; }
+            else { program_options_free(args); return EINVAL; }
+            if (strcmp(s, "auto") == 0) args->kernel = kernel_auto;
+            else if (strcmp(s, "scalar") == 0) args->kernel = kernel_scalar;
+#ifdef USE_AVX512_KERNELS
+            else if (strcmp(s, "avx512") == 0) args->kernel = kernel_avx512;
+#else
+            else if (strcmp(s, "avx512") == 0) { program_options_free(args); return ENOTSUP; }
+#endif
+#ifdef USE_SVE_KERNELS
+            else if (strcmp(s, "sve") == 0) args->kernel = kernel_sve;
+#else
+            else if (strcmp(s, "sve") == 0) { program_options_free(args); return ENOTSUP; }
+#endif
+            else { program_options_free(args); return EINVAL; }
+            (*nargs)++; argv++; continue;
+        }
+        if (strstr(argv[0], "--device") == argv[0]) {
+            int n = strlen("--device");
+            const char * s = &argv[0][n];
+            if (*s == '=') { s++; }
+            else if (*s == '\0' && argc-*nargs > 1) { (*nargs)++; argv++; s=argv[0]; }
+            else { program_options_free(args); return EINVAL; }
+            if (strcmp(s, "host") == 0) args->device = device_host;
+#ifdef _OPENMP
+            else if (strcmp(s, "gpu") == 0) args->device = device_gpu;
+#else
+            else if (strcmp(s, "gpu") == 0) { program_options_free(args); return ENOTSUP; }
+#endif
+            else { program_options_free(args); return EINVAL; }
+            (*nargs)++; argv++; continue;
+        }
+        if (strstr(argv[0], "--sw-prefetch-distance") == argv[0]) {
+            int n = strlen("--sw-prefetch-distance");
+            const char * s = &argv[0][n];
+            if (*s == '=') { s++; }
+            else if (*s == '\0' && argc-*nargs > 1) { (*nargs)++; argv++; s=argv[0]; }
+            else { program_options_free(args); return EINVAL; }
+            err = parse_int(&args->sw_prefetch_distance, s, (char **) &s, NULL);
+            if (err || *s != '\0' || args->sw_prefetch_distance < 0) { program_options_free(args); return EINVAL; }
+            (*nargs)++; argv++; continue;
+        }
+        if (strcmp(argv[0], "--nontemporal") == 0) {
+            args->nontemporal = true;
+            (*nargs)++; argv++; continue;
+        }
+        if (strcmp(argv[0], "--stream-baseline") == 0) {
+            args->stream_baseline = true;
+            (*nargs)++; argv++; continue;
+        }
+        if (strstr(argv[0], "--reorder") == argv[0]) {
+            int n = strlen("--reorder");
+            const char * s = &argv[0][n];
+            if (*s == '=') { s++; }
+            else if (*s == '\0' && argc-*nargs > 1) { (*nargs)++; argv++; s=argv[0]; }
+            else { program_options_free(args); return EINVAL; }
+            if (strcmp(s, "none") == 0) args->reorder = reorder_none;
+            else if (strcmp(s, "rcm") == 0) args->reorder = reorder_rcm;
+            else { program_options_free(args); return EINVAL; }
+            (*nargs)++; argv++; continue;
+        }
+#ifdef _OPENMP
+        if (strcmp(argv[0], "--numa-first-touch") == 0) {
+            args->numa_first_touch = true;
+            (*nargs)++; argv++; continue;
+        }
+        if (strcmp(argv[0], "--no-numa-first-touch") == 0) {
+            args->numa_first_touch = false;
+            (*nargs)++; argv++; continue;
+        }
+#endif
+
+        if (strstr(argv[0], "--hugepages") == argv[0]) {
+            int n = strlen("--hugepages");
+            const char * s = &argv[0][n];
+            if (*s == '=') { s++; }
+            else if (*s == '\0' && argc-*nargs > 1) { (*nargs)++; argv++; s=argv[0]; }
+            else { program_options_free(args); return EINVAL; }
+            if (strcmp(s, "none") == 0) args->hugepages = hugepages_none;
+            else if (strcmp(s, "thp") == 0) args->hugepages = hugepages_thp;
+            else if (strcmp(s, "2M") == 0) args->hugepages = hugepages_2M;
+            else if (strcmp(s, "1G") == 0) args->hugepages = hugepages_1G;
+            else { program_options_free(args); return EINVAL; }
+            (*nargs)++; argv++; continue;
+        }
 
         if (strcmp(argv[0], "--repeat") == 0) {
             if (argc - *nargs < 2) { program_options_free(args); return EINVAL; }
@@ -502,6 +1128,57 @@ static int parse_program_options(
             if (err || *s != '\0') { program_options_free(args); return EINVAL; }
             (*nargs)++; argv++; continue;
         }
+        if (strstr(argv[0], "--batch-size") == argv[0]) {
+            int n = strlen("--batch-size");
+            const char * s = &argv[0][n];
+            if (*s == '=') { s++; }
+            else if (*s == '\0' && argc-*nargs > 1) { (*nargs)++; argv++; s=argv[0]; }
+            else { program_options_free(args); return EINVAL; }
+            err = parse_int(&args->batch_size, s, (char **) &s, NULL);
+            if (err || *s != '\0' || args->batch_size <= 0) { program_options_free(args); return EINVAL; }
+            (*nargs)++; argv++; continue;
+        }
+        if (strcmp(argv[0], "--thread-stats") == 0) {
+            args->thread_stats = true;
+            (*nargs)++; argv++; continue;
+        }
+        if (strstr(argv[0], "--output") == argv[0]) {
+            int n = strlen("--output");
+            const char * s = &argv[0][n];
+            if (*s == '=') { s++; }
+            else if (*s == '\0' && argc-*nargs > 1) { (*nargs)++; argv++; s=argv[0]; }
+            else { program_options_free(args); return EINVAL; }
+            if (strcmp(s, "json") == 0) args->output = output_json;
+            else if (strcmp(s, "csv") == 0) args->output = output_csv;
+            else { program_options_free(args); return EINVAL; }
+            (*nargs)++; argv++; continue;
+        }
+        if (strstr(argv[0], "--result-file") == argv[0]) {
+            int n = strlen("--result-file");
+            const char * s = &argv[0][n];
+            if (*s == '=') { s++; }
+            else if (*s == '\0' && argc-*nargs > 1) { (*nargs)++; argv++; s=argv[0]; }
+            else { program_options_free(args); return EINVAL; }
+            if (args->result_path) free(args->result_path);
+            args->result_path = strdup(s);
+            if (!args->result_path) { program_options_free(args); return errno; }
+            (*nargs)++; argv++; continue;
+        }
+        if (strcmp(argv[0], "--autotune") == 0) {
+            args->autotune = true;
+            (*nargs)++; argv++; continue;
+        }
+        if (strstr(argv[0], "--tuning-file") == argv[0]) {
+            int n = strlen("--tuning-file");
+            const char * s = &argv[0][n];
+            if (*s == '=') { s++; }
+            else if (*s == '\0' && argc-*nargs > 1) { (*nargs)++; argv++; s=argv[0]; }
+            else { program_options_free(args); return EINVAL; }
+            if (args->tuning_file) free(args->tuning_file);
+            args->tuning_file = strdup(s);
+            if (!args->tuning_file) { program_options_free(args); return errno; }
+            (*nargs)++; argv++; continue;
+        }
 
 #ifdef HAVE_LIBZ
         if (strcmp(argv[0], "-z") == 0 ||
@@ -583,6 +1260,7 @@ static int parse_program_options(
         if (num_positional_arguments_consumed == 0) {
             args->Apath = strdup(argv[0]);
             if (!args->Apath) { program_options_free(args); return errno; }
+            args->Apath_index = *nargs;
         } else if (num_positional_arguments_consumed == 1) {
             args->xpath = strdup(argv[0]);
             if (!args->xpath) { program_options_free(args); return errno; }
@@ -594,7 +1272,22 @@ static int parse_program_options(
         (*nargs)++; argv++;
     }
 
-    if (num_positional_arguments_consumed < 1) {
+    /*
+     * If the matrix is loaded from a binary file or generated, then
+     * there is no positional argument for the matrix, and the
+     * positional arguments are instead the vectors x and y.
+     */
+    if (args->load_binary_path || args->generate != generate_none) {
+        if (num_positional_arguments_consumed > 2) {
+            program_options_free(args);
+            program_options_print_usage(stdout);
+            exit(EXIT_FAILURE);
+        }
+        args->ypath = args->xpath;
+        args->xpath = args->Apath;
+        args->Apath = NULL;
+        args->Apath_index = 0;
+    } else if (num_positional_arguments_consumed < 1) {
         program_options_free(args);
         program_options_print_usage(stdout);
         exit(EXIT_FAILURE);
@@ -614,600 +1307,4702 @@ static double timespec_duration(
         (t1.tv_nsec - t0.tv_nsec) * 1e-9;
 }
 
-enum streamtype
+/**
+ * ‘read_timestamp_counter()’ reads a per-core counter that increases
+ * at a constant rate, which is cheaper to read than ‘clock_gettime()’.
+ *
+ * The time stamp counter is used on x86, and the virtual counter
+ * ‘cntvct_el0’ on AArch64. Otherwise, the monotonic clock is read in
+ * nanoseconds. The rate of the counter is not known in advance, and
+ * must be found by comparing with ‘clock_gettime()’.
+ */
+static inline uint64_t read_timestamp_counter(void)
 {
-    stream_stdio,
-#ifdef HAVE_LIBZ
-    stream_zlib,
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t t;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r" (t));
+    return t;
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * UINT64_C(1000000000) + t.tv_nsec;
 #endif
-};
+}
 
-union stream
+static int double_compare(
+    const void * pa,
+    const void * pb)
 {
-    FILE * f;
-#ifdef HAVE_LIBZ
-    gzFile gzf;
-#endif
-};
+    double a = *(const double *) pa;
+    double b = *(const double *) pb;
+    return (a > b) - (a < b);
+}
 
-void stream_close(
-    enum streamtype streamtype,
-    union stream s)
+/**
+ * ‘fprint_batch_timing()’ prints a summary of the time spent in
+ * batches of ‘batch_size’ back-to-back matrix-vector multiplications,
+ * where the final batch may be smaller, so that there are
+ * ‘num_repeats’ multiplications in total.
+ *
+ * The duration of the ‘b’-th batch is ‘batchticks[b]’, whereas
+ * ‘workticks[p*num_batches+b]’ and ‘waitticks[p*num_batches+b]’ are
+ * the time that the ‘p’-th thread spent in the kernel and waiting at
+ * the subsequent barrier, respectively, during the ‘b’-th batch. All
+ * times are given in ticks of ‘read_timestamp_counter()’, which are
+ * converted to seconds with ‘ticks_per_second’. The minimum, median
+ * and maximum time per multiplication over all batches are shown,
+ * and, for every thread, the same for the time spent in the kernel,
+ * together with the average barrier wait per multiplication.
+ */
+static int fprint_batch_timing(
+    FILE * f,
+    const char * kernelname,
+    int num_threads,
+    int num_batches,
+    int batch_size,
+    int num_repeats,
+    const uint64_t * batchticks,
+    const uint64_t * workticks,
+    const uint64_t * waitticks,
+    double ticks_per_second)
 {
-    if (streamtype == stream_stdio) {
-        fclose(s.f);
-#ifdef HAVE_LIBZ
-    } else if (streamtype == stream_zlib) {
-        gzclose(s.gzf);
-#endif
+    if (num_batches <= 0) return 0;
+    double * t = malloc(num_batches * sizeof(double));
+    if (!t) return errno;
+    for (int b = 0; b < num_batches; b++) {
+        int n = num_repeats - b*batch_size < batch_size ? num_repeats - b*batch_size : batch_size;
+        t[b] = batchticks[b] / ticks_per_second / n;
+    }
+    qsort(t, num_batches, sizeof(double), double_compare);
+    fprintf(f, "%s: %'d batches of %'d multiplications, "
+            "%'.9f/%'.9f/%'.9f seconds per multiplication (min/median/max)\n",
+            kernelname, num_batches, batch_size,
+            t[0], t[num_batches/2], t[num_batches-1]);
+    for (int p = 0; p < num_threads; p++) {
+        uint64_t work = 0, wait = 0;
+        for (int b = 0; b < num_batches; b++) {
+            int n = num_repeats - b*batch_size < batch_size ? num_repeats - b*batch_size : batch_size;
+            t[b] = workticks[p*num_batches+b] / ticks_per_second / n;
+            work += workticks[p*num_batches+b];
+            wait += waitticks[p*num_batches+b];
+        }
+        qsort(t, num_batches, sizeof(double), double_compare);
+        fprintf(f, "%s: thread %d: %'.9f/%'.9f/%'.9f seconds per multiplication (min/median/max), "
+                "%'.9f seconds barrier wait per multiplication (%'.1f%%)\n",
+                kernelname, p, t[0], t[num_batches/2], t[num_batches-1],
+                wait / ticks_per_second / num_repeats,
+                work+wait > 0 ? 100.0 * wait / (work+wait) : 0.0);
     }
+    free(t);
+    return 0;
 }
 
 /**
- * ‘freadline()’ reads a single line from a stream.
+ * ‘fprint_thread_stats()’ prints, for every thread, the number of
+ * rows, nonzeros and distinct columns of the source vector that are
+ * assigned to it, together with the average time per multiplication
+ * that it spent in the kernel and waiting at the subsequent barrier,
+ * which are given in the same way as for ‘fprint_batch_timing()’.
+ * The imbalance is shown as the ratio of the maximum to the mean
+ * over all threads, and the average kernel time of every thread is
+ * stored in ‘seconds’.
  */
-static int freadline(
-    char * linebuf,
-    size_t line_max,
-    enum streamtype streamtype,
-    union stream stream)
+static int fprint_thread_stats(
+    FILE * f,
+    const char * kernelname,
+    int num_threads,
+    int num_batches,
+    int num_repeats,
+    const idx_t * rows,
+    const int64_t * nonzeros,
+    const idx_t * columns,
+    const uint64_t * workticks,
+    const uint64_t * waitticks,
+    double ticks_per_second,
+    double * seconds)
 {
-    if (streamtype == stream_stdio) {
-        char * s = fgets(linebuf, line_max+1, stream.f);
-        if (!s && feof(stream.f)) return -1;
-        else if (!s) return errno;
-        int n = strlen(s);
-        if (n > 0 && n == line_max && s[n-1] != '\n') return EOVERFLOW;
-        return 0;
-#ifdef HAVE_LIBZ
-    } else if (streamtype == stream_zlib) {
-        char * s = gzgets(stream.gzf, linebuf, line_max+1);
-        if (!s && gzeof(stream.gzf)) return -1;
-        else if (!s) return errno;
-        int n = strlen(s);
-        if (n > 0 && n == line_max && s[n-1] != '\n') return EOVERFLOW;
-        return 0;
-#endif
-    } else { return EINVAL; }
+    if (num_threads <= 0 || num_repeats <= 0) return 0;
+    double sumrows = 0, sumnonzeros = 0, sumcolumns = 0, sumseconds = 0, sumwait = 0;
+    double maxrows = 0, maxnonzeros = 0, maxcolumns = 0, maxseconds = 0;
+    for (int p = 0; p < num_threads; p++) {
+        uint64_t work = 0, wait = 0;
+        for (int b = 0; b < num_batches; b++) {
+            work += workticks[p*num_batches+b];
+            wait += waitticks[p*num_batches+b];
+        }
+        seconds[p] = work / ticks_per_second / num_repeats;
+        double waitseconds = wait / ticks_per_second / num_repeats;
+        fprintf(f, "thread-stats: %s: thread %d: %'"PRIdx" rows, %'"PRId64" nonzeros, "
+                "%'"PRIdx" columns of x, %'.9f seconds in kernel and %'.9f seconds "
+                "barrier wait per multiplication, %'.3f Gnz/s\n",
+                kernelname, p, rows[p], nonzeros[p], columns[p], seconds[p], waitseconds,
+                seconds[p] > 0 ? (double) nonzeros[p] * 1e-9 / seconds[p] : 0.0);
+        sumrows += rows[p]; sumnonzeros += nonzeros[p]; sumcolumns += columns[p];
+        sumseconds += seconds[p]; sumwait += waitseconds;
+        if (maxrows < rows[p]) maxrows = rows[p];
+        if (maxnonzeros < nonzeros[p]) maxnonzeros = nonzeros[p];
+        if (maxcolumns < columns[p]) maxcolumns = columns[p];
+        if (maxseconds < seconds[p]) maxseconds = seconds[p];
+    }
+    fprintf(f, "thread-stats: %s: imbalance (max/mean): %'.3f rows, %'.3f nonzeros, "
+            "%'.3f columns of x, %'.3f kernel time, with %'.1f%% of the time spent "
+            "waiting at barriers\n", kernelname,
+            sumrows > 0 ? maxrows * num_threads / sumrows : 1.0,
+            sumnonzeros > 0 ? maxnonzeros * num_threads / sumnonzeros : 1.0,
+            sumcolumns > 0 ? maxcolumns * num_threads / sumcolumns : 1.0,
+            sumseconds > 0 ? maxseconds * num_threads / sumseconds : 1.0,
+            sumseconds+sumwait > 0 ? 100.0 * sumwait / (sumseconds+sumwait) : 0.0);
+    return 0;
 }
 
-enum mtxobject
+/**
+ * ‘ell_thread_partition()’ finds the rows of a matrix in ELLPACK
+ * format that are assigned to each thread, in the same way as the
+ * static schedule of the GNU OpenMP runtime, and counts the stored
+ * entries, including padding, and the distinct columns of the source
+ * vector that each thread accesses.
+ */
+static int ell_thread_partition(
+    int num_threads,
+    idx_t num_rows,
+    idx_t num_columns,
+    idx_t rowsize,
+    const idx_t * colidx,
+    bool column_major,
+    bool diagonal,
+    idx_t * rows,
+    int64_t * nonzeros,
+    idx_t * columns)
 {
-    mtxmatrix,
-    mtxvector,
-};
+    int * mark = malloc(num_columns * sizeof(int));
+    if (!mark) return errno;
+    for (idx_t j = 0; j < num_columns; j++) mark[j] = -1;
+    for (int p = 0; p < num_threads; p++) {
+        idx_t q = num_rows / num_threads, r = num_rows % num_threads;
+        idx_t startrow = p*q + (p < r ? p : r);
+        idx_t endrow = startrow + q + (p < r ? 1 : 0);
+        rows[p] = endrow-startrow;
+        nonzeros[p] = (int64_t) rows[p]*rowsize + (diagonal ? rows[p] : 0);
+        columns[p] = 0;
+        for (idx_t i = startrow; i < endrow; i++) {
+            for (idx_t l = 0; l < rowsize; l++) {
+                idx_t j = column_major
+                    ? colidx[(int64_t) l*num_rows+i] : colidx[(int64_t) i*rowsize+l];
+                if (mark[j] != p) { mark[j] = p; columns[p]++; }
+            }
+            if (diagonal && i < num_columns && mark[i] != p) { mark[i] = p; columns[p]++; }
+        }
+    }
+    free(mark);
+    return 0;
+}
 
-enum mtxformat
+/*
+ * machine-readable benchmark reports
+ */
+
+/**
+ * ‘sample_statistics’ summarises a sample of measurements, including
+ * a 95% confidence interval for the mean, based on Student's
+ * t-distribution. With fewer than two measurements, the standard
+ * deviation and the confidence interval are unknown, and are set to
+ * NaN.
+ */
+struct sample_statistics
 {
-    mtxarray,
-    mtxcoordinate,
+    double min;
+    double median;
+    double mean;
+    double stddev;
+    double ci95low;
+    double ci95high;
 };
 
-enum mtxfield
+static int sample_statistics(
+    int n,
+    const double * x,
+    struct sample_statistics * stats)
 {
-    mtxreal,
-    mtxinteger,
-    mtxpattern,
+    /* two-sided 95% quantiles of Student's t-distribution */
+    static const double t95[] = {
+        0.0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+        2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093,
+        2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045,
+        2.042 };
+
+    if (n <= 0) return EINVAL;
+    double * y = malloc(n * sizeof(double));
+    if (!y) return errno;
+    for (int i = 0; i < n; i++) y[i] = x[i];
+    qsort(y, n, sizeof(double), double_compare);
+    double sum = 0;
+    for (int i = 0; i < n; i++) sum += y[i];
+    double mean = sum / n;
+    double ss = 0;
+    for (int i = 0; i < n; i++) ss += (y[i]-mean)*(y[i]-mean);
+    double stddev = n > 1 ? sqrt(ss / (n-1)) : NAN;
+    double t = n-1 < (int) (sizeof(t95)/sizeof(*t95)) ? t95[n-1] : 1.960;
+    stats->min = y[0];
+    stats->median = n % 2 ? y[n/2] : 0.5*(y[n/2-1]+y[n/2]);
+    stats->mean = mean;
+    stats->stddev = stddev;
+    stats->ci95low = mean - t*stddev/sqrt(n);
+    stats->ci95high = mean + t*stddev/sqrt(n);
+    free(y);
+    return 0;
+}
+
+/**
+ * ‘benchmark_report’ contains the data that is written with
+ * ‘--output=json’ or ‘--output=csv’.
+ *
+ * The matrix stores ‘matrix_size’ entries, including any explicit
+ * zeros that are used for padding. For ELLPACK formats, ‘rowsize’ is
+ * the number of entries stored for every row, and otherwise zero.
+ * The number of nonzeros in the shortest and longest row are given
+ * by ‘rowsizemin’ and ‘rowsizemax’, or are negative if unknown. There are ‘num_timings’ measured
+ * durations in ‘seconds’, each of which is the average time for one
+ * multiplication, either for a single repetition, or, if
+ * ‘batch_size’ is positive, for a batch of repetitions. With
+ * ‘--device=gpu’, the time to copy the matrix and vectors to the
+ * device, and the result back, is not included in these durations,
+ * but given by ‘to_device_seconds’ and ‘from_device_seconds’. With
+ * ‘--stream-baseline’, the bandwidths that were measured by
+ * ‘stream_benchmark()’ are also given, and are otherwise zero. If
+ * ‘papi_regions’ is true, the events and derived metrics of the PAPI
+ * regions are also written.
+ */
+struct benchmark_report
+{
+    const char * program;
+    const char * matrix;
+    const char * kernel;
+    idx_t num_rows;
+    idx_t num_columns;
+    int64_t num_nonzeros;
+    int64_t matrix_size;
+    int64_t rowsize;
+    int64_t rowsizemin;
+    int64_t rowsizemax;
+    int64_t padding;
+    int num_vectors;
+    int num_threads;
+    int batch_size;
+    int num_timings;
+    const double * seconds;
+    int64_t num_flops;
+    int64_t min_bytes;
+    int64_t max_bytes;
+    const char * device;
+    double to_device_seconds;
+    double from_device_seconds;
+    double stream_triad_gbytes_per_second;
+    double stream_read_gbytes_per_second;
+    bool papi_regions;
 };
 
-enum mtxsymmetry
+static void fputs_json(
+    const char * s,
+    FILE * f)
 {
-    mtxgeneral,
-    mtxsymmetric,
+    if (!s) { fputs("null", f); return; }
+    fputc('"', f);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') fprintf(f, "\\%c", *s);
+        else if ((unsigned char) *s < 0x20) fprintf(f, "\\u%04x", (unsigned char) *s);
+        else fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+static void fprint_json_int64(
+    FILE * f,
+    int64_t x)
+{
+    if (x < 0) fputs("null", f);
+    else fprintf(f, "%"PRId64, x);
+}
+
+static void fprint_json_double(
+    FILE * f,
+    double x)
+{
+    if (isnan(x)) fputs("null", f);
+    else fprintf(f, "%.9g", x);
+}
+
+static void fputs_csv(
+    const char * s,
+    FILE * f)
+{
+    if (!s) return;
+    fputc('"', f);
+    for (; *s; s++) {
+        if (*s == '"') fputc('"', f);
+        fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+/**
+ * ‘fprint_benchmark_report()’ writes matrix metadata, the build
+ * configuration and the measured time for every repetition, together
+ * with summary statistics of the time, Gnz/s, Gflop/s and the lower
+ * and upper estimates of the bandwidth, in JSON or CSV format.
+ *
+ * In CSV format, there is a single table with a header line, where
+ * every line repeats the metadata, followed by one line for each
+ * measurement, numbered from 0, and one line for each statistic,
+ * named in place of the number. Unknown statistics are written as
+ * ‘null’ in JSON format, and as empty fields in CSV format.
+ *
+ * Several reports are combined into one by writing them in turn,
+ * with ‘report_index’ going from 0 to ‘num_reports-1’. In JSON
+ * format, the reports become the elements of an array, and in CSV
+ * format, the header line is only written for the first report,
+ * unless the reports contain PAPI regions, which may differ.
+ */
+static int fprint_benchmark_report(
+    FILE * f,
+    enum output_format format,
+    const struct benchmark_report * report,
+    int report_index,
+    int num_reports)
+{
+    int n = report->num_timings;
+    if (n <= 0) return EINVAL;
+    double * rates = malloc(5 * n * sizeof(double));
+    if (!rates) return errno;
+    static const char * names[] = {
+        "seconds", "gnz_per_second", "gflops_per_second",
+        "min_gbytes_per_second", "max_gbytes_per_second" };
+    for (int i = 0; i < n; i++) {
+        double t = report->seconds[i];
+        rates[0*n+i] = t;
+        rates[1*n+i] = (double) report->num_nonzeros * report->num_vectors * 1e-9 / t;
+        rates[2*n+i] = (double) report->num_flops * 1e-9 / t;
+        rates[3*n+i] = (double) report->min_bytes * 1e-9 / t;
+        rates[4*n+i] = (double) report->max_bytes * 1e-9 / t;
+    }
+    struct sample_statistics stats[5];
+    for (int j = 0; j < 5; j++) {
+        int err = sample_statistics(n, &rates[j*n], &stats[j]);
+        if (err) { free(rates); return err; }
+    }
+
+    const char * proc_bind = getenv("OMP_PROC_BIND");
+    const char * places = getenv("OMP_PLACES");
+#ifdef _OPENMP
+    bool openmp = true;
+#else
+    bool openmp = false;
+#endif
+
+    if (format == output_json) {
+        if (num_reports > 1 && report_index == 0) fprintf(f, "[\n");
+        fprintf(f, "{\n");
+        fprintf(f, "  \"program\": "); fputs_json(report->program, f); fprintf(f, ",\n");
+        fprintf(f, "  \"matrix\": {\n");
+        fprintf(f, "    \"path\": "); fputs_json(report->matrix, f); fprintf(f, ",\n");
+        fprintf(f, "    \"num_rows\": %"PRIdx",\n", report->num_rows);
+        fprintf(f, "    \"num_columns\": %"PRIdx",\n", report->num_columns);
+        fprintf(f, "    \"num_nonzeros\": %"PRId64",\n", report->num_nonzeros);
+        fprintf(f, "    \"size\": %"PRId64",\n", report->matrix_size);
+        fprintf(f, "    \"rowsize\": %"PRId64",\n", report->rowsize);
+        fprintf(f, "    \"rowsizemin\": "); fprint_json_int64(f, report->rowsizemin); fprintf(f, ",\n");
+        fprintf(f, "    \"rowsizemax\": "); fprint_json_int64(f, report->rowsizemax); fprintf(f, ",\n");
+        fprintf(f, "    \"padding\": %"PRId64"\n", report->padding);
+        fprintf(f, "  },\n");
+        fprintf(f, "  \"build\": {\n");
+        fprintf(f, "    \"idxtypewidth\": %d,\n", (int) (CHAR_BIT*sizeof(idx_t)));
+        fprintf(f, "    \"valtypewidth\": %d,\n", VALTYPEWIDTH);
+        fprintf(f, "    \"vectypewidth\": %d,\n", VECTYPEWIDTH);
+        fprintf(f, "    \"openmp\": %s,\n", openmp ? "true" : "false");
+        fprintf(f, "    \"num_threads\": %d,\n", report->num_threads);
+        fprintf(f, "    \"omp_proc_bind\": "); fputs_json(proc_bind, f); fprintf(f, ",\n");
+        fprintf(f, "    \"omp_places\": "); fputs_json(places, f); fprintf(f, "\n");
+        fprintf(f, "  },\n");
+        fprintf(f, "  \"kernel\": "); fputs_json(report->kernel, f); fprintf(f, ",\n");
+        fprintf(f, "  \"device\": "); fputs_json(report->device, f); fprintf(f, ",\n");
+        fprintf(f, "  \"to_device_seconds\": %.9g,\n", report->to_device_seconds);
+        fprintf(f, "  \"from_device_seconds\": %.9g,\n", report->from_device_seconds);
+        fprintf(f, "  \"stream_triad_gbytes_per_second\": ");
+        if (report->stream_triad_gbytes_per_second > 0)
+            fprintf(f, "%.9g,\n", report->stream_triad_gbytes_per_second);
+        else fprintf(f, "null,\n");
+        fprintf(f, "  \"stream_read_gbytes_per_second\": ");
+        if (report->stream_read_gbytes_per_second > 0)
+            fprintf(f, "%.9g,\n", report->stream_read_gbytes_per_second);
+        else fprintf(f, "null,\n");
+        fprintf(f, "  \"num_vectors\": %d,\n", report->num_vectors);
+        fprintf(f, "  \"batch_size\": %d,\n", report->batch_size);
+        fprintf(f, "  \"num_flops\": %"PRId64",\n", report->num_flops);
+        fprintf(f, "  \"min_bytes\": %"PRId64",\n", report->min_bytes);
+        fprintf(f, "  \"max_bytes\": %"PRId64",\n", report->max_bytes);
+        fprintf(f, "  \"seconds\": [");
+        for (int i = 0; i < n; i++) fprintf(f, "%s%.9g", i > 0 ? ", " : "", report->seconds[i]);
+        fprintf(f, "],\n");
+        fprintf(f, "  \"statistics\": {\n");
+        for (int j = 0; j < 5; j++) {
+            fprintf(f, "    \"%s\": {\"min\": %.9g, \"median\": %.9g, \"mean\": %.9g, \"stddev\": ",
+                    names[j], stats[j].min, stats[j].median, stats[j].mean);
+            fprint_json_double(f, stats[j].stddev);
+            if (isnan(stats[j].ci95low)) fprintf(f, ", \"ci95\": null");
+            else fprintf(f, ", \"ci95\": [%.9g, %.9g]", stats[j].ci95low, stats[j].ci95high);
+            fprintf(f, "}%s\n", j < 4 ? "," : "");
+        }
+        fprintf(f, "  }");
+#ifdef HAVE_PAPI
+        if (report->papi_regions) {
+            fprintf(f, ",\n  \"papi_regions\": ");
+            PAPI_UTIL_fprint_regions_json(f, "  ");
+        }
+#endif
+        fprintf(f, "\n");
+        fprintf(f, "}%s\n", report_index < num_reports-1 ? "," : "");
+        if (num_reports > 1 && report_index == num_reports-1) fprintf(f, "]\n");
+    } else if (format == output_csv) {
+        if (report_index == 0 || report->papi_regions) {
+            fprintf(f, "program,matrix,num_rows,num_columns,num_nonzeros,size,rowsize,rowsizemin,rowsizemax,padding,"
+                    "idxtypewidth,valtypewidth,vectypewidth,openmp,num_threads,omp_proc_bind,omp_places,"
+                    "kernel,num_vectors,batch_size,iteration");
+            for (int j = 0; j < 5; j++) fprintf(f, ",%s", names[j]);
+#ifdef HAVE_PAPI
+            if (report->papi_regions) PAPI_UTIL_fprint_regions_csv_header(f);
+#endif
+            fprintf(f, "\n");
+        }
+        static const char * statnames[] = {
+            "min", "median", "mean", "stddev", "ci95low", "ci95high" };
+        for (int i = 0; i < n+6; i++) {
+            fputs_csv(report->program, f); fputc(',', f);
+            fputs_csv(report->matrix, f);
+            fprintf(f, ",%"PRIdx",%"PRIdx",%"PRId64",%"PRId64",%"PRId64",",
+                    report->num_rows, report->num_columns, report->num_nonzeros,
+                    report->matrix_size, report->rowsize);
+            if (report->rowsizemin >= 0) fprintf(f, "%"PRId64, report->rowsizemin);
+            fputc(',', f);
+            if (report->rowsizemax >= 0) fprintf(f, "%"PRId64, report->rowsizemax);
+            fprintf(f, ",%"PRId64, report->padding);
+            fprintf(f, ",%d,%d,%d,%d,%d,", (int) (CHAR_BIT*sizeof(idx_t)),
+                    VALTYPEWIDTH, VECTYPEWIDTH, openmp ? 1 : 0, report->num_threads);
+            fputs_csv(proc_bind, f); fputc(',', f);
+            fputs_csv(places, f); fputc(',', f);
+            fputs_csv(report->kernel, f);
+            fprintf(f, ",%d,%d", report->num_vectors, report->batch_size);
+            if (i < n) {
+                fprintf(f, ",%d", i);
+                for (int j = 0; j < 5; j++) fprintf(f, ",%.9g", rates[j*n+i]);
+            } else {
+                fprintf(f, ",%s", statnames[i-n]);
+                for (int j = 0; j < 5; j++) {
+                    double s[] = {
+                        stats[j].min, stats[j].median, stats[j].mean,
+                        stats[j].stddev, stats[j].ci95low, stats[j].ci95high };
+                    fputc(',', f);
+                    if (!isnan(s[i-n])) fprintf(f, "%.9g", s[i-n]);
+                }
+            }
+#ifdef HAVE_PAPI
+            if (report->papi_regions) PAPI_UTIL_fprint_regions_csv(f);
+#endif
+            fprintf(f, "\n");
+        }
+    }
+    free(rates);
+    return 0;
+}
+
+/**
+ * ‘fprint_roofline()’ compares the best of the measured times with a
+ * roofline model, where the attainable performance is the arithmetic
+ * intensity times the larger of the bandwidths that were measured with
+ * ‘stream_benchmark()’. The arithmetic intensity is estimated from the
+ * lower and upper estimates of the bytes moved, that is, with perfect
+ * reuse of the source vector in cache, or no reuse at all.
+ */
+static void fprint_roofline(
+    FILE * f,
+    const struct benchmark_report * report)
+{
+    double t = report->seconds[0];
+    for (int i = 1; i < report->num_timings; i++)
+        if (t > report->seconds[i]) t = report->seconds[i];
+    double triad = report->stream_triad_gbytes_per_second;
+    double read = report->stream_read_gbytes_per_second;
+    double bw = triad > read ? triad : read;
+    double gflops = (double) report->num_flops * 1e-9 / t;
+    double mingbs = (double) report->min_bytes * 1e-9 / t;
+    double maxgbs = (double) report->max_bytes * 1e-9 / t;
+    double minai = (double) report->num_flops / report->max_bytes;
+    double maxai = (double) report->num_flops / report->min_bytes;
+    fprintf(f, "roofline: %s: %'.3f Gflop/s and %'.1f to %'.1f GB/s, which is "
+            "%'.0f%% to %'.0f%% of triad and %'.0f%% to %'.0f%% of read bandwidth\n",
+            report->kernel, gflops, mingbs, maxgbs,
+            100*mingbs/triad, 100*maxgbs/triad, 100*mingbs/read, 100*maxgbs/read);
+    fprintf(f, "roofline: arithmetic intensity of %'.3f to %'.3f flop/byte, "
+            "where %'.3f to %'.3f Gflop/s is attainable at %'.1f GB/s\n",
+            minai, maxai, minai*bw, maxai*bw, bw);
+    if (mingbs >= 0.8*bw) {
+        fprintf(f, "roofline: bandwidth-bound, since even the lower estimate "
+                "of the bytes moved reaches 80%% of the measured bandwidth\n");
+    } else if (maxgbs >= 0.8*bw) {
+        fprintf(f, "roofline: bandwidth-bound, unless the source vector "
+                "is mostly reused in cache\n");
+    } else {
+        fprintf(f, "roofline: gather- or latency-bound, since even the upper estimate "
+                "of the bytes moved is below 80%% of the measured bandwidth\n");
+    }
+}
+
+/*
+ * With ‘--autotune’, each of the following options is tried, and
+ * each of them is combined with every option in ‘autotune_modifiers’.
+ */
+static const char * autotune_variants[] = {
+    "",
+    "--column-major",
+    "--format=sell",
+    "--format=hyb",
+    "--compress-colidx",
+    "--format=hyb --compress-colidx",
+#if defined(USE_AVX512_KERNELS) || defined(USE_SVE_KERNELS)
+    "--kernel=scalar",
+    "--kernel=scalar --column-major",
+#endif
+    "--sw-prefetch-distance=16",
+    "--sw-prefetch-distance=64",
+    "--sw-prefetch-distance=16 --column-major",
 };
 
-static int mtxfile_fread_header(
-    enum mtxobject * object,
-    enum mtxformat * format,
-    enum mtxfield * field,
-    enum mtxsymmetry * symmetry,
-    idx_t * num_rows,
-    idx_t * num_columns,
-    int64_t * num_nonzeros,
-    enum streamtype streamtype,
-    union stream stream,
-    int64_t * lines_read,
-    int64_t * bytes_read)
+static const char * autotune_modifiers[] = {
+    "",
+    "--separate-diagonal",
+    "--sort-rows",
+    "--separate-diagonal --sort-rows",
+};
+
+/**
+ * ‘autotune_conversion()’ describes, as a string, how the matrix is
+ * converted with the given options, so that candidates that convert
+ * the matrix in the same way can load it from the same binary file.
+ * ‘false’ is returned if the matrix is not read from a Matrix Market
+ * file, or if it cannot be saved to a binary file with the given
+ * options, as for the hybrid format.
+ */
+static bool autotune_conversion(
+    const struct program_options * args,
+    char * key,
+    size_t size)
 {
-    int line_max = sysconf(_SC_LINE_MAX);
-    char * linebuf = malloc(line_max+1);
-    if (!linebuf) return errno;
+    if (!args->Apath || args->reorder != reorder_none ||
+        args->format == format_hyb)
+        return false;
+    snprintf(key, size, "%d %d %d %d %d %d", (int) args->format,
+             args->format == format_ell && args->column_major,
+             args->format == format_sell ? args->chunk_size : 0,
+             args->format == format_sell ? args->sigma : 0,
+             args->separate_diagonal, args->sort_rows);
+    return true;
+}
 
-    /* read and parse header line */
-    int err = freadline(linebuf, line_max, streamtype, stream);
-    if (err) { free(linebuf); return err; }
-    char * s = linebuf;
-    char * t = s;
-    if (strncmp("%%MatrixMarket ", t, strlen("%%MatrixMarket ")) == 0) {
-        t += strlen("%%MatrixMarket ");
-    } else { free(linebuf); return EINVAL; }
-    if (bytes_read) *bytes_read += t-s;
-    s = t;
-    if (strncmp("matrix ", t, strlen("matrix ")) == 0) {
-        t += strlen("matrix ");
-        *object = mtxmatrix;
-    } else if (strncmp("vector ", t, strlen("vector ")) == 0) {
-        t += strlen("vector ");
-        *object = mtxvector;
-    } else { free(linebuf); return EINVAL; }
-    if (bytes_read) *bytes_read += t-s;
-    s = t;
-    if (strncmp("array ", t, strlen("array ")) == 0) {
-        t += strlen("array ");
-        *format = mtxarray;
-    } else if (strncmp("coordinate ", t, strlen("coordinate ")) == 0) {
-        t += strlen("coordinate ");
-        *format = mtxcoordinate;
-    } else { free(linebuf); return EINVAL; }
-    if (bytes_read) *bytes_read += t-s;
-    s = t;
-    if (strncmp("real ", t, strlen("real ")) == 0) {
-        t += strlen("real ");
-        *field = mtxreal;
-    } else if (strncmp("integer ", t, strlen("integer ")) == 0) {
-        t += strlen("integer ");
-        *field = mtxinteger;
-    } else if (strncmp("pattern ", t, strlen("pattern ")) == 0) {
-        t += strlen("pattern ");
-        *field = mtxpattern;
-    } else { free(linebuf); return EINVAL; }
-    if (bytes_read) *bytes_read += t-s;
-    s = t;
-    if (strncmp("general", t, strlen("general")) == 0) {
-        t += strlen("general");
-        *symmetry = mtxgeneral;
-    } else if (strncmp("symmetric", t, strlen("symmetric")) == 0) {
-        t += strlen("symmetric");
-        *symmetry = mtxsymmetric;
-    } else { free(linebuf); return EINVAL; }
-    if (bytes_read) *bytes_read += t-s;
-    s = t;
+/*
+ * autotuning
+ */
 
-    /* skip lines starting with '%' */
-    do {
-        if (lines_read) (*lines_read)++;
-        err = freadline(linebuf, line_max, streamtype, stream);
-        if (err) { free(linebuf); return err; }
-        s = t = linebuf;
-    } while (linebuf[0] == '%');
+/**
+ * ‘file_hash()’ computes a 64-bit FNV-1a hash of the contents of a
+ * file, which identifies a matrix in a tuning file.
+ */
+static int file_hash(
+    const char * path,
+    uint64_t * hash)
+{
+    FILE * f = fopen(path, "rb");
+    if (!f) return errno;
+    uint64_t h = UINT64_C(14695981039346656037);
+    unsigned char buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            h ^= buf[i];
+            h *= UINT64_C(1099511628211);
+        }
+    }
+    int err = ferror(f) ? EIO : 0;
+    fclose(f);
+    if (err) return err;
+    *hash = h;
+    return 0;
+}
 
-    /* parse size line */
-    if (*object == mtxmatrix && *format == mtxcoordinate) {
-        err = parse_idx_t(num_rows, s, &t, bytes_read);
-        if (err) { free(linebuf); return err; }
-        if (s == t || *t != ' ') { free(linebuf); return EINVAL; }
-        if (bytes_read) (*bytes_read)++;
-        s = t+1;
-        err = parse_idx_t(num_columns, s, &t, bytes_read);
-        if (err) { free(linebuf); return err; }
-        if (s == t || *t != ' ') { free(linebuf); return EINVAL; }
-        if (bytes_read) (*bytes_read)++;
-        s = t+1;
-        err = parse_int64_t(num_nonzeros, s, &t, bytes_read);
-        if (err) { free(linebuf); return err; }
-        if (s == t) { free(linebuf); return EINVAL; }
-        if (lines_read) (*lines_read)++;
-    } else if (*object == mtxvector && *format == mtxarray) {
-        err = parse_idx_t(num_rows, s, &t, bytes_read);
-        if (err) { free(linebuf); return err; }
-        if (s == t) { free(linebuf); return EINVAL; }
-        if (lines_read) (*lines_read)++;
-    } else { free(linebuf); return EINVAL; }
-    free(linebuf);
+/**
+ * ‘tuning_file_lookup()’ finds the options that were saved for a
+ * matrix with the given hash in a tuning file.
+ *
+ * A tuning file contains one line for every matrix and program, with
+ * the hash of the matrix (as 16 hexadecimal digits), the program name
+ * and the options, separated by spaces. If the matrix is found,
+ * ‘options’ is set to a newly allocated string that must be freed by
+ * the caller. Otherwise, ‘options’ is set to ‘NULL’.
+ */
+static int tuning_file_lookup(
+    const char * path,
+    const char * program,
+    uint64_t hash,
+    char ** options)
+{
+    *options = NULL;
+    FILE * f = fopen(path, "r");
+    if (!f) return errno == ENOENT ? 0 : errno;
+    char line[1024];
+    while (fgets(line, sizeof(line), f)) {
+        uint64_t h;
+        char name[64];
+        int n;
+        if (sscanf(line, "%16"SCNx64" %63s %n", &h, name, &n) != 2) continue;
+        if (h != hash || strcmp(name, program) != 0) continue;
+        line[strcspn(line, "\n")] = '\0';
+        free(*options);
+        *options = strdup(&line[n]);
+        if (!*options) { fclose(f); return errno; }
+    }
+    fclose(f);
     return 0;
 }
 
-static int mtxfile_fread_matrix_coordinate(
-    enum mtxfield field,
+/**
+ * ‘tuning_file_save()’ saves the options for a matrix with the given
+ * hash to a tuning file, replacing any options that were previously
+ * saved for the same matrix and program.
+ */
+static int tuning_file_save(
+    const char * path,
+    const char * program,
+    uint64_t hash,
+    const char * options)
+{
+    /* read the entries for other matrices and programs */
+    char * lines = NULL;
+    size_t size = 0;
+    FILE * f = fopen(path, "r");
+    if (f) {
+        char line[1024];
+        while (fgets(line, sizeof(line), f)) {
+            uint64_t h;
+            char name[64];
+            if (sscanf(line, "%16"SCNx64" %63s", &h, name) == 2 &&
+                h == hash && strcmp(name, program) == 0)
+                continue;
+            size_t len = strlen(line);
+            char * p = realloc(lines, size+len+1);
+            if (!p) { int err = errno; free(lines); fclose(f); return err; }
+            lines = p;
+            memcpy(&lines[size], line, len+1);
+            size += len;
+        }
+        fclose(f);
+    } else if (errno != ENOENT) { return errno; }
+
+    f = fopen(path, "w");
+    if (!f) { int err = errno; free(lines); return err; }
+    if (size > 0) fputs(lines, f);
+    fprintf(f, "%016"PRIx64" %s %s\n", hash, program, options);
+    free(lines);
+    if (fclose(f) == EOF) return errno;
+    return 0;
+}
+
+/*
+ * Candidates whose result differs from that of the first candidate,
+ * relative to the largest magnitude of the latter, by more than the
+ * following tolerance are rejected by ‘--autotune’.
+ */
+#ifndef AUTOTUNE_TOLERANCE
+#define AUTOTUNE_TOLERANCE (sizeof(vec_t) < sizeof(double) ? 1e-3 : 1e-8)
+#endif
+
+/**
+ * ‘autotune_argv()’ creates the command-line arguments for running
+ * the program with the given options and extra arguments added to
+ * the original command-line arguments. If ‘matrix’ is not ‘NULL’, it
+ * replaces the path to the matrix, which is ‘argv[Apath_index]’.
+ *
+ * The options ‘--autotune’, ‘--tuning-file’, ‘--stream-baseline’,
+ * ‘--thread-stats’, ‘--save-binary’, ‘--result-file’ and ‘--quiet’
+ * are removed from the original arguments. The arguments are stored
+ * in a single allocation, which must be freed by the caller.
+ */
+static char ** autotune_argv(
+    int argc,
+    char ** argv,
+    const char * options,
+    const char * const * extra,
+    int Apath_index,
+    const char * matrix,
+    int * childargc)
+{
+    static const char * removed[] = {
+        "--tuning-file", "--save-binary", "--result-file"};
+    int num_extra = 0;
+    while (extra && extra[num_extra]) num_extra++;
+    size_t len = strlen(options);
+    size_t num_args = argc + len/2+1 + num_extra + 1;
+    char ** childargv = malloc(num_args * sizeof(char *) + len+1);
+    if (!childargv) return NULL;
+    char * optionsbuf = (char *) &childargv[num_args];
+    memcpy(optionsbuf, options, len+1);
+    int n = 0;
+    childargv[n++] = argv[0];
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--autotune") == 0) continue;
+        if (strcmp(argv[i], "--stream-baseline") == 0) continue;
+        if (strcmp(argv[i], "--thread-stats") == 0) continue;
+        if (strcmp(argv[i], "-q") == 0 || strcmp(argv[i], "--quiet") == 0) continue;
+        bool skip = false;
+        for (size_t j = 0; j < sizeof(removed) / sizeof(*removed); j++) {
+            if (strstr(argv[i], removed[j]) == argv[i]) {
+                if (argv[i][strlen(removed[j])] == '\0') i++;
+                skip = true;
+                break;
+            }
+        }
+        if (skip) continue;
+        childargv[n++] = matrix && i == Apath_index ? (char *) matrix : argv[i];
+    }
+    for (char * s = strtok(optionsbuf, " "); s; s = strtok(NULL, " "))
+        childargv[n++] = s;
+    for (int i = 0; i < num_extra; i++) childargv[n++] = (char *) extra[i];
+    childargv[n] = NULL;
+    *childargc = n;
+    return childargv;
+}
+
+/**
+ * ‘autotune_run()’ runs the program once more with the given
+ * command-line arguments, which must request a CSV benchmark report,
+ * and returns the median time per multiplication and the
+ * corresponding Gnz/s and Gflop/s from the report.
+ *
+ * ‘ENOEXEC’ is returned if the program fails, for example, because
+ * the options cannot be used together or with the given matrix.
+ * Unless ‘verbose’ is set, the error output of the program is
+ * discarded.
+ */
+static int autotune_run(
+    char ** childargv,
+    bool verbose,
+    double * seconds,
+    double * gnzs,
+    double * gflops)
+{
+    int pipefd[2];
+    if (pipe(pipefd) == -1) return errno;
+    fflush(stdout); fflush(stderr);
+    pid_t pid = fork();
+    if (pid == -1) {
+        int err = errno;
+        close(pipefd[0]); close(pipefd[1]);
+        return err;
+    } else if (pid == 0) {
+        close(pipefd[0]);
+        dup2(pipefd[1], STDOUT_FILENO);
+        close(pipefd[1]);
+        if (!verbose) {
+            int fd = open("/dev/null", O_WRONLY);
+            if (fd != -1) { dup2(fd, STDERR_FILENO); close(fd); }
+        }
+        execv("/proc/self/exe", childargv);
+        execvp(childargv[0], childargv);
+        _exit(127);
+    }
+    close(pipefd[1]);
+    /* read the benchmark report */
+    char * report = NULL;
+    size_t size = 0, capacity = 0;
+    int err = 0;
+    for (;;) {
+        if (size + 4096 + 1 > capacity) {
+            capacity = 2*capacity > size + 4096 + 1 ? 2*capacity : size + 4096 + 1;
+            char * p = realloc(report, capacity);
+            if (!p) { err = errno; break; }
+            report = p;
+        }
+        ssize_t n = read(pipefd[0], &report[size], capacity-size-1);
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) break;
+        size += n;
+    }
+    close(pipefd[0]);
+    int status;
+    while (waitpid(pid, &status, 0) == -1) {
+        if (errno != EINTR) { if (!err) err = errno; break; }
+    }
+    if (err) { free(report); return err; }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+        free(report); return ENOEXEC;
+    }
+    if (!report) return ENOEXEC;
+    report[size] = '\0';
+
+    /*
+     * Find the line with the median, where the statistic is followed
+     * by the seconds, Gnz/s, Gflop/s and the two bandwidth estimates.
+     */
+    err = ENOEXEC;
+    for (char * line = strtok(report, "\n"); line; line = strtok(NULL, "\n")) {
+        char * p = line + strlen(line);
+        int commas = 0;
+        while (p > line && commas < 6) { if (*--p == ',') commas++; }
+        if (commas < 6) continue;
+        if (strncmp(p+1, "median,", strlen("median,")) != 0) continue;
+        if (sscanf(p+1+strlen("median,"), "%lf,%lf,%lf", seconds, gnzs, gflops) == 3)
+            err = 0;
+        break;
+    }
+    free(report);
+    return err;
+}
+
+/**
+ * ‘autotune_read_result()’ reads the result vector, or the result
+ * vectors as a dense matrix, that the program wrote to a file in
+ * Matrix Market array format. The values are stored in a newly
+ * allocated array that must be freed by the caller.
+ */
+static int autotune_read_result(
+    const char * path,
+    int64_t * size,
+    double ** y)
+{
+    FILE * f = fopen(path, "r");
+    if (!f) return errno;
+    char line[256];
+    do {
+        if (!fgets(line, sizeof(line), f)) { fclose(f); return EINVAL; }
+    } while (line[0] == '%');
+    int64_t num_rows, num_columns = 1;
+    if (sscanf(line, "%"SCNd64" %"SCNd64, &num_rows, &num_columns) < 1 ||
+        num_rows < 0 || num_columns < 1)
+    {
+        fclose(f);
+        return EINVAL;
+    }
+    *size = num_rows*num_columns;
+    *y = malloc((*size > 0 ? *size : 1) * sizeof(double));
+    if (!*y) { int err = errno; fclose(f); return err; }
+    for (int64_t i = 0; i < *size; i++) {
+        if (fscanf(f, "%lf", &(*y)[i]) != 1) {
+            free(*y); fclose(f);
+            return EINVAL;
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+/**
+ * ‘autotune()’ runs the program with each of the candidate options in
+ * ‘autotune_variants’, combined with each of the options in
+ * ‘autotune_modifiers’, and reports the fastest combination.
+ *
+ * Each combination is run as a separate process, which performs the
+ * number of warmup iterations and repetitions that were given on the
+ * command line. Only the first combination that converts the matrix
+ * in a given way reads the Matrix Market file, and it saves the
+ * converted matrix to a temporary binary file, which is loaded by the
+ * other combinations that convert it in the same way. Combinations
+ * that cannot be used with the matrix are skipped, and so are those
+ * whose result differs from that of the first combination, which uses
+ * the default options, by more than ‘AUTOTUNE_TOLERANCE’. If a tuning
+ * file is given, the fastest options are saved to it. Errors are
+ * printed before returning.
+ */
+static int autotune(
+    int argc,
+    char ** argv,
+    const char * program,
+    const struct program_options * args)
+{
+    int num_variants = sizeof(autotune_variants) / sizeof(*autotune_variants);
+    int num_modifiers = sizeof(autotune_modifiers) / sizeof(*autotune_modifiers);
+    char best[256] = "";
+    double bestseconds = INFINITY, bestgnzs = 0, bestgflops = 0;
+
+    /*
+     * The binary files and the result of every combination are kept
+     * in a temporary directory, which is removed at the end.
+     */
+    const char * tmpdir = getenv("TMPDIR");
+    char dir[1024], resultpath[1100], resultopt[1200];
+    snprintf(dir, sizeof(dir), "%s/%s-autotune-XXXXXX",
+             tmpdir && *tmpdir ? tmpdir : "/tmp", program);
+    if (!mkdtemp(dir)) {
+        int err = errno;
+        fprintf(stderr, "%s: %s: %s\n", program_invocation_short_name, dir, strerror(err));
+        return err;
+    }
+    snprintf(resultpath, sizeof(resultpath), "%s/y.mtx", dir);
+    snprintf(resultopt, sizeof(resultopt), "--result-file=%s", resultpath);
+
+    /*
+     * Binary files can only replace the matrix path if it comes
+     * before any ‘--’, which would make the option a positional
+     * argument.
+     */
+    bool binary = args->Apath_index > 0;
+    for (int i = 1; i < args->Apath_index; i++)
+        if (strcmp(argv[i], "--") == 0) binary = false;
+    struct { char key[128]; bool saved; } * bins =
+        malloc(num_variants*num_modifiers * sizeof(*bins));
+    int num_bins = 0;
+    if (!bins) {
+        int err = errno;
+        fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(err));
+        rmdir(dir);
+        return err;
+    }
+
+    char reference[256] = "";
+    double * yref = NULL;
+    int64_t yrefsize = 0;
+    int err = 0;
+    for (int i = 0; i < num_variants && !err; i++) {
+        for (int j = 0; j < num_modifiers && !err; j++) {
+            char options[256];
+            snprintf(options, sizeof(options), "%s%s%s", autotune_variants[i],
+                     autotune_variants[i][0] && autotune_modifiers[j][0] ? " " : "",
+                     autotune_modifiers[j]);
+            if (args->verbose > 0) {
+                fprintf(stderr, "autotune: %s: ", options[0] ? options : "(default)");
+                fflush(stderr);
+            }
+
+            /*
+             * Find out how the combination converts the matrix, and
+             * whether the converted matrix is already saved.
+             */
+            int childargc, nargs, bin = -1;
+            char key[128];
+            char ** childargv = autotune_argv(
+                argc, argv, options, NULL, 0, NULL, &childargc);
+            if (!childargv) { err = errno; break; }
+            struct program_options childargs;
+            if (parse_program_options(childargc, childargv, &childargs, &nargs) != 0) {
+                free(childargv);
+                if (args->verbose > 0) fprintf(stderr, "not applicable\n");
+                continue;
+            }
+            if (binary && autotune_conversion(&childargs, key, sizeof(key))) {
+                for (bin = 0; bin < num_bins; bin++)
+                    if (strcmp(bins[bin].key, key) == 0) break;
+                if (bin == num_bins) {
+                    snprintf(bins[bin].key, sizeof(bins[bin].key), "%s", key);
+                    bins[bin].saved = false;
+                    num_bins++;
+                }
+            }
+            program_options_free(&childargs);
+            free(childargv);
+
+            char binopt[1200];
+            const char * extra[] = {"--output=csv", resultopt, NULL, NULL};
+            if (bin >= 0) {
+                snprintf(binopt, sizeof(binopt), "--%s-binary=%s/%d.bin",
+                         bins[bin].saved ? "load" : "save", dir, bin);
+                if (!bins[bin].saved) extra[2] = binopt;
+            }
+            childargv = autotune_argv(
+                argc, argv, options, extra, args->Apath_index,
+                bin >= 0 && bins[bin].saved ? binopt : NULL, &childargc);
+            if (!childargv) { err = errno; break; }
+            double seconds, gnzs, gflops;
+            err = autotune_run(childargv, args->verbose > 1, &seconds, &gnzs, &gflops);
+            free(childargv);
+            if (bin >= 0 && !bins[bin].saved) {
+                if (!err) bins[bin].saved = true;
+                else unlink(&binopt[strlen("--save-binary=")]);
+            }
+            if (err == ENOEXEC) {
+                if (args->verbose > 0) fprintf(stderr, "not applicable\n");
+                unlink(resultpath);
+                err = 0;
+                continue;
+            } else if (err) {
+                break;
+            }
+
+            /*
+             * Compare the result with that of the first combination,
+             * so that options that give a wrong result are not used.
+             */
+            double * y = NULL;
+            int64_t ysize = 0;
+            err = autotune_read_result(resultpath, &ysize, &y);
+            unlink(resultpath);
+            if (err) break;
+            if (!yref) {
+                yref = y; yrefsize = ysize;
+                snprintf(reference, sizeof(reference), "%s", options);
+            } else {
+                double maxdiff = ysize == yrefsize ? 0 : NAN, maxref = 0;
+                for (int64_t k = 0; k < ysize && ysize == yrefsize; k++) {
+                    double d = fabs(y[k] - yref[k]);
+                    if (isnan(d) || d > maxdiff) maxdiff = d;
+                    if (fabs(yref[k]) > maxref) maxref = fabs(yref[k]);
+                    if (isnan(maxdiff)) break;
+                }
+                free(y);
+                if (!(maxdiff <= AUTOTUNE_TOLERANCE * maxref)) {
+                    if (args->verbose > 0) fprintf(stderr, "rejected\n");
+                    fprintf(stderr, "%s: warning: autotune: %s: the result differs from that of %s "
+                            "by %.3g (relative), so the options are not used\n",
+                            program_invocation_short_name, options[0] ? options : "(default)",
+                            reference[0] ? reference : "(default)",
+                            maxref > 0 ? maxdiff / maxref : maxdiff);
+                    continue;
+                }
+            }
+
+            if (args->verbose > 0) {
+                fprintf(stderr, "%'.6f seconds (%'.3f Gnz/s, %'.3f Gflop/s)\n",
+                        seconds, gnzs, gflops);
+            }
+            if (seconds < bestseconds) {
+                bestseconds = seconds; bestgnzs = gnzs; bestgflops = gflops;
+                snprintf(best, sizeof(best), "%s", options);
+            }
+        }
+    }
+    for (int bin = 0; bin < num_bins; bin++) {
+        char binpath[1100];
+        snprintf(binpath, sizeof(binpath), "%s/%d.bin", dir, bin);
+        unlink(binpath);
+    }
+    rmdir(dir);
+    free(bins); free(yref);
+    if (err) {
+        if (args->verbose > 0) fprintf(stderr, "\n");
+        fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(err));
+        return err;
+    }
+    if (isinf(bestseconds)) {
+        fprintf(stderr, "%s: none of the candidate options could be used\n",
+                program_invocation_short_name);
+        return ENOEXEC;
+    }
+    fprintf(stdout, "%s: %'.6f seconds (%'.3f Gnz/s, %'.3f Gflop/s)\n",
+            best[0] ? best : "(default)", bestseconds, bestgnzs, bestgflops);
+
+    if (args->tuning_file) {
+        const char * path = args->load_binary_path ? args->load_binary_path : args->Apath;
+        uint64_t hash;
+        int err = file_hash(path, &hash);
+        if (!err) err = tuning_file_save(args->tuning_file, program, hash, best);
+        if (err) {
+            fprintf(stderr, "%s: %s: %s\n", program_invocation_short_name,
+                    args->tuning_file, strerror(err));
+            return err;
+        }
+        if (args->verbose > 0) {
+            fprintf(stderr, "autotune: saved options for matrix %016"PRIx64" to %s\n",
+                    hash, args->tuning_file);
+        }
+    }
+    return 0;
+}
+
+/**
+ * ‘apply_tuning_file()’ looks up the options that were saved for the
+ * matrix in a tuning file, and, if they are found, parses the program
+ * options again with the saved options inserted before the original
+ * command-line arguments, so that the latter take precedence. If an
+ * error occurs, the program options are freed.
+ */
+static int apply_tuning_file(
+    int argc,
+    char ** argv,
+    const char * program,
+    struct program_options * args,
+    int * nargs)
+{
+    const char * path = args->load_binary_path ? args->load_binary_path : args->Apath;
+    uint64_t hash;
+    int err = file_hash(path, &hash);
+    if (err) { program_options_free(args); return err; }
+    char * options;
+    err = tuning_file_lookup(args->tuning_file, program, hash, &options);
+    if (err) { program_options_free(args); return err; }
+    if (!options) {
+        if (args->verbose > 0) {
+            fprintf(stderr, "%s: no options found for matrix %016"PRIx64"\n",
+                    args->tuning_file, hash);
+        }
+        return 0;
+    }
+    if (args->verbose > 0) {
+        fprintf(stderr, "%s: using options for matrix %016"PRIx64": %s\n",
+                args->tuning_file, hash, options[0] ? options : "(default)");
+    }
+
+    char ** tunedargv = malloc((argc + strlen(options) + 1) * sizeof(char *));
+    if (!tunedargv) { err = errno; free(options); program_options_free(args); return err; }
+    int tunedargc = 0;
+    tunedargv[tunedargc++] = argv[0];
+    for (char * s = strtok(options, " "); s; s = strtok(NULL, " "))
+        tunedargv[tunedargc++] = s;
+    for (int i = 1; i < argc; i++) tunedargv[tunedargc++] = argv[i];
+    tunedargv[tunedargc] = NULL;
+    program_options_free(args);
+    err = parse_program_options(tunedargc, tunedargv, args, nargs);
+    free(tunedargv); free(options);
+    return err;
+}
+
+#ifndef PAGE_NODES_MAX_RANGES
+#define PAGE_NODES_MAX_RANGES 8
+#endif
+
+/**
+ * ‘fprint_page_nodes()’ prints the NUMA node of each page in a given
+ * memory region, grouping consecutive pages that reside on the same
+ * node into ranges.
+ *
+ * ‘ENOTSUP’ is returned if the page locations cannot be queried, in
+ * which case nothing is printed.
+ */
+static int fprint_page_nodes(
+    FILE * f,
+    const char * name,
+    const void * p,
+    size_t size)
+{
+#if defined(__linux__) && defined(SYS_move_pages)
+    long pagesize = sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t) p - (uintptr_t) p % pagesize;
+    size_t num_pages = size > 0 ? ((uintptr_t) p + size - start + pagesize - 1) / pagesize : 0;
+    void ** pages = malloc(num_pages * sizeof(void *));
+    if (!pages) return errno;
+    int * status = malloc(num_pages * sizeof(int));
+    if (!status) { free(pages); return errno; }
+    for (size_t k = 0; k < num_pages; k++)
+        pages[k] = (void *) (start + k*pagesize);
+
+    /* query the node of each page without moving it */
+    if (num_pages > 0 && syscall(SYS_move_pages, 0, num_pages, pages, NULL, status, 0) != 0) {
+        free(status); free(pages);
+        return ENOTSUP;
+    }
+
+    fprintf(f, "%s: %'zu pages", name, num_pages);
+    int num_ranges = 0;
+    for (size_t k = 0, l; k < num_pages; k = l, num_ranges++) {
+        for (l = k+1; l < num_pages && status[l] == status[k]; l++) {}
+        if (num_ranges >= PAGE_NODES_MAX_RANGES) continue;
+        if (status[k] >= 0) {
+            fprintf(f, ", %'zu-%'zu on node %d", k, l-1, status[k]);
+        } else {
+            fprintf(f, ", %'zu-%'zu %s", k, l-1,
+                    status[k] == -ENOENT ? "not present" : strerror(-status[k]));
+        }
+    }
+    if (num_ranges > PAGE_NODES_MAX_RANGES)
+        fprintf(f, ", ... (%'d ranges in total)", num_ranges);
+    fputc('\n', f);
+    free(status); free(pages);
+    return 0;
+#else
+    return ENOTSUP;
+#endif
+}
+
+/*
+ * huge pages
+ */
+
+#if defined(MAP_HUGETLB) && !defined(MAP_HUGE_SHIFT)
+#define MAP_HUGE_SHIFT 26
+#endif
+#if defined(MAP_HUGETLB) && !defined(MAP_HUGE_2MB)
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#if defined(MAP_HUGETLB) && !defined(MAP_HUGE_1GB)
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+
+/*
+ * Arrays that are allocated in huge pages are mapped with ‘mmap()’,
+ * and they are recorded here, so that ‘array_free()’ can unmap them
+ * and ‘fprint_hugepages()’ can tell that an array has a mapping of
+ * its own.
+ */
+struct array_mapping { void * p; size_t size; };
+static struct array_mapping * array_mappings = NULL;
+static int num_array_mappings = 0;
+static int max_array_mappings = 0;
+
+static int array_mapping_add(
+    void * p,
+    size_t size)
+{
+    if (num_array_mappings >= max_array_mappings) {
+        int n = max_array_mappings > 0 ? 2*max_array_mappings : 16;
+        struct array_mapping * m = realloc(array_mappings, n * sizeof(*m));
+        if (!m) return ENOMEM;
+        array_mappings = m; max_array_mappings = n;
+    }
+    array_mappings[num_array_mappings].p = p;
+    array_mappings[num_array_mappings].size = size;
+    num_array_mappings++;
+    return 0;
+}
+
+static const struct array_mapping * array_mapping_find(
+    const void * p)
+{
+    for (int i = 0; i < num_array_mappings; i++) {
+        if (array_mappings[i].p == p) return &array_mappings[i];
+    }
+    return NULL;
+}
+
+/**
+ * ‘array_alloc()’ allocates storage for an array of the matrix or the
+ * vectors, which must be freed with ‘array_free()’.
+ *
+ * With ‘hugepages_2M’ or ‘hugepages_1G’, the array is mapped with
+ * ‘MAP_HUGETLB’ from the pool of huge pages of the given size, and,
+ * if none are available, transparent huge pages are requested
+ * instead. With ‘hugepages_thp’, the array gets an anonymous mapping
+ * of its own, which is aligned to 2 MiB, and transparent huge pages
+ * are requested for it with ‘MADV_HUGEPAGE’. The mapping is followed
+ * by an inaccessible guard page, so that the kernel does not merge
+ * it with the mapping of a neighbouring array, and ‘fprint_hugepages()’
+ * therefore reports the huge pages of each array exactly. Either way,
+ * the array ends up in normal pages if huge pages cannot be used.
+ */
+static void * array_alloc(
+    size_t size,
+    enum hugepages hugepages)
+{
+#if defined(__linux__) && defined(MAP_HUGETLB)
+    if (hugepages == hugepages_2M || hugepages == hugepages_1G) {
+        size_t hugepagesize = hugepages == hugepages_1G ? (size_t) 1 << 30 : (size_t) 1 << 21;
+        size_t len = size > 0 ? (size + hugepagesize - 1) / hugepagesize * hugepagesize : hugepagesize;
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB |
+            (hugepages == hugepages_1G ? MAP_HUGE_1GB : MAP_HUGE_2MB);
+        void * p = mmap(NULL, len, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (p != MAP_FAILED) {
+            if (!array_mapping_add(p, len)) return p;
+            munmap(p, len);
+        }
+    }
+#endif
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (hugepages != hugepages_none) {
+        /*
+         * Map enough to align the array to 2 MiB, and unmap whatever
+         * lies before the aligned array and after its guard page.
+         */
+        size_t alignment = (size_t) 1 << 21;
+        size_t pagesize = sysconf(_SC_PAGESIZE);
+        size_t len = size > 0 ? (size + alignment - 1) / alignment * alignment : alignment;
+        size_t maplen = len + pagesize + alignment;
+        char * q = mmap(NULL, maplen, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (q != MAP_FAILED) {
+            char * p = (char *) (((uintptr_t) q + alignment - 1) & ~((uintptr_t) alignment - 1));
+            if (p > q) munmap(q, p - q);
+            if (q + maplen > p + len + pagesize)
+                munmap(p + len + pagesize, q + maplen - (p + len + pagesize));
+            mprotect(p + len, pagesize, PROT_NONE);
+            madvise(p, len, MADV_HUGEPAGE);
+            if (!array_mapping_add(p, len + pagesize)) return p;
+            munmap(p, len + pagesize);
+        }
+    }
+#endif
+#ifdef HAVE_ALIGNED_ALLOC
+    long pagesize = sysconf(_SC_PAGESIZE);
+    return aligned_alloc(pagesize, size + pagesize - size % pagesize);
+#else
+    return malloc(size);
+#endif
+}
+
+/**
+ * ‘array_free()’ frees an array that was allocated with
+ * ‘array_alloc()’.
+ */
+static void array_free(
+    void * p)
+{
+    for (int i = 0; i < num_array_mappings; i++) {
+        if (array_mappings[i].p == p) {
+            munmap(p, array_mappings[i].size);
+            array_mappings[i] = array_mappings[--num_array_mappings];
+            return;
+        }
+    }
+    free(p);
+}
+
+/**
+ * ‘fprint_hugepages()’ prints how much of an array that was allocated
+ * with ‘array_alloc()’ resides in huge pages, according to
+ * ‘/proc/self/smaps’, which shows the page size of hugetlbfs mappings
+ * and the amount of transparent huge pages in other mappings.
+ *
+ * Since smaps only counts transparent huge pages per mapping, the
+ * amount is exact for arrays with a mapping of their own. Otherwise,
+ * the array shares its mapping with other data, and the transparent
+ * huge pages of the whole mapping are printed and labelled as such.
+ *
+ * ‘ENOTSUP’ is returned if this cannot be queried, in which case
+ * nothing is printed.
+ */
+static int fprint_hugepages(
+    FILE * f,
+    const char * name,
+    const void * p,
+    size_t size)
+{
+#ifdef __linux__
+    FILE * smaps = fopen("/proc/self/smaps", "r");
+    if (!smaps) return ENOTSUP;
+    bool ownmapping = array_mapping_find(p) != NULL;
+    uintptr_t start = (uintptr_t) p, end = (uintptr_t) p + size;
+    size_t pagesize = sysconf(_SC_PAGESIZE);
+    size_t overlap = 0, hugetlbbytes = 0, thpbytes = 0, hugepagesize = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), smaps)) {
+        uintptr_t a, b;
+        unsigned long kb;
+        if (sscanf(line, "%"SCNxPTR"-%"SCNxPTR, &a, &b) == 2) {
+            overlap = a < end && start < b ? (b < end ? b : end) - (a > start ? a : start) : 0;
+        } else if (overlap > 0 && sscanf(line, "KernelPageSize: %lu kB", &kb) == 1) {
+            if (kb*1024 > pagesize) { hugetlbbytes += overlap; hugepagesize = kb*1024; }
+        } else if (overlap > 0 && sscanf(line, "AnonHugePages: %lu kB", &kb) == 1) {
+            thpbytes += ownmapping && kb*1024 > overlap ? overlap : kb*1024;
+        }
+    }
+    fclose(smaps);
+    if (!ownmapping && hugetlbbytes == 0) {
+        fprintf(f, "%s: %'zu kB in transparent huge pages in the mapping(s)"
+                " that contain the %'zu kB array\n", name, thpbytes / 1024, size / 1024);
+        return 0;
+    }
+    fprintf(f, "%s: %'zu of %'zu kB", name, (hugetlbbytes+thpbytes) / 1024, size / 1024);
+    if (hugetlbbytes > 0) fprintf(f, " in %'zu kB huge pages", hugepagesize / 1024);
+    else if (thpbytes > 0) fprintf(f, " in transparent huge pages");
+    else fprintf(f, " in huge pages");
+    fputc('\n', f);
+    return 0;
+#else
+    return ENOTSUP;
+#endif
+}
+
+/*
+ * STREAM-style memory bandwidth baseline
+ */
+
+#ifndef STREAM_ARRAY_SIZE
+#define STREAM_ARRAY_SIZE (1 << 24)
+#endif
+#ifndef STREAM_NTIMES
+#define STREAM_NTIMES 10
+#endif
+
+/**
+ * ‘stream_benchmark()’ measures the memory bandwidth with a triad,
+ * a[i] = b[i] + s*c[i], and a kernel that only reads and sums an
+ * array, both of which use the same threads, static schedule and
+ * kind of pages as the matrix-vector multiplication. Each kernel is
+ * run ‘STREAM_NTIMES’ times, and the best bandwidth is returned in
+ * GB/s. As in STREAM, the triad is counted as 24 bytes per element,
+ * without any write-allocate traffic.
+ */
+static int stream_benchmark(
+    enum hugepages hugepages,
+    double * triad_gbytes_per_second,
+    double * read_gbytes_per_second)
+{
+    int64_t n = STREAM_ARRAY_SIZE;
+    double * a = array_alloc(n * sizeof(double), hugepages);
+    if (!a) return errno;
+    double * b = array_alloc(n * sizeof(double), hugepages);
+    if (!b) { array_free(a); return errno; }
+    double * c = array_alloc(n * sizeof(double), hugepages);
+    if (!c) { array_free(b); array_free(a); return errno; }
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for (int64_t i = 0; i < n; i++) { a[i] = 0; b[i] = 2; c[i] = 1; }
+
+    struct timespec t0, t1;
+    double triad = 0, read = 0, sum = 0;
+    for (int r = 0; r < STREAM_NTIMES; r++) {
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+#ifdef _OPENMP
+        #pragma omp parallel for
+#endif
+        for (int64_t i = 0; i < n; i++) a[i] = b[i] + 3.0*c[i];
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        double gbs = 3.0 * n * sizeof(double) * 1e-9 / timespec_duration(t0, t1);
+        if (triad < gbs) triad = gbs;
+
+        /* use several partial sums to avoid waiting for each addition */
+        double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+#ifdef _OPENMP
+        #pragma omp parallel for reduction(+:s0,s1,s2,s3)
+#endif
+        for (int64_t i = 0; i < n-3; i += 4) {
+            s0 += a[i]; s1 += a[i+1]; s2 += a[i+2]; s3 += a[i+3];
+        }
+        for (int64_t i = n-n%4; i < n; i++) s0 += a[i];
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        gbs = (double) n * sizeof(double) * 1e-9 / timespec_duration(t0, t1);
+        if (read < gbs) read = gbs;
+        sum += s0 + s1 + s2 + s3;
+    }
+    array_free(c); array_free(b); array_free(a);
+
+    /* every element of ‘a’ is 5, and the sums are exact */
+    if (sum != 5.0 * n * STREAM_NTIMES) return EIO;
+    *triad_gbytes_per_second = triad;
+    *read_gbytes_per_second = read;
+    return 0;
+}
+
+enum streamtype
+{
+    stream_stdio,
+#ifdef HAVE_LIBZ
+    stream_zlib,
+#endif
+};
+
+union stream
+{
+    FILE * f;
+#ifdef HAVE_LIBZ
+    gzFile gzf;
+#endif
+};
+
+void stream_close(
+    enum streamtype streamtype,
+    union stream s)
+{
+    if (streamtype == stream_stdio) {
+        fclose(s.f);
+#ifdef HAVE_LIBZ
+    } else if (streamtype == stream_zlib) {
+        gzclose(s.gzf);
+#endif
+    }
+}
+
+/**
+ * ‘freadline()’ reads a single line from a stream.
+ */
+static int freadline(
+    char * linebuf,
+    size_t line_max,
+    enum streamtype streamtype,
+    union stream stream)
+{
+    if (streamtype == stream_stdio) {
+        char * s = fgets(linebuf, line_max+1, stream.f);
+        if (!s && feof(stream.f)) return -1;
+        else if (!s) return errno;
+        int n = strlen(s);
+        if (n > 0 && n == line_max && s[n-1] != '\n') return EOVERFLOW;
+        return 0;
+#ifdef HAVE_LIBZ
+    } else if (streamtype == stream_zlib) {
+        char * s = gzgets(stream.gzf, linebuf, line_max+1);
+        if (!s && gzeof(stream.gzf)) return -1;
+        else if (!s) return errno;
+        int n = strlen(s);
+        if (n > 0 && n == line_max && s[n-1] != '\n') return EOVERFLOW;
+        return 0;
+#endif
+    } else { return EINVAL; }
+}
+
+/**
+ * ‘freadblock()’ reads a block of up to ‘size’ bytes from a stream.
+ *
+ * The number of bytes that were read is stored in ‘nread’.  If it is
+ * less than ‘size’, then the end of the stream has been reached.
+ */
+static int freadblock(
+    char * buf,
+    size_t size,
+    size_t * nread,
+    enum streamtype streamtype,
+    union stream stream)
+{
+    if (streamtype == stream_stdio) {
+        *nread = fread(buf, 1, size, stream.f);
+        if (*nread < size && ferror(stream.f)) return errno ? errno : EIO;
+        return 0;
+#ifdef HAVE_LIBZ
+    } else if (streamtype == stream_zlib) {
+        int n = gzread(stream.gzf, buf, size);
+        if (n < 0) { int errnum; gzerror(stream.gzf, &errnum); return errnum == Z_ERRNO ? errno : EIO; }
+        *nread = n;
+        return 0;
+#endif
+    } else { return EINVAL; }
+}
+
+enum mtxobject
+{
+    mtxmatrix,
+    mtxvector,
+};
+
+enum mtxformat
+{
+    mtxarray,
+    mtxcoordinate,
+};
+
+enum mtxfield
+{
+    mtxreal,
+    mtxinteger,
+    mtxpattern,
+};
+
+enum mtxsymmetry
+{
+    mtxgeneral,
+    mtxsymmetric,
+};
+
+static int mtxfile_fread_header(
+    enum mtxobject * object,
+    enum mtxformat * format,
+    enum mtxfield * field,
+    enum mtxsymmetry * symmetry,
+    idx_t * num_rows,
+    idx_t * num_columns,
+    int64_t * num_nonzeros,
+    enum streamtype streamtype,
+    union stream stream,
+    int64_t * lines_read,
+    int64_t * bytes_read)
+{
+    int line_max = sysconf(_SC_LINE_MAX);
+    char * linebuf = malloc(line_max+1);
+    if (!linebuf) return errno;
+
+    /* read and parse header line */
+    int err = freadline(linebuf, line_max, streamtype, stream);
+    if (err) { free(linebuf); return err; }
+    char * s = linebuf;
+    char * t = s;
+    if (strncmp("%%MatrixMarket ", t, strlen("%%MatrixMarket ")) == 0) {
+        t += strlen("%%MatrixMarket ");
+    } else { free(linebuf); return EINVAL; }
+    if (bytes_read) *bytes_read += t-s;
+    s = t;
+    if (strncmp("matrix ", t, strlen("matrix ")) == 0) {
+        t += strlen("matrix ");
+        *object = mtxmatrix;
+    } else if (strncmp("vector ", t, strlen("vector ")) == 0) {
+        t += strlen("vector ");
+        *object = mtxvector;
+    } else { free(linebuf); return EINVAL; }
+    if (bytes_read) *bytes_read += t-s;
+    s = t;
+    if (strncmp("array ", t, strlen("array ")) == 0) {
+        t += strlen("array ");
+        *format = mtxarray;
+    } else if (strncmp("coordinate ", t, strlen("coordinate ")) == 0) {
+        t += strlen("coordinate ");
+        *format = mtxcoordinate;
+    } else { free(linebuf); return EINVAL; }
+    if (bytes_read) *bytes_read += t-s;
+    s = t;
+    if (strncmp("real ", t, strlen("real ")) == 0) {
+        t += strlen("real ");
+        *field = mtxreal;
+    } else if (strncmp("integer ", t, strlen("integer ")) == 0) {
+        t += strlen("integer ");
+        *field = mtxinteger;
+    } else if (strncmp("pattern ", t, strlen("pattern ")) == 0) {
+        t += strlen("pattern ");
+        *field = mtxpattern;
+    } else { free(linebuf); return EINVAL; }
+    if (bytes_read) *bytes_read += t-s;
+    s = t;
+    if (strncmp("general", t, strlen("general")) == 0) {
+        t += strlen("general");
+        *symmetry = mtxgeneral;
+    } else if (strncmp("symmetric", t, strlen("symmetric")) == 0) {
+        t += strlen("symmetric");
+        *symmetry = mtxsymmetric;
+    } else { free(linebuf); return EINVAL; }
+    if (bytes_read) *bytes_read += t-s;
+    s = t;
+
+    /* skip lines starting with '%' */
+    do {
+        if (lines_read) (*lines_read)++;
+        err = freadline(linebuf, line_max, streamtype, stream);
+        if (err) { free(linebuf); return err; }
+        s = t = linebuf;
+    } while (linebuf[0] == '%');
+
+    /* parse size line */
+    if (*object == mtxmatrix && *format == mtxcoordinate) {
+        err = parse_idx_t(num_rows, s, &t, bytes_read);
+        if (err) { free(linebuf); return err; }
+        if (s == t || *t != ' ') { free(linebuf); return EINVAL; }
+        if (bytes_read) (*bytes_read)++;
+        s = t+1;
+        err = parse_idx_t(num_columns, s, &t, bytes_read);
+        if (err) { free(linebuf); return err; }
+        if (s == t || *t != ' ') { free(linebuf); return EINVAL; }
+        if (bytes_read) (*bytes_read)++;
+        s = t+1;
+        err = parse_int64_t(num_nonzeros, s, &t, bytes_read);
+        if (err) { free(linebuf); return err; }
+        if (s == t) { free(linebuf); return EINVAL; }
+        if (lines_read) (*lines_read)++;
+    } else if (*object == mtxvector && *format == mtxarray) {
+        err = parse_idx_t(num_rows, s, &t, bytes_read);
+        if (err) { free(linebuf); return err; }
+        if (s == t) { free(linebuf); return EINVAL; }
+        if (lines_read) (*lines_read)++;
+    } else if (*object == mtxmatrix && *format == mtxarray) {
+        err = parse_idx_t(num_rows, s, &t, bytes_read);
+        if (err) { free(linebuf); return err; }
+        if (s == t || *t != ' ') { free(linebuf); return EINVAL; }
+        if (bytes_read) (*bytes_read)++;
+        s = t+1;
+        err = parse_idx_t(num_columns, s, &t, bytes_read);
+        if (err) { free(linebuf); return err; }
+        if (s == t) { free(linebuf); return EINVAL; }
+        *num_nonzeros = (int64_t) (*num_rows) * (*num_columns);
+        if (lines_read) (*lines_read)++;
+    } else { free(linebuf); return EINVAL; }
+    free(linebuf);
+    return 0;
+}
+
+/*
+ * The data lines of Matrix Market files are read in blocks of
+ * MTXFILE_BLOCK_SIZE bytes, which are then parsed in parallel.  A
+ * single line may not be longer than a block.
+ */
+#ifndef MTXFILE_BLOCK_SIZE
+#define MTXFILE_BLOCK_SIZE (1 << 26)
+#endif
+
+/**
+ * ‘mtxfile_parse_data_line()’ parses a single data line of a Matrix
+ * Market file.
+ *
+ * For matrices in coordinate format, the row and column offsets are
+ * stored in ‘i’ and ‘j’, respectively, and they are checked to lie in
+ * the range [1,num_rows] and [1,num_columns].  For real and integer
+ * fields, the value is stored in ‘a’, whereas it is set to one for
+ * pattern matrices.  Any remaining characters on the line are
+ * ignored.  Finally, ‘endptr’ is set to point to the newline that ends
+ * the line (or the terminating null character of the final line).
+ */
+static inline int mtxfile_parse_data_line(
+    enum mtxformat format,
+    enum mtxfield field,
+    idx_t num_rows,
+    idx_t num_columns,
+    const char * s,
+    const char ** endptr,
+    idx_t * i,
+    idx_t * j,
+    double * a)
+{
+    int err;
+    if (format == mtxcoordinate) {
+        int64_t r, c;
+        err = parse_int64_t_fast(&r, s, &s);
+        if (err) return err;
+        if (r < 1 || r > num_rows) return EINVAL;
+        err = parse_int64_t_fast(&c, s, &s);
+        if (err) return err;
+        if (c < 1 || c > num_columns) return EINVAL;
+        *i = r; *j = c;
+    }
+    if (field == mtxreal) {
+        err = parse_double_fast(a, s, &s);
+        if (err) return err;
+    } else if (field == mtxinteger) {
+        int64_t y;
+        err = parse_int64_t_fast(&y, s, &s);
+        if (err) return err;
+        *a = y;
+    } else if (field == mtxpattern) {
+        *a = 1;
+    } else { return EINVAL; }
+    while (*s != '\n' && *s != '\0') s++;
+    *endptr = s;
+    return 0;
+}
+
+/**
+ * ‘mtxfile_fread_data()’ reads the data lines of a Matrix Market
+ * file.
+ *
+ * Rather than reading one line at a time, the stream is read in large
+ * blocks.  Each block is split at line boundaries into one part per
+ * thread, and, after counting the lines in every part to find out
+ * where its entries belong, the parts are parsed in parallel.
+ *
+ * For matrices in coordinate format, the row and column offsets of
+ * the ‘num_lines’ entries are stored in ‘rowidx’ and ‘colidx’, which
+ * are otherwise not used.  The values are stored in ‘a’.
+ */
+static int mtxfile_fread_data(
+    enum mtxformat format,
+    enum mtxfield field,
+    idx_t num_rows,
+    idx_t num_columns,
+    int64_t num_lines,
+    idx_t * rowidx,
+    idx_t * colidx,
+    double * a,
+    enum streamtype streamtype,
+    union stream stream,
+    int64_t * lines_read,
+    int64_t * bytes_read)
+{
+    if (format == mtxarray && field == mtxpattern) return EINVAL;
+    if (num_lines <= 0) return 0;
+
+    int nparts = 1;
+#ifdef _OPENMP
+    nparts = omp_get_max_threads();
+#endif
+    size_t blocksize = MTXFILE_BLOCK_SIZE;
+    char * buf = malloc(blocksize+1);
+    if (!buf) return errno;
+    size_t * partstart = malloc((nparts+1) * sizeof(size_t));
+    if (!partstart) { free(buf); return errno; }
+    int64_t * partoffset = malloc((nparts+1) * sizeof(int64_t));
+    if (!partoffset) { free(partstart); free(buf); return errno; }
+    int64_t * partbytes = malloc(nparts * sizeof(int64_t));
+    if (!partbytes) { free(partoffset); free(partstart); free(buf); return errno; }
+    int64_t * parterrline = malloc(nparts * sizeof(int64_t));
+    if (!parterrline) { free(partbytes); free(partoffset); free(partstart); free(buf); return errno; }
+    int * parterr = malloc(nparts * sizeof(int));
+    if (!parterr) { free(parterrline); free(partbytes); free(partoffset); free(partstart); free(buf); return errno; }
+
+    int err = 0;
+    int64_t k = 0;
+    size_t carry = 0;
+    bool eof = false;
+    while (k < num_lines && !err) {
+        /* fill the remainder of the buffer after any incomplete
+         * line that was carried over from the previous block */
+        size_t n = 0;
+        err = freadblock(buf+carry, blocksize-carry, &n, streamtype, stream);
+        if (err) break;
+        eof = n < blocksize-carry;
+        size_t len = carry+n;
+        buf[len] = '\0';
+        if (eof && len == 0) { err = EINVAL; break; }
+
+        /* find the end of the final complete line in the block */
+        size_t end = len;
+        if (!eof) {
+            while (end > 0 && buf[end-1] != '\n') end--;
+            if (end == 0) { err = EOVERFLOW; break; }
+        }
+
+        /* split the block into parts at line boundaries */
+        partstart[0] = 0;
+        for (int p = 1; p < nparts; p++) {
+            size_t q = p * (end / nparts);
+            if (q < partstart[p-1]) q = partstart[p-1];
+            while (q < end && q > 0 && buf[q-1] != '\n') q++;
+            partstart[p] = q;
+        }
+        partstart[nparts] = end;
+
+        /* count the lines in each part */
+#ifdef _OPENMP
+        #pragma omp parallel for
+#endif
+        for (int p = 0; p < nparts; p++) {
+            int64_t lines = 0;
+            const char * s = buf + partstart[p];
+            const char * t = buf + partstart[p+1];
+            while (s < t && (s = memchr(s, '\n', t-s))) { lines++; s++; }
+            if (partstart[p+1] > partstart[p] && buf[partstart[p+1]-1] != '\n') lines++;
+            partoffset[p+1] = lines;
+        }
+        partoffset[0] = k;
+        for (int p = 1; p <= nparts; p++) partoffset[p] += partoffset[p-1];
+
+        /* parse the lines in each part */
+#ifdef _OPENMP
+        #pragma omp parallel for
+#endif
+        for (int p = 0; p < nparts; p++) {
+            const char * s = buf + partstart[p];
+            const char * t = buf + partstart[p+1];
+            parterr[p] = 0;
+            for (int64_t l = partoffset[p]; s < t && l < num_lines; l++) {
+                int priverr = (format == mtxcoordinate)
+                    ? mtxfile_parse_data_line(
+                        format, field, num_rows, num_columns,
+                        s, &s, &rowidx[l], &colidx[l], &a[l])
+                    : mtxfile_parse_data_line(
+                        format, field, num_rows, num_columns,
+                        s, &s, NULL, NULL, &a[l]);
+                if (priverr) { parterr[p] = priverr; parterrline[p] = l; break; }
+                if (*s == '\n') s++;
+            }
+            partbytes[p] = s - (buf + partstart[p]);
+        }
+        for (int p = 0; p < nparts; p++) {
+            if (parterr[p]) { err = parterr[p]; k = parterrline[p]; break; }
+            if (bytes_read) *bytes_read += partbytes[p];
+        }
+        if (err) break;
+        k = partoffset[nparts] < num_lines ? partoffset[nparts] : num_lines;
+
+        /* carry any incomplete line over to the next block */
+        carry = len-end;
+        memmove(buf, buf+end, carry);
+        if (eof && k < num_lines) { err = EINVAL; break; }
+    }
+    if (lines_read) *lines_read += k;
+    free(parterr); free(parterrline); free(partbytes);
+    free(partoffset); free(partstart); free(buf);
+    return err;
+}
+
+static int mtxfile_fread_matrix_coordinate(
+    enum mtxfield field,
+    idx_t num_rows,
+    idx_t num_columns,
+    int64_t num_nonzeros,
+    idx_t * rowidx,
+    idx_t * colidx,
+    double * a,
+    enum streamtype streamtype,
+    union stream stream,
+    int64_t * lines_read,
+    int64_t * bytes_read)
+{
+    return mtxfile_fread_data(
+        mtxcoordinate, field, num_rows, num_columns, num_nonzeros,
+        rowidx, colidx, a, streamtype, stream, lines_read, bytes_read);
+}
+
+/**
+ * ‘mtxfile_fread_matrix_array()’ reads the data lines of a dense
+ * matrix in array format.
+ *
+ * Since Matrix Market files store dense matrices in column-major
+ * order, the matrix is transposed, so that the ‘num_columns’ values
+ * of each row are stored contiguously in ‘x’.  Values are parsed in
+ * double precision and, if needed, rounded to the type of ‘x’.
+ */
+static int mtxfile_fread_matrix_array(
+    enum mtxfield field,
+    idx_t num_rows,
+    idx_t num_columns,
+    vec_t * x,
+    enum streamtype streamtype,
+    union stream stream,
+    int64_t * lines_read,
+    int64_t * bytes_read)
+{
+#if VECTYPEWIDTH == 64
+    if (num_columns == 1) {
+        return mtxfile_fread_data(
+            mtxarray, field, num_rows, 1, num_rows,
+            NULL, NULL, x, streamtype, stream, lines_read, bytes_read);
+    }
+#endif
+    int64_t size = (int64_t) num_rows * num_columns;
+    double * a = malloc(size * sizeof(double));
+    if (!a) return errno;
+    int err = mtxfile_fread_data(
+        mtxarray, field, num_rows, num_columns, size,
+        NULL, NULL, a, streamtype, stream, lines_read, bytes_read);
+    if (err) { free(a); return err; }
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for (idx_t i = 0; i < num_rows; i++) {
+        for (idx_t j = 0; j < num_columns; j++)
+            x[(int64_t) i*num_columns+j] = a[(int64_t) j*num_rows+i];
+    }
+    free(a);
+    return 0;
+}
+
+static int mtxfile_fread_vector_array(
+    enum mtxfield field,
+    idx_t num_rows,
+    vec_t * x,
+    enum streamtype streamtype,
+    union stream stream,
+    int64_t * lines_read,
+    int64_t * bytes_read)
+{
+    return mtxfile_fread_matrix_array(
+        field, num_rows, 1, x, streamtype, stream, lines_read, bytes_read);
+}
+
+/*
+ * synthetic matrices
+ */
+
+/**
+ * ‘generate_hash()’ is the SplitMix64 mixing function, which is used
+ * to obtain pseudo-random numbers from the position of each nonzero,
+ * so that a generated matrix does not depend on the number of threads.
+ */
+static inline uint64_t generate_hash(
+    uint64_t x)
+{
+    x += UINT64_C(0x9e3779b97f4a7c15);
+    x = (x ^ (x >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    x = (x ^ (x >> 27)) * UINT64_C(0x94d049bb133111eb);
+    return x ^ (x >> 31);
+}
+
+/**
+ * ‘generate_uniform()’ is a pseudo-random number in ‘[0,1)’.
+ */
+static inline double generate_uniform(
+    uint64_t x)
+{
+    return (generate_hash(x) >> 11) * 0x1.0p-53;
+}
+
+/**
+ * ‘generate_row()’ generates the nonzeros of the ‘i’-th row (counting
+ * from zero) of a stencil or banded matrix, and returns the number of
+ * nonzeros in the row.  The 1-based column offsets and the values are
+ * stored in ‘colidx’ and ‘a’, unless these are ‘NULL’, in which case
+ * the nonzeros are only counted.
+ *
+ * Stencil matrices have the value 4, 6 or 26 on the diagonal and -1
+ * elsewhere.  A banded matrix has ‘rowsize’ nonzeros with random
+ * values in each row, or fewer if the band is narrower, and the
+ * columns are chosen at random from equal parts of the band, so that
+ * they are distinct and sorted.
+ */
+static int64_t generate_row(
+    enum generator generator,
+    int64_t n,
+    int64_t bandwidth,
+    int64_t rowsize,
+    int64_t i,
+    idx_t * colidx,
+    double * a)
+{
+    int64_t k = 0;
+    if (generator == generate_5pt) {
+        int64_t x = i % n, y = i / n;
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                if (abs(dx) + abs(dy) > 1) continue;
+                if (x+dx < 0 || x+dx >= n || y+dy < 0 || y+dy >= n) continue;
+                if (colidx) {
+                    colidx[k] = (y+dy)*n + (x+dx) + 1;
+                    a[k] = (dx == 0 && dy == 0) ? 4.0 : -1.0;
+                }
+                k++;
+            }
+        }
+    } else if (generator == generate_7pt || generator == generate_27pt) {
+        int64_t x = i % n, y = (i / n) % n, z = i / (n*n);
+        for (int dz = -1; dz <= 1; dz++) {
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    int d = abs(dx) + abs(dy) + abs(dz);
+                    if (generator == generate_7pt && d > 1) continue;
+                    if (x+dx < 0 || x+dx >= n || y+dy < 0 || y+dy >= n ||
+                        z+dz < 0 || z+dz >= n)
+                        continue;
+                    if (colidx) {
+                        colidx[k] = ((z+dz)*n + (y+dy))*n + (x+dx) + 1;
+                        a[k] = d > 0 ? -1.0 : (generator == generate_7pt ? 6.0 : 26.0);
+                    }
+                    k++;
+                }
+            }
+        }
+    } else if (generator == generate_banded) {
+        int64_t lo = i-bandwidth < 0 ? 0 : i-bandwidth;
+        int64_t hi = i+bandwidth >= n ? n-1 : i+bandwidth;
+        int64_t w = hi-lo+1;
+        int64_t d = rowsize < w ? rowsize : w;
+        for (int64_t l = 0; l < d; l++) {
+            if (colidx) {
+                uint64_t seed = 2*((uint64_t) i*rowsize+l);
+                int64_t start = lo + l*w/d, end = lo + (l+1)*w/d;
+                colidx[k] = start + (int64_t) (generate_uniform(seed) * (end-start)) + 1;
+                a[k] = 2.0*generate_uniform(seed+1) - 1.0;
+            }
+            k++;
+        }
+    }
+    return k;
+}
+
+/**
+ * ‘generate_size()’ computes the size of a generated matrix.
+ *
+ * The matrix has ‘n’ rows for ‘generate_banded’, ‘n^2’ rows for
+ * ‘generate_5pt’, ‘n^3’ rows for ‘generate_7pt’ and ‘generate_27pt’,
+ * and ‘2^n’ rows for ‘generate_rmat’.  If the size does not fit in
+ * the integer type used for row and column offsets, then ‘EOVERFLOW’
+ * is returned.
+ */
+static int generate_size(
+    enum generator generator,
+    int64_t n,
+    int64_t bandwidth,
+    int64_t rowsize,
+    idx_t * num_rows,
+    idx_t * num_columns,
+    int64_t * num_nonzeros)
+{
+    int64_t m;
+    if (generator == generate_5pt) {
+        if (n > IDX_T_MAX / n) return EOVERFLOW;
+        m = n*n;
+    } else if (generator == generate_7pt || generator == generate_27pt) {
+        if (n > IDX_T_MAX / n || n*n > IDX_T_MAX / n) return EOVERFLOW;
+        m = n*n*n;
+    } else if (generator == generate_banded) {
+        if (n > IDX_T_MAX) return EOVERFLOW;
+        m = n;
+    } else if (generator == generate_rmat) {
+        if (n >= 63 || (INT64_C(1) << n) > IDX_T_MAX) return EOVERFLOW;
+        m = INT64_C(1) << n;
+        if (rowsize > INT64_MAX / m) return EOVERFLOW;
+        *num_rows = *num_columns = m;
+        *num_nonzeros = m*rowsize;
+        return 0;
+    } else { return EINVAL; }
+
+    int64_t nnz = 0;
+#ifdef _OPENMP
+    #pragma omp parallel for reduction(+:nnz)
+#endif
+    for (int64_t i = 0; i < m; i++)
+        nnz += generate_row(generator, n, bandwidth, rowsize, i, NULL, NULL);
+    *num_rows = *num_columns = m;
+    *num_nonzeros = nnz;
+    return 0;
+}
+
+/**
+ * ‘generate_matrix()’ generates a matrix in coordinate format with
+ * 1-based row and column offsets, whose size was first obtained with
+ * ‘generate_size()’.
+ *
+ * Stencil and banded matrices are generated row by row, in order,
+ * after counting the nonzeros of each row.  For ‘generate_rmat’, each
+ * nonzero is placed by recursively choosing one of the four quadrants
+ * of the matrix with the probabilities 0.57, 0.19, 0.19 and 0.05, as
+ * in the Graph500 benchmark, which results in a power-law distribution
+ * of nonzeros per row.  The vertices are not permuted, and duplicate
+ * nonzeros are kept, so that there are ‘rowsize’ nonzeros per row on
+ * average.
+ */
+static int generate_matrix(
+    enum generator generator,
+    int64_t n,
+    int64_t bandwidth,
+    int64_t rowsize,
+    idx_t num_rows,
+    int64_t num_nonzeros,
+    idx_t * rowidx,
+    idx_t * colidx,
+    double * a)
+{
+    if (generator == generate_rmat) {
+#ifdef _OPENMP
+        #pragma omp parallel for
+#endif
+        for (int64_t k = 0; k < num_nonzeros; k++) {
+            uint64_t seed = (uint64_t) k*(n+1);
+            int64_t i = 0, j = 0;
+            for (int l = 0; l < n; l++) {
+                double u = generate_uniform(seed+l);
+                i = 2*i + (u >= 0.76);
+                j = 2*j + ((u >= 0.57 && u < 0.76) || u >= 0.95);
+            }
+            rowidx[k] = i+1;
+            colidx[k] = j+1;
+            a[k] = 2.0*generate_uniform(seed+n) - 1.0;
+        }
+        return 0;
+    }
+
+    int64_t * rowptr = malloc((num_rows+1) * sizeof(int64_t));
+    if (!rowptr) return errno;
+    rowptr[0] = 0;
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for (idx_t i = 0; i < num_rows; i++)
+        rowptr[i+1] = generate_row(generator, n, bandwidth, rowsize, i, NULL, NULL);
+    for (idx_t i = 0; i < num_rows; i++) rowptr[i+1] += rowptr[i];
+    if (rowptr[num_rows] != num_nonzeros) { free(rowptr); return EINVAL; }
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for (idx_t i = 0; i < num_rows; i++) {
+        int64_t k = rowptr[i];
+        generate_row(generator, n, bandwidth, rowsize, i, &colidx[k], &a[k]);
+        for (; k < rowptr[i+1]; k++) rowidx[k] = i+1;
+    }
+    free(rowptr);
+    return 0;
+}
+
+/*
+ * matrix reordering
+ */
+
+/**
+ * ‘coo_bandwidth()’ computes the bandwidth and profile of a square
+ * matrix in coordinate format, with 1-based row and column offsets.
+ *
+ * The bandwidth is the largest distance from a nonzero to the
+ * diagonal, and the profile is the sum, over every row, of the
+ * distance from the leftmost nonzero to the diagonal.  Both are
+ * computed for the symmetric sparsity pattern of ‘A+A'’, so that the
+ * result is the same whether a symmetric matrix is stored by its
+ * lower or upper triangle.
+ */
+static int coo_bandwidth(
+    idx_t num_rows,
+    int64_t num_nonzeros,
+    const idx_t * rowidx,
+    const idx_t * colidx,
+    idx_t * bandwidth,
+    int64_t * profile)
+{
+    idx_t * firstcol = malloc(num_rows * sizeof(idx_t));
+    if (!firstcol) return errno;
+    for (idx_t i = 0; i < num_rows; i++) firstcol[i] = i;
+    idx_t maxdist = 0;
+    for (int64_t k = 0; k < num_nonzeros; k++) {
+        idx_t i = rowidx[k]-1, j = colidx[k]-1;
+        if (i < j) { idx_t t = i; i = j; j = t; }
+        if (firstcol[i] > j) firstcol[i] = j;
+        if (maxdist < i-j) maxdist = i-j;
+    }
+    int64_t sum = 0;
+    for (idx_t i = 0; i < num_rows; i++) sum += i-firstcol[i];
+    free(firstcol);
+    *bandwidth = maxdist;
+    *profile = sum;
+    return 0;
+}
+
+/**
+ * ‘rcm_bfs()’ performs a breadth-first search of the graph with
+ * ‘num_nodes’ nodes and the adjacency lists ‘adj[adjptr[i]]’ up to
+ * ‘adj[adjptr[i]+degree[i]-1]’, starting from the node ‘root’.
+ *
+ * Nodes are visited only if ‘level’ is negative, and the level of
+ * every visited node is stored in ‘level’.  The visited nodes are
+ * stored in ‘queue’ in the order in which they are visited, where the
+ * neighbours of each node are visited by increasing degree, as in
+ * the Cuthill-McKee ordering.  The number of visited nodes is
+ * returned in ‘num_visited’, and the eccentricity of ‘root’ (i.e.,
+ * the highest level) is returned.
+ */
+static idx_t rcm_bfs(
+    idx_t num_nodes,
+    const int64_t * adjptr,
+    const idx_t * degree,
+    const idx_t * adj,
+    idx_t root,
+    idx_t * level,
+    idx_t * queue,
+    idx_t * num_visited)
+{
+    idx_t head = 0, tail = 0;
+    queue[tail++] = root;
+    level[root] = 0;
+    while (head < tail) {
+        idx_t u = queue[head++];
+        idx_t first = tail;
+        for (int64_t k = adjptr[u]; k < adjptr[u]+degree[u]; k++) {
+            idx_t v = adj[k];
+            if (level[v] >= 0) continue;
+            level[v] = level[u]+1;
+            /* insert by increasing degree among the new neighbours */
+            idx_t l = tail++;
+            while (l > first && degree[queue[l-1]] > degree[v]) {
+                queue[l] = queue[l-1];
+                l--;
+            }
+            queue[l] = v;
+        }
+    }
+    *num_visited = tail;
+    return level[queue[tail-1]];
+}
+
+/**
+ * ‘rcm()’ computes a Reverse Cuthill-McKee ordering of the rows and
+ * columns of a square matrix in coordinate format, with 1-based row
+ * and column offsets, to reduce its bandwidth.
+ *
+ * The ordering is computed for the symmetric sparsity pattern of
+ * ‘A+A'’.  Each connected component is ordered by a breadth-first
+ * search from a pseudo-peripheral node, which is found with the
+ * algorithm of George and Liu, starting from a node of minimum
+ * degree.  On return, ‘perm[i]’ is the original offset of the row
+ * and column that is placed at offset ‘i’.
+ */
+static int rcm(
+    idx_t num_rows,
+    int64_t num_nonzeros,
+    const idx_t * rowidx,
+    const idx_t * colidx,
+    idx_t * perm)
+{
+    /* build the adjacency lists of A+A', without the diagonal */
+    int64_t * adjptr = malloc((num_rows+1) * sizeof(int64_t));
+    if (!adjptr) return errno;
+    for (idx_t i = 0; i <= num_rows; i++) adjptr[i] = 0;
+    for (int64_t k = 0; k < num_nonzeros; k++) {
+        if (rowidx[k] != colidx[k]) { adjptr[rowidx[k]]++; adjptr[colidx[k]]++; }
+    }
+    for (idx_t i = 1; i <= num_rows; i++) adjptr[i] += adjptr[i-1];
+    idx_t * adj = malloc(adjptr[num_rows] * sizeof(idx_t));
+    if (!adj) { free(adjptr); return errno; }
+    idx_t * degree = malloc(num_rows * sizeof(idx_t));
+    if (!degree) { free(adj); free(adjptr); return errno; }
+    idx_t * level = malloc(num_rows * sizeof(idx_t));
+    if (!level) { free(degree); free(adj); free(adjptr); return errno; }
+    for (idx_t i = 0; i < num_rows; i++) degree[i] = 0;
+    for (int64_t k = 0; k < num_nonzeros; k++) {
+        idx_t i = rowidx[k]-1, j = colidx[k]-1;
+        if (i == j) continue;
+        adj[adjptr[i]+degree[i]++] = j;
+        adj[adjptr[j]+degree[j]++] = i;
+    }
+
+    /*
+     * remove duplicate neighbours, which arise from nonzeros that are
+     * stored in both triangles, by marking each node's neighbours
+     */
+    for (idx_t i = 0; i < num_rows; i++) level[i] = -1;
+    for (idx_t i = 0; i < num_rows; i++) {
+        idx_t n = 0;
+        for (int64_t k = adjptr[i]; k < adjptr[i]+degree[i]; k++) {
+            idx_t j = adj[k];
+            if (level[j] == i) continue;
+            level[j] = i;
+            adj[adjptr[i]+n++] = j;
+        }
+        degree[i] = n;
+    }
+    for (idx_t i = 0; i < num_rows; i++) level[i] = -1;
+
+    /* visit the nodes by increasing degree to find starting nodes */
+    idx_t maxdegree = 0;
+    for (idx_t i = 0; i < num_rows; i++)
+        maxdegree = maxdegree >= degree[i] ? maxdegree : degree[i];
+    idx_t * bydegree = malloc(num_rows * sizeof(idx_t));
+    if (!bydegree) { free(level); free(degree); free(adj); free(adjptr); return errno; }
+    idx_t * degreeptr = malloc((maxdegree+2) * sizeof(idx_t));
+    if (!degreeptr) { free(bydegree); free(level); free(degree); free(adj); free(adjptr); return errno; }
+    for (idx_t d = 0; d <= maxdegree+1; d++) degreeptr[d] = 0;
+    for (idx_t i = 0; i < num_rows; i++) degreeptr[degree[i]+1]++;
+    for (idx_t d = 1; d <= maxdegree+1; d++) degreeptr[d] += degreeptr[d-1];
+    for (idx_t i = 0; i < num_rows; i++) bydegree[degreeptr[degree[i]]++] = i;
+    free(degreeptr);
+
+    idx_t num_ordered = 0;
+    for (idx_t s = 0; s < num_rows; s++) {
+        idx_t root = bydegree[s];
+        if (level[root] >= 0) continue;
+
+        /* find a pseudo-peripheral node, starting from the root */
+        idx_t * queue = &perm[num_ordered];
+        idx_t num_visited;
+        idx_t eccentricity = rcm_bfs(
+            num_rows, adjptr, degree, adj, root, level, queue, &num_visited);
+        while (true) {
+            idx_t candidate = queue[num_visited-1];
+            for (idx_t l = num_visited-1; l >= 0 && level[queue[l]] == eccentricity; l--) {
+                if (degree[queue[l]] < degree[candidate]) candidate = queue[l];
+            }
+            for (idx_t l = 0; l < num_visited; l++) level[queue[l]] = -1;
+            idx_t e = rcm_bfs(
+                num_rows, adjptr, degree, adj, candidate, level, queue, &num_visited);
+            if (e <= eccentricity) {
+                /* the candidate is no better, so reorder from the root */
+                for (idx_t l = 0; l < num_visited; l++) level[queue[l]] = -1;
+                rcm_bfs(num_rows, adjptr, degree, adj, root, level, queue, &num_visited);
+                break;
+            }
+            root = candidate;
+            eccentricity = e;
+        }
+        num_ordered += num_visited;
+    }
+    free(bydegree); free(level); free(degree); free(adj); free(adjptr);
+
+    /* reverse the Cuthill-McKee ordering */
+    for (idx_t i = 0; i < num_rows/2; i++) {
+        idx_t t = perm[i];
+        perm[i] = perm[num_rows-1-i];
+        perm[num_rows-1-i] = t;
+    }
+    return 0;
+}
+
+/**
+ * ‘coo_permute()’ applies a symmetric permutation to the rows and
+ * columns of a square matrix in coordinate format, with 1-based row
+ * and column offsets, so that the row and column at the offset
+ * ‘perm[i]’ are moved to the offset ‘i’.
+ */
+static int coo_permute(
+    idx_t num_rows,
+    int64_t num_nonzeros,
+    idx_t * rowidx,
+    idx_t * colidx,
+    const idx_t * perm)
+{
+    idx_t * iperm = malloc(num_rows * sizeof(idx_t));
+    if (!iperm) return errno;
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for (idx_t i = 0; i < num_rows; i++) iperm[perm[i]] = i;
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for (int64_t k = 0; k < num_nonzeros; k++) {
+        rowidx[k] = iperm[rowidx[k]-1]+1;
+        colidx[k] = iperm[colidx[k]-1]+1;
+    }
+    free(iperm);
+    return 0;
+}
+
+/**
+ * ‘vector_permute()’ permutes the rows of ‘x’, which consists of
+ * ‘num_vectors’ values per row, in the same way as ‘coo_permute()’.
+ * If ‘inverse’ is true, the inverse permutation is applied instead,
+ * which restores the original order.
+ */
+static int vector_permute(
+    idx_t num_rows,
+    int num_vectors,
+    vec_t * x,
+    const idx_t * perm,
+    bool inverse)
+{
+    vec_t * tmp = malloc((size_t) num_rows*num_vectors * sizeof(vec_t));
+    if (!tmp) return errno;
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for (int64_t k = 0; k < (int64_t) num_rows*num_vectors; k++) tmp[k] = x[k];
+    if (inverse) {
+#ifdef _OPENMP
+        #pragma omp parallel for
+#endif
+        for (idx_t i = 0; i < num_rows; i++) {
+            for (int v = 0; v < num_vectors; v++)
+                x[(int64_t) perm[i]*num_vectors+v] = tmp[(int64_t) i*num_vectors+v];
+        }
+    } else {
+#ifdef _OPENMP
+        #pragma omp parallel for
+#endif
+        for (idx_t i = 0; i < num_rows; i++) {
+            for (int v = 0; v < num_vectors; v++)
+                x[(int64_t) i*num_vectors+v] = tmp[(int64_t) perm[i]*num_vectors+v];
+        }
+    }
+    free(tmp);
+    return 0;
+}
+
+/*
+ * parallel conversion from coordinate format
+ */
+
+/**
+ * ‘prefix_sum()’ replaces each of the ‘n’ elements of ‘x’ with the
+ * sum of itself and the preceding elements. Each thread first sums a
+ * block of consecutive elements, and the sums of the blocks are then
+ * added to the elements of the subsequent blocks.
+ */
+static int prefix_sum(
+    int64_t n,
+    int64_t * x)
+{
+#ifdef _OPENMP
+    int num_threads = omp_get_max_threads();
+    int64_t * blocksums = malloc((num_threads+1) * sizeof(int64_t));
+    if (!blocksums) return errno;
+    #pragma omp parallel num_threads(num_threads)
+    {
+        int nt = omp_get_num_threads(), t = omp_get_thread_num();
+        int64_t start = n*t/nt, end = n*(t+1)/nt;
+        for (int64_t k = start+1; k < end; k++) x[k] += x[k-1];
+        blocksums[t+1] = end > start ? x[end-1] : 0;
+        #pragma omp barrier
+        #pragma omp single
+        {
+            blocksums[0] = 0;
+            for (int p = 1; p <= nt; p++) blocksums[p] += blocksums[p-1];
+        }
+        for (int64_t k = start; k < end; k++) x[k] += blocksums[t];
+    }
+    free(blocksums);
+#else
+    for (int64_t k = 1; k < n; k++) x[k] += x[k-1];
+#endif
+    return 0;
+}
+
+/**
+ * ‘coo_num_chunks()’ is the number of chunks of consecutive nonzeros
+ * that are converted from coordinate format in parallel. There is one
+ * chunk per thread, unless the row counts of every chunk, which take
+ * up one integer per row, would need more storage than the nonzeros.
+ */
+static int coo_num_chunks(
+    idx_t num_rows,
+    int64_t num_nonzeros)
+{
+#ifdef _OPENMP
+    int num_chunks = omp_get_max_threads();
+#else
+    int num_chunks = 1;
+#endif
+    int64_t max_chunks = num_rows > 0 ? num_nonzeros / num_rows : 1;
+    if (num_chunks > max_chunks) num_chunks = max_chunks > 1 ? max_chunks : 1;
+    return num_chunks;
+}
+
+/**
+ * ‘coo_count_chunks()’ counts the nonzeros of every row in each of
+ * ‘num_chunks’ chunks of consecutive nonzeros of a matrix in
+ * coordinate format, not including diagonal nonzeros if they are
+ * stored separately. The count for the ‘i’-th row and the ‘c’-th
+ * chunk is stored in ‘counts[c*num_rows+i]’, and every thread counts
+ * the nonzeros of one chunk.
+ */
+static void coo_count_chunks(
+    idx_t num_rows,
+    int64_t num_nonzeros,
+    const idx_t * __restrict rowidx,
+    const idx_t * __restrict colidx,
+    bool separate_diagonal,
+    int num_chunks,
+    int64_t * __restrict counts)
+{
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static,1)
+#endif
+    for (int c = 0; c < num_chunks; c++) {
+        int64_t * chunkcounts = &counts[(int64_t) c*num_rows];
+        for (idx_t i = 0; i < num_rows; i++) chunkcounts[i] = 0;
+        int64_t start = num_nonzeros*c/num_chunks, end = num_nonzeros*(c+1)/num_chunks;
+        for (int64_t k = start; k < end; k++) {
+            if (!separate_diagonal || rowidx[k] != colidx[k])
+                chunkcounts[rowidx[k]-1]++;
+        }
+    }
+}
+
+/**
+ * ‘coo_row_lengths()’ counts the nonzeros of every row of a matrix in
+ * coordinate format, not including diagonal nonzeros if they are
+ * stored separately. The number of nonzeros in the ‘i’-th row is
+ * stored in ‘rowptr[i+1]’, and ‘rowptr[0]’ is set to zero.
+ */
+static int coo_row_lengths(
+    idx_t num_rows,
+    int64_t num_nonzeros,
+    const idx_t * __restrict rowidx,
+    const idx_t * __restrict colidx,
+    bool separate_diagonal,
+    int64_t * __restrict rowptr)
+{
+    int num_chunks = coo_num_chunks(num_rows, num_nonzeros);
+    int64_t * counts = malloc((size_t) num_chunks*num_rows * sizeof(int64_t));
+    if (!counts) return errno;
+    coo_count_chunks(
+        num_rows, num_nonzeros, rowidx, colidx, separate_diagonal, num_chunks, counts);
+    rowptr[0] = 0;
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for (idx_t i = 0; i < num_rows; i++) {
+        int64_t rowlen = 0;
+        for (int c = 0; c < num_chunks; c++) rowlen += counts[(int64_t) c*num_rows+i];
+        rowptr[i+1] = rowlen;
+    }
+    free(counts);
+    return 0;
+}
+
+/**
+ * ‘coo_gather_rows()’ stores the nonzeros of every row of a matrix in
+ * coordinate format contiguously in ‘dstcolidx’ and ‘dsta’, starting
+ * at ‘rowptr[i]’ for the ‘i’-th row or, if ‘rowsize’ is positive, at
+ * ‘i*rowsize’. Diagonal nonzeros are added to ‘ad’ instead, if they
+ * are stored separately.
+ *
+ * Every thread stores the nonzeros of a chunk of consecutive
+ * nonzeros, starting at the offsets within each row that follow the
+ * nonzeros of the preceding chunks, so that the nonzeros of every row
+ * remain in the same order as in coordinate format.
+ */
+static int coo_gather_rows(
+    idx_t num_rows,
+    int64_t num_nonzeros,
+    const idx_t * __restrict rowidx,
+    const idx_t * __restrict colidx,
+    const double * __restrict a,
+    const int64_t * __restrict rowptr,
+    idx_t rowsize,
+    idx_t * __restrict dstcolidx,
+    val_t * __restrict dsta,
+    val_t * __restrict ad,
+    bool separate_diagonal)
+{
+    int num_chunks = coo_num_chunks(num_rows, num_nonzeros);
+    int64_t * counts = malloc((size_t) num_chunks*num_rows * sizeof(int64_t));
+    if (!counts) return errno;
+    coo_count_chunks(
+        num_rows, num_nonzeros, rowidx, colidx, separate_diagonal, num_chunks, counts);
+
+    /* find the offset to the first nonzero of each chunk in every row */
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for (idx_t i = 0; i < num_rows; i++) {
+        int64_t offset = rowsize > 0 ? (int64_t) i*rowsize : rowptr[i];
+        for (int c = 0; c < num_chunks; c++) {
+            int64_t count = counts[(int64_t) c*num_rows+i];
+            counts[(int64_t) c*num_rows+i] = offset;
+            offset += count;
+        }
+    }
+
+    /* store the nonzeros of each chunk */
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static,1)
+#endif
+    for (int c = 0; c < num_chunks; c++) {
+        int64_t * offsets = &counts[(int64_t) c*num_rows];
+        int64_t start = num_nonzeros*c/num_chunks, end = num_nonzeros*(c+1)/num_chunks;
+        for (int64_t k = start; k < end; k++) {
+            if (separate_diagonal && rowidx[k] == colidx[k]) {
+#ifdef _OPENMP
+                #pragma omp atomic
+#endif
+                ad[rowidx[k]-1] += a[k];
+            } else {
+                int64_t p = offsets[rowidx[k]-1]++;
+                dstcolidx[p] = colidx[k]-1;
+                dsta[p] = a[k];
+            }
+        }
+    }
+    free(counts);
+    return 0;
+}
+
+/**
+ * ‘ell_from_coo_size()’ computes the number of nonzeros per row of a
+ * matrix in ELLPACK format, which is the length of the longest row,
+ * and the offsets to the nonzeros of every row, as in CSR format.
+ */
+static int ell_from_coo_size(
+    idx_t num_rows,
+    idx_t num_columns,
+    int64_t num_nonzeros,
+    const idx_t * rowidx,
+    const idx_t * colidx,
+    const double * a,
+    int64_t * rowptr,
+    int64_t * ellsize,
+    idx_t * rowsize,
+    idx_t * diagsize,
+    bool separate_diagonal)
+{
+    int err = coo_row_lengths(
+        num_rows, num_nonzeros, rowidx, colidx, separate_diagonal, rowptr);
+    if (err) return err;
+    idx_t rowmax = 0;
+#ifdef _OPENMP
+    #pragma omp parallel for reduction(max:rowmax)
+#endif
+    for (idx_t i = 1; i <= num_rows; i++)
+        rowmax = rowmax >= rowptr[i] ? rowmax : rowptr[i];
+    err = prefix_sum(num_rows, &rowptr[1]);
+    if (err) return err;
+    *rowsize = rowmax;
+    *ellsize = num_rows * (*rowsize);
+    *diagsize = num_rows < num_columns ? num_rows : num_columns;
+    return 0;
+}
+
+/**
+ * ‘rowsort_row()’ sorts the ‘rowlen’ nonzeros of a single row by
+ * column, using a hybrid sort that first uses insertion sort to sort
+ * blocks of size ‘threshold’, and then switches to a bottom-up merge
+ * sort, with ‘tmpcolidx’ and ‘tmpa’ as temporary storage.
+ */
+static void rowsort_row(
+    idx_t rowlen,
+    idx_t threshold,
+    idx_t * __restrict colidx,
+    val_t * __restrict a,
+    idx_t * __restrict tmpcolidx,
+    val_t * __restrict tmpa)
+{
+    for (idx_t q = 0; q < rowlen-1; q += threshold) {
+        idx_t r = q+threshold < rowlen ? q+threshold : rowlen;
+        for (idx_t k = q+1; k < r; k++) {
+            idx_t j = colidx[k];
+            val_t b = a[k];
+            idx_t l = k-1;
+            while (l >= q && colidx[l] > j) {
+                colidx[l+1] = colidx[l];
+                a[l+1] = a[l];
+                l--;
+            }
+            colidx[l+1] = j;
+            a[l+1] = b;
+        }
+    }
+
+    for (idx_t p = threshold; p < rowlen; p*=2) {
+        for (idx_t k = 0; k < rowlen; k++) {
+            tmpcolidx[k] = colidx[k];
+            tmpa[k] = a[k];
+        }
+        for (idx_t q = 0; q < rowlen-1; q += 2*p) {
+            idx_t left = q;
+            idx_t middle = q+p < rowlen ? q+p : rowlen;
+            idx_t right = q+2*p < rowlen ? q+2*p : rowlen;
+            idx_t u = left, v = left, w = middle;
+            while (v < middle && w < right) {
+                if (tmpcolidx[v] < tmpcolidx[w]) {
+                    colidx[u] = tmpcolidx[v]; a[u] = tmpa[v++]; u++;
+                } else {
+                    colidx[u] = tmpcolidx[w]; a[u] = tmpa[w++]; u++;
+                }
+            }
+            while (v < middle) { colidx[u] = tmpcolidx[v]; a[u] = tmpa[v++]; u++; }
+            while (w < right) { colidx[u] = tmpcolidx[w]; a[u] = tmpa[w++]; u++; }
+        }
+    }
+}
+
+/**
+ * ‘rowsort()’ sorts the nonzeros of every row by column.
+ *
+ * Rows are sorted by one thread each, and they are distributed among
+ * threads with dynamic scheduling, because the time to sort a row
+ * grows with its length. However, rows with more than an even share
+ * of the nonzeros per thread are sorted afterwards by all threads
+ * together, one row at a time.
+ */
+static int rowsort(
+    idx_t num_rows,
+    idx_t num_columns,
+    int64_t * __restrict rowptr,
+    idx_t rowsizemax,
+    idx_t * __restrict colidx,
+    val_t * __restrict a)
+{
+    idx_t threshold = 1 << 4;
+#ifdef _OPENMP
+    int num_threads = omp_get_max_threads();
+#else
+    int num_threads = 1;
+#endif
+    int64_t longrow = rowptr[num_rows] / num_threads;
+    if (longrow < threshold) longrow = threshold;
+    idx_t tmpsize = rowsizemax < longrow ? rowsizemax : longrow;
+
+    /* sort all except the longest rows, with one thread per row */
+    idx_t * tmpcolidx = malloc((size_t) num_threads*tmpsize * sizeof(idx_t));
+    if (!tmpcolidx) return errno;
+    val_t * tmpa = malloc((size_t) num_threads*tmpsize * sizeof(val_t));
+    if (!tmpa) { free(tmpcolidx); return errno; }
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic,64)
+#endif
+    for (idx_t i = 0; i < num_rows; i++) {
+        idx_t rowlen = rowptr[i+1]-rowptr[i];
+        if (rowlen > longrow) continue;
+#ifdef _OPENMP
+        int t = omp_get_thread_num();
+#else
+        int t = 0;
+#endif
+        rowsort_row(
+            rowlen, threshold, &colidx[rowptr[i]], &a[rowptr[i]],
+            &tmpcolidx[(size_t) t*tmpsize], &tmpa[(size_t) t*tmpsize]);
+    }
+    free(tmpa); free(tmpcolidx);
+
+    if (rowsizemax <= longrow) return 0;
+
+    /* sort the longest rows, with all threads sorting each row together */
+    tmpcolidx = malloc(rowsizemax * sizeof(idx_t));
+    if (!tmpcolidx) return errno;
+    tmpa = malloc(rowsizemax * sizeof(val_t));
+    if (!tmpa) { free(tmpcolidx); return errno; }
+    #pragma omp parallel
+    for (idx_t i = 0; i < num_rows; i++) {
+        idx_t rowlen = rowptr[i+1]-rowptr[i];
+        if (rowlen <= longrow) continue;
+
+        /* #pragma omp single */
+        /* fprintf(stderr, "i=%d, rowlen=%d\n", i, rowlen); */
+
+        idx_t p = threshold;
+        #pragma omp for
+        for (idx_t q = 0; q < rowlen-1; q += p) {
+            idx_t r = q+p < rowlen ? q+p : rowlen;
+            for (int64_t k = q+1; k < r; k++) {
+                idx_t j = colidx[rowptr[i]+k];
+                val_t b = a[rowptr[i]+k];
+                int64_t l = rowptr[i]+k-1;
+                while (l >= rowptr[i]+q && colidx[l] > j) {
+                    colidx[l+1] = colidx[l];
+                    a[l+1] = a[l];
+                    l--;
+                }
+                colidx[l+1] = j;
+                a[l+1] = b;
+            }
+        }
+
+        for (; p < rowlen; p*=2) {
+            /* fprintf(stderr, "a) t=%d, i=%d, p=%d, rowlen=%d\n", omp_get_thread_num(), i, p, rowlen); */
+
+            #pragma omp for
+            for (idx_t k = 0; k < rowlen; k++) {
+                tmpcolidx[k] = colidx[rowptr[i]+k];
+                tmpa[k] = a[rowptr[i]+k];
+            }
+
+            #pragma omp for
+            for (idx_t q = 0; q < rowlen-1; q += 2*p) {
+                idx_t left = q;
+                idx_t middle = q+p < rowlen ? q+p : rowlen;
+                idx_t right = q+2*p < rowlen ? q+2*p : rowlen;
+
+                /* printf("i=%d: merging [", i); */
+                /* for (idx_t j = left; j < middle; j++) printf(" %d", tmpcolidx[j]); */
+                /* printf("] and ["); */
+                /* for (idx_t j = middle; j < right; j++) printf(" %d", tmpcolidx[j]); */
+                /* printf("] -> "); */
+
+                idx_t u = left, v = left, w = middle;
+                while (v < middle && w < right) {
+                    if (tmpcolidx[v] < tmpcolidx[w]) {
+                        colidx[rowptr[i]+u] = tmpcolidx[v]; a[rowptr[i]+u] = tmpa[v++]; u++;
+                    } else {
+                        colidx[rowptr[i]+u] = tmpcolidx[w]; a[rowptr[i]+u] = tmpa[w++]; u++;
+                    }
+                }
+                while (v < middle) {
+                    colidx[rowptr[i]+u] = tmpcolidx[v]; a[rowptr[i]+u] = tmpa[v++]; u++;
+                }
+                while (w < right) {
+                    colidx[rowptr[i]+u] = tmpcolidx[w]; a[rowptr[i]+u] = tmpa[w++]; u++;
+                }
+
+                /* printf("["); */
+                /* for (idx_t j = left; j < right; j++) printf(" %d", colidx[rowptr[i]+j]); */
+                /* printf("]\n"); */
+            }
+
+            /* fprintf(stderr, "b) t=%d, i=%d, p=%d, rowlen=%d\n", omp_get_thread_num(), i, p, rowlen); */
+        }
+    }
+    free(tmpa); free(tmpcolidx);
+
+#if 0
+    /* verify that rows are sorted */
+    for (idx_t i = 0; i < num_rows; i++) {
+        for (int64_t k = rowptr[i]+1; k < rowptr[i+1]; k++) {
+            if (colidx[k] < colidx[k-1]) return EINVAL;
+        }
+    }
+#endif
+    return 0;
+}
+
+static int ell_from_coo(
+    idx_t num_rows,
+    idx_t num_columns,
+    int64_t num_nonzeros,
+    const idx_t * rowidx,
+    const idx_t * colidx,
+    const double * a,
+    int64_t * rowptr,
+    int64_t ellsize,
+    idx_t rowsize,
+    idx_t * ellcolidx,
+    val_t * ella,
+    val_t * ellad,
+    bool separate_diagonal,
+    bool sort_rows,
+    bool column_major)
+{
+    int err = coo_gather_rows(
+        num_rows, num_nonzeros, rowidx, colidx, a, rowptr, rowsize,
+        ellcolidx, ella, ellad, separate_diagonal);
+    if (err) return err;
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for (idx_t i = 0; i < num_rows; i++) {
+        idx_t j =  i < num_columns ? i : num_columns-1;
+        for (int64_t l = rowptr[i+1]-rowptr[i]; l < rowsize; l++) {
+            ellcolidx[i*rowsize+l] = j;
+            ella[i*rowsize+l] = 0.0;
+        }
+    }
+
+    /* If requested, sort nonzeros by column within each row */
+    if (sort_rows) {
+#ifdef _OPENMP
+        #pragma omp parallel for
+#endif
+        for (idx_t i = 0; i <= num_rows; i++) rowptr[i] = i*rowsize;
+#ifdef HAVE_PAPI
+        PAPI_UTIL_region_begin("rowsort", NULL);
+        PAPI_UTIL_region_count("nonzeros", rowptr[num_rows]);
+#endif
+        err = rowsort(
+            num_rows, num_columns,
+            rowptr, rowsize, ellcolidx, ella);
+#ifdef HAVE_PAPI
+        PAPI_UTIL_region_end(NULL);
+#endif
+        if (err) return err;
+    }
+
+    /*
+     * If requested, transpose to column-major order, so that the
+     * ‘l’-th nonzero of the ‘i’-th row is stored at ‘l*num_rows+i’.
+     */
+    if (column_major) {
+        idx_t * tmpcolidx = malloc(ellsize * sizeof(idx_t));
+        if (!tmpcolidx) return errno;
+        val_t * tmpa = malloc(ellsize * sizeof(val_t));
+        if (!tmpa) { free(tmpcolidx); return errno; }
+#ifdef _OPENMP
+        #pragma omp parallel for
+#endif
+        for (idx_t i = 0; i < num_rows; i++) {
+            for (idx_t l = 0; l < rowsize; l++) {
+                tmpcolidx[i*rowsize+l] = ellcolidx[i*rowsize+l];
+                tmpa[i*rowsize+l] = ella[i*rowsize+l];
+            }
+        }
+#ifdef _OPENMP
+        #pragma omp parallel for
+#endif
+        for (idx_t i = 0; i < num_rows; i++) {
+            for (idx_t l = 0; l < rowsize; l++) {
+                ellcolidx[l*num_rows+i] = tmpcolidx[i*rowsize+l];
+                ella[l*num_rows+i] = tmpa[i*rowsize+l];
+            }
+        }
+        free(tmpa); free(tmpcolidx);
+    }
+    return 0;
+}
+
+/*
+ * sliced ELLPACK (SELL-C-σ) format
+ */
+
+struct sellrow
+{
+    int64_t rowlen;
+    idx_t row;
+};
+
+static int sellrow_compare(
+    const void * pa,
+    const void * pb)
+{
+    const struct sellrow * a = pa;
+    const struct sellrow * b = pb;
+    if (a->rowlen != b->rowlen) return a->rowlen > b->rowlen ? -1 : 1;
+    return (a->row > b->row) - (a->row < b->row);
+}
+
+/**
+ * ‘sell_from_coo_size()’ computes the row permutation and the offsets
+ * to each chunk for a matrix in sliced ELLPACK (SELL-C-σ) format.
+ *
+ * Rows are sorted by decreasing number of nonzeros within consecutive
+ * windows of ‘sigma’ rows, and ‘perm[k]’ is the original row of the
+ * ‘k’-th row in the sorted order. The sorted rows are then grouped
+ * into chunks of ‘chunksize’ rows, and every row of a chunk is padded
+ * to the length of the longest row in the chunk. The nonzeros of the
+ * ‘c’-th chunk are stored from ‘chunkptr[c]’ up to ‘chunkptr[c+1]’,
+ * and ‘chunkptr’ must therefore have room for one more than the
+ * number of chunks.
+ */
+static int sell_from_coo_size(
+    idx_t num_rows,
+    idx_t num_columns,
+    int64_t num_nonzeros,
+    const idx_t * rowidx,
+    const idx_t * colidx,
+    const double * a,
+    int64_t * rowptr,
+    idx_t chunksize,
+    idx_t sigma,
+    idx_t * perm,
+    int64_t * chunkptr,
+    int64_t * sellsize,
+    idx_t * rowsizemax,
+    idx_t * diagsize,
+    bool separate_diagonal)
+{
+    int err = coo_row_lengths(
+        num_rows, num_nonzeros, rowidx, colidx, separate_diagonal, rowptr);
+    if (err) return err;
+
+    /* sort rows by length within each window of sigma rows */
+    struct sellrow * rows = malloc(num_rows * sizeof(struct sellrow));
+    if (!rows) return errno;
+    for (idx_t i = 0; i < num_rows; i++) {
+        rows[i].rowlen = rowptr[i+1];
+        rows[i].row = i;
+    }
+    if (sigma > 1) {
+        for (idx_t w = 0; w < num_rows; w += sigma) {
+            idx_t n = num_rows - w < sigma ? num_rows - w : sigma;
+            qsort(&rows[w], n, sizeof(struct sellrow), sellrow_compare);
+        }
+    }
+    for (idx_t k = 0; k < num_rows; k++) perm[k] = rows[k].row;
+
+    /* pad each chunk to its longest row */
+    idx_t num_chunks = (num_rows + chunksize - 1) / chunksize;
+    idx_t rowmax = 0;
+    chunkptr[0] = 0;
+    for (idx_t c = 0; c < num_chunks; c++) {
+        idx_t chunklen = 0;
+        for (idx_t k = c*chunksize; k < num_rows && k < (c+1)*chunksize; k++)
+            chunklen = chunklen >= rows[k].rowlen ? chunklen : rows[k].rowlen;
+        chunkptr[c+1] = chunkptr[c] + (int64_t) chunklen * chunksize;
+        rowmax = rowmax >= chunklen ? rowmax : chunklen;
+    }
+    free(rows);
+
+    err = prefix_sum(num_rows, &rowptr[1]);
+    if (err) return err;
+    *rowsizemax = rowmax;
+    *sellsize = chunkptr[num_chunks];
+    *diagsize = num_rows < num_columns ? num_rows : num_columns;
+    return 0;
+}
+
+/**
+ * ‘sell_from_coo()’ converts a matrix from coordinate format to
+ * sliced ELLPACK (SELL-C-σ) format.
+ *
+ * The row permutation and chunk offsets must first be computed with
+ * ‘sell_from_coo_size()’. Within each chunk, nonzeros are stored in
+ * column-major order, so that the ‘l’-th nonzero of the ‘r’-th row of
+ * the ‘c’-th chunk is found at ‘chunkptr[c]+l*chunksize+r’.
+ */
+static int sell_from_coo(
+    idx_t num_rows,
+    idx_t num_columns,
+    int64_t num_nonzeros,
+    const idx_t * rowidx,
+    const idx_t * colidx,
+    const double * a,
+    int64_t * rowptr,
+    idx_t rowsizemax,
+    idx_t chunksize,
+    const idx_t * perm,
+    const int64_t * chunkptr,
+    idx_t * sellcolidx,
+    val_t * sella,
+    val_t * sellad,
+    bool separate_diagonal,
+    bool sort_rows)
+{
+    /* first, gather the nonzeros of each row, as in CSR format */
+    int64_t csrsize = rowptr[num_rows];
+    idx_t * csrcolidx = malloc(csrsize * sizeof(idx_t));
+    if (!csrcolidx) return errno;
+    val_t * csra = malloc(csrsize * sizeof(val_t));
+    if (!csra) { free(csrcolidx); return errno; }
+    int err = coo_gather_rows(
+        num_rows, num_nonzeros, rowidx, colidx, a, rowptr, 0,
+        csrcolidx, csra, sellad, separate_diagonal);
+    if (err) { free(csra); free(csrcolidx); return err; }
+
+    /* If requested, sort nonzeros by column within each row */
+    if (sort_rows) {
+#ifdef HAVE_PAPI
+        PAPI_UTIL_region_begin("rowsort", NULL);
+        PAPI_UTIL_region_count("nonzeros", rowptr[num_rows]);
+#endif
+        err = rowsort(
+            num_rows, num_columns,
+            rowptr, rowsizemax, csrcolidx, csra);
+#ifdef HAVE_PAPI
+        PAPI_UTIL_region_end(NULL);
+#endif
+        if (err) { free(csra); free(csrcolidx); return err; }
+    }
+
+    /* copy the rows of each chunk in column-major order */
+    idx_t num_chunks = (num_rows + chunksize - 1) / chunksize;
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for (idx_t c = 0; c < num_chunks; c++) {
+        idx_t chunklen = (chunkptr[c+1]-chunkptr[c]) / chunksize;
+        for (idx_t r = 0; r < chunksize; r++) {
+            idx_t k = c*chunksize+r;
+            idx_t i = k < num_rows ? perm[k] : 0;
+            idx_t rowlen = k < num_rows ? rowptr[i+1]-rowptr[i] : 0;
+            idx_t j = i < num_columns ? i : num_columns-1;
+            for (idx_t l = 0; l < rowlen; l++) {
+                sellcolidx[chunkptr[c]+l*chunksize+r] = csrcolidx[rowptr[i]+l];
+                sella[chunkptr[c]+l*chunksize+r] = csra[rowptr[i]+l];
+            }
+            for (idx_t l = rowlen; l < chunklen; l++) {
+                sellcolidx[chunkptr[c]+l*chunksize+r] = j;
+                sella[chunkptr[c]+l*chunksize+r] = 0.0;
+            }
+        }
+    }
+    free(csra); free(csrcolidx);
+    return 0;
+}
+
+/*
+ * hybrid ELLPACK and coordinate (HYB) format
+ */
+
+/**
+ * ‘hyb_from_coo_size()’ computes the number of nonzeros per row that
+ * are stored in the ELLPACK part of a matrix in hybrid (HYB) format,
+ * and the number of nonzeros that are left over for the coordinate
+ * part.
+ *
+ * If ‘width’ is positive, then up to ‘width’ nonzeros of each row
+ * are stored in ELLPACK format. Otherwise, the width is chosen from
+ * the histogram of row lengths to minimise the combined size of the
+ * ELLPACK part, including padding, and the coordinate part, where
+ * every nonzero also needs its row offset.
+ */
+static int hyb_from_coo_size(
+    idx_t num_rows,
+    idx_t num_columns,
+    int64_t num_nonzeros,
+    const idx_t * rowidx,
+    const idx_t * colidx,
+    const double * a,
+    int64_t * rowptr,
+    idx_t width,
+    int64_t * ellsize,
+    idx_t * rowsize,
+    idx_t * rowsizemax,
+    idx_t * diagsize,
+    int64_t * coosize,
+    bool separate_diagonal)
+{
+    int64_t size;
+    idx_t rowmax;
+    int err = ell_from_coo_size(
+        num_rows, num_columns, num_nonzeros, rowidx, colidx, a,
+        rowptr, &size, &rowmax, diagsize, separate_diagonal);
+    if (err) return err;
+
+    /* count the rows of each length */
+    int64_t * rowlengths = malloc((rowmax+1) * sizeof(int64_t));
+    if (!rowlengths) return errno;
+    for (idx_t l = 0; l <= rowmax; l++) rowlengths[l] = 0;
+    for (idx_t i = 0; i < num_rows; i++) rowlengths[rowptr[i+1]-rowptr[i]]++;
+
+    /*
+     * For every width K, compute the number of nonzeros beyond the
+     * first K nonzeros of each row, which are stored in coordinate
+     * format.
+     */
+    int64_t ellbytes = sizeof(idx_t) + sizeof(val_t);
+    int64_t coobytes = 2*sizeof(idx_t) + sizeof(val_t);
+    int64_t tail = rowptr[num_rows];
+    int64_t longer = num_rows - rowlengths[0];
+    idx_t bestwidth = 0;
+    int64_t besttail = tail;
+    int64_t bestbytes = tail*coobytes;
+    for (idx_t l = 1; l <= rowmax && (width <= 0 || l <= width); l++) {
+        tail -= longer;
+        longer -= rowlengths[l];
+        int64_t bytes = (int64_t) num_rows*l*ellbytes + tail*coobytes;
+        if (width > 0 || bytes < bestbytes) {
+            bestwidth = l;
+            besttail = tail;
+            bestbytes = bytes;
+        }
+    }
+    free(rowlengths);
+    *rowsize = bestwidth;
+    *rowsizemax = rowmax;
+    *ellsize = (int64_t) num_rows * bestwidth;
+    *coosize = besttail;
+    return 0;
+}
+
+/**
+ * ‘hyb_from_coo()’ converts a matrix from coordinate format to hybrid
+ * (HYB) format, where the first ‘rowsize’ nonzeros of each row are
+ * stored in ELLPACK format, and any remaining nonzeros are stored in
+ * coordinate format, sorted by row, in ‘coorowidx’, ‘coocolidx’ and
+ * ‘cooa’.
+ *
+ * The width of the ELLPACK part and the number of nonzeros in the
+ * coordinate part must first be computed with ‘hyb_from_coo_size()’.
+ * If ‘sort_rows’ is true, then nonzeros are sorted by column within
+ * each row before the matrix is split, and the ELLPACK part then
+ * contains the nonzeros with the lowest column offsets.
+ */
+static int hyb_from_coo(
+    idx_t num_rows,
+    idx_t num_columns,
+    int64_t num_nonzeros,
+    const idx_t * rowidx,
+    const idx_t * colidx,
+    const double * a,
+    int64_t * rowptr,
+    idx_t rowsize,
+    idx_t rowsizemax,
+    idx_t * ellcolidx,
+    val_t * ella,
+    val_t * ellad,
+    idx_t * coorowidx,
+    idx_t * coocolidx,
+    val_t * cooa,
+    bool separate_diagonal,
+    bool sort_rows,
+    bool column_major)
+{
+    /* first, gather the nonzeros of each row, as in CSR format */
+    int64_t csrsize = rowptr[num_rows];
+    idx_t * csrcolidx = malloc(csrsize * sizeof(idx_t));
+    if (!csrcolidx) return errno;
+    val_t * csra = malloc(csrsize * sizeof(val_t));
+    if (!csra) { free(csrcolidx); return errno; }
+    int err = coo_gather_rows(
+        num_rows, num_nonzeros, rowidx, colidx, a, rowptr, 0,
+        csrcolidx, csra, ellad, separate_diagonal);
+    if (err) { free(csra); free(csrcolidx); return err; }
+
+    /* If requested, sort nonzeros by column within each row */
+    if (sort_rows) {
+#ifdef HAVE_PAPI
+        PAPI_UTIL_region_begin("rowsort", NULL);
+        PAPI_UTIL_region_count("nonzeros", rowptr[num_rows]);
+#endif
+        err = rowsort(
+            num_rows, num_columns,
+            rowptr, rowsizemax, csrcolidx, csra);
+#ifdef HAVE_PAPI
+        PAPI_UTIL_region_end(NULL);
+#endif
+        if (err) { free(csra); free(csrcolidx); return err; }
+    }
+
+    /* copy the first nonzeros of each row to the ELLPACK part */
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for (idx_t i = 0; i < num_rows; i++) {
+        idx_t rowlen = rowptr[i+1]-rowptr[i] < rowsize ? rowptr[i+1]-rowptr[i] : rowsize;
+        idx_t j = i < num_columns ? i : num_columns-1;
+        for (idx_t l = 0; l < rowsize; l++) {
+            int64_t k = column_major ? (int64_t) l*num_rows+i : (int64_t) i*rowsize+l;
+            ellcolidx[k] = l < rowlen ? csrcolidx[rowptr[i]+l] : j;
+            ella[k] = l < rowlen ? csra[rowptr[i]+l] : 0.0;
+        }
+    }
+
+    /* copy the remaining nonzeros to the coordinate part */
+    int64_t * cooptr = malloc((num_rows+1) * sizeof(int64_t));
+    if (!cooptr) { free(csra); free(csrcolidx); return errno; }
+    cooptr[0] = 0;
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for (idx_t i = 0; i < num_rows; i++) {
+        int64_t rowlen = rowptr[i+1]-rowptr[i];
+        cooptr[i+1] = rowlen > rowsize ? rowlen - rowsize : 0;
+    }
+    err = prefix_sum(num_rows, &cooptr[1]);
+    if (err) { free(cooptr); free(csra); free(csrcolidx); return err; }
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for (idx_t i = 0; i < num_rows; i++) {
+        int64_t n = cooptr[i];
+        for (int64_t k = rowptr[i]+rowsize; k < rowptr[i+1]; k++, n++) {
+            coorowidx[n] = i;
+            coocolidx[n] = csrcolidx[k];
+            cooa[n] = csra[k];
+        }
+    }
+    free(cooptr); free(csra); free(csrcolidx);
+    return 0;
+}
+
+/*
+ * compressed column offsets
+ */
+
+/**
+ * ‘ell_compress_colidx()’ compresses the column offsets of a matrix
+ * in ELLPACK format, with each row stored contiguously, by grouping
+ * consecutive rows into blocks of ‘blocksize’ rows.
+ *
+ * For every block, the smallest column offset of its nonzeros is
+ * stored in ‘blockbase’. If every column offset of the block lies
+ * less than 2^16 columns beyond it, the offsets are stored relative
+ * to the base column as 16-bit unsigned integers in ‘colidx16’.
+ * Padding, or any other nonzero whose value is zero, does not take
+ * part in choosing the base column, and it is stored with the base
+ * column as its column offset. Otherwise, the block is stored in
+ * ‘colidxwide’ with the full index width. The wide nonzeros of the
+ * ‘b’-th block are found from ‘blockwideptr[b]’ up to
+ * ‘blockwideptr[b+1]’, and the block is narrow if the two are equal,
+ * in which case the column offset of the nonzero ‘k’ is
+ * ‘blockbase[b]+colidx16[k-blockwideptr[b]]’. The number of wide
+ * nonzeros is returned in ‘wide_nonzeros’, and the arrays
+ * ‘blockbase’, ‘blockwideptr’, ‘colidx16’ and ‘colidxwide’ are
+ * allocated and must be freed by the caller.
+ */
+static int ell_compress_colidx(
+    idx_t num_rows,
+    idx_t num_columns,
+    int64_t ellsize,
+    idx_t rowsize,
+    const idx_t * colidx,
+    const val_t * a,
+    idx_t blocksize,
+    idx_t ** out_blockbase,
+    int64_t ** out_blockwideptr,
+    uint16_t ** out_colidx16,
+    idx_t ** out_colidxwide,
+    int64_t * out_wide_nonzeros)
+{
+    if (blocksize <= 0) return EINVAL;
+    idx_t num_blocks = (num_rows + blocksize - 1) / blocksize;
+    idx_t * blockbase = malloc((num_blocks > 0 ? num_blocks : 1) * sizeof(idx_t));
+    if (!blockbase) return errno;
+    int64_t * blockwideptr = malloc((num_blocks+1) * sizeof(int64_t));
+    if (!blockwideptr) { free(blockbase); return errno; }
+
+    /* find the base column of every block and whether it fits */
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for (idx_t b = 0; b < num_blocks; b++) {
+        idx_t startrow = b*blocksize;
+        idx_t endrow = num_rows - startrow < blocksize ? num_rows : startrow+blocksize;
+        idx_t mincol = num_columns, maxcol = 0;
+        for (int64_t k = (int64_t) startrow*rowsize; k < (int64_t) endrow*rowsize; k++) {
+            if (a[k] == 0) continue;
+            mincol = mincol <= colidx[k] ? mincol : colidx[k];
+            maxcol = maxcol >= colidx[k] ? maxcol : colidx[k];
+        }
+        blockbase[b] = mincol <= maxcol ? mincol : 0;
+        blockwideptr[b+1] = mincol <= maxcol && maxcol - mincol > UINT16_MAX
+            ? (int64_t) (endrow-startrow)*rowsize : 0;
+    }
+    blockwideptr[0] = 0;
+    for (idx_t b = 1; b <= num_blocks; b++) blockwideptr[b] += blockwideptr[b-1];
+    int64_t wide_nonzeros = blockwideptr[num_blocks];
+    int64_t narrow_nonzeros = ellsize - wide_nonzeros;
+
+    uint16_t * colidx16 = malloc((narrow_nonzeros > 0 ? narrow_nonzeros : 1) * sizeof(uint16_t));
+    if (!colidx16) { free(blockwideptr); free(blockbase); return errno; }
+    idx_t * colidxwide = malloc((wide_nonzeros > 0 ? wide_nonzeros : 1) * sizeof(idx_t));
+    if (!colidxwide) { free(colidx16); free(blockwideptr); free(blockbase); return errno; }
+
+    /* copy the column offsets of every block */
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for (idx_t b = 0; b < num_blocks; b++) {
+        idx_t startrow = b*blocksize;
+        idx_t endrow = num_rows - startrow < blocksize ? num_rows : startrow+blocksize;
+        if (blockwideptr[b+1] > blockwideptr[b]) {
+            int64_t offset = (int64_t) startrow*rowsize - blockwideptr[b];
+            for (int64_t k = (int64_t) startrow*rowsize; k < (int64_t) endrow*rowsize; k++)
+                colidxwide[k-offset] = colidx[k];
+        } else {
+            int64_t offset = blockwideptr[b];
+            for (int64_t k = (int64_t) startrow*rowsize; k < (int64_t) endrow*rowsize; k++)
+                colidx16[k-offset] = a[k] != 0 ? colidx[k] - blockbase[b] : 0;
+        }
+    }
+
+    *out_blockbase = blockbase;
+    *out_blockwideptr = blockwideptr;
+    *out_colidx16 = colidx16;
+    *out_colidxwide = colidxwide;
+    *out_wide_nonzeros = wide_nonzeros;
+    return 0;
+}
+
+/*
+ * binary files for storing matrices after conversion
+ */
+
+#define BINFILE_MAGIC "spmvbin"
+#define BINFILE_VERSION 2
+#define BINFILE_BYTEORDER 0x01020304
+#define BINFILE_MAX_ARRAYS 5
+
+/*
+ * Every array in a binary file begins at an offset that is a
+ * multiple of BINFILE_ALIGNMENT bytes, so that the file can be mapped
+ * into memory one array at a time.
+ */
+#ifndef BINFILE_ALIGNMENT
+#define BINFILE_ALIGNMENT (1 << 16)
+#endif
+
+/*
+ * Arrays are copied from a memory-mapped file in chunks of
+ * BINFILE_CHUNK_SIZE bytes, which are distributed among threads.
+ */
+#ifndef BINFILE_CHUNK_SIZE
+#define BINFILE_CHUNK_SIZE (1 << 20)
+#endif
+
+enum binformat
+{
+    binfile_csr,
+    binfile_ell,
+    binfile_sell,
+};
+
+enum binflags
+{
+    binfile_separate_diagonal = 1 << 0,
+    binfile_sort_rows = 1 << 1,
+    binfile_column_major = 1 << 2,
+};
+
+/**
+ * ‘binfile_header’ is the header of a binary file containing a
+ * matrix that has already been converted to CSR, ELLPACK or sliced
+ * ELLPACK format.
+ */
+struct binfile_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteorder;
+    uint32_t idxtypewidth;
+    uint32_t valtypewidth;
+    uint32_t format;
+    uint32_t flags;
+    uint32_t num_arrays;
+    int64_t num_rows;
+    int64_t num_columns;
+    int64_t num_nonzeros;
+    int64_t size;
+    int64_t rowsizemin;
+    int64_t rowsizemax;
+    int64_t diagsize;
+    int64_t num_padding;
+    int64_t chunksize;
+    int64_t sigma;
+    int64_t offsets[BINFILE_MAX_ARRAYS];
+    int64_t sizes[BINFILE_MAX_ARRAYS];
+};
+
+/**
+ * ‘binfile_header_init()’ initialises the header of a binary file.
+ *
+ * The size, in bytes, of each array must be set afterwards, and the
+ * offsets of the arrays are computed by ‘binfile_write()’.
+ */
+static void binfile_header_init(
+    struct binfile_header * header,
+    enum binformat format,
+    uint32_t flags,
+    int num_arrays,
+    int64_t num_rows,
+    int64_t num_columns,
+    int64_t num_nonzeros,
+    int64_t size,
+    int64_t rowsizemin,
+    int64_t rowsizemax,
+    int64_t diagsize)
+{
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, BINFILE_MAGIC, sizeof(BINFILE_MAGIC));
+    header->version = BINFILE_VERSION;
+    header->byteorder = BINFILE_BYTEORDER;
+    header->idxtypewidth = sizeof(idx_t)*CHAR_BIT;
+    header->valtypewidth = sizeof(val_t)*CHAR_BIT;
+    header->format = format;
+    header->flags = flags;
+    header->num_arrays = num_arrays;
+    header->num_rows = num_rows;
+    header->num_columns = num_columns;
+    header->num_nonzeros = num_nonzeros;
+    header->size = size;
+    header->rowsizemin = rowsizemin;
+    header->rowsizemax = rowsizemax;
+    header->diagsize = diagsize;
+}
+
+/**
+ * ‘binfile_write()’ writes a header followed by the given arrays to
+ * a binary file.
+ */
+static int binfile_write(
+    const char * path,
+    struct binfile_header * header,
+    const void * const * arrays,
+    int64_t * bytes_written)
+{
+    int64_t offset = BINFILE_ALIGNMENT;
+    for (uint32_t n = 0; n < header->num_arrays; n++) {
+        header->offsets[n] = offset;
+        offset += header->sizes[n] + BINFILE_ALIGNMENT - 1;
+        offset -= offset % BINFILE_ALIGNMENT;
+    }
+
+    FILE * f = fopen(path, "w");
+    if (!f) return errno;
+    if (fwrite(header, sizeof(*header), 1, f) != 1) {
+        int err = errno; fclose(f); return err;
+    }
+    *bytes_written = sizeof(*header);
+    for (uint32_t n = 0; n < header->num_arrays; n++) {
+        if (fseeko(f, header->offsets[n], SEEK_SET) == -1) {
+            int err = errno; fclose(f); return err;
+        }
+        if (header->sizes[n] > 0 && fwrite(arrays[n], header->sizes[n], 1, f) != 1) {
+            int err = errno; fclose(f); return err;
+        }
+        *bytes_written += header->sizes[n];
+    }
+    if (fclose(f) == EOF) return errno;
+    return 0;
+}
+
+/**
+ * ‘binfile_read_header()’ reads and checks the header of a binary
+ * file.
+ *
+ * If the file was not produced by ‘binfile_write()’ on a machine with
+ * the same byte order, or if it is truncated, then ‘EINVAL’ is
+ * returned.
+ */
+static int binfile_read_header(
+    const char * path,
+    struct binfile_header * header)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) return errno;
+    struct stat st;
+    if (fstat(fd, &st) == -1) { int err = errno; close(fd); return err; }
+    ssize_t nread = pread(fd, header, sizeof(*header), 0);
+    if (nread == -1) { int err = errno; close(fd); return err; }
+    close(fd);
+    if (nread != sizeof(*header) ||
+        memcmp(header->magic, BINFILE_MAGIC, sizeof(BINFILE_MAGIC)) != 0 ||
+        header->version != BINFILE_VERSION ||
+        header->byteorder != BINFILE_BYTEORDER ||
+        header->num_arrays > BINFILE_MAX_ARRAYS)
+        return EINVAL;
+    for (uint32_t n = 0; n < header->num_arrays; n++) {
+        if (header->offsets[n] < 0 || header->sizes[n] < 0 ||
+            header->offsets[n] % BINFILE_ALIGNMENT != 0 ||
+            (header->sizes[n] > 0 && header->offsets[n] > st.st_size - header->sizes[n]))
+            return EINVAL;
+    }
+    return 0;
+}
+
+/**
+ * ‘binfile_read_array()’ maps an array of a binary file into memory
+ * and copies it to the given buffer.
+ *
+ * The copying is distributed among threads, so that each thread
+ * copies roughly the same part of the array that it touched first
+ * when the buffer was initialised.
+ */
+static int binfile_read_array(
+    const char * path,
+    const struct binfile_header * header,
+    int n,
+    void * dst,
+    int64_t * bytes_read)
+{
+    int64_t size = header->sizes[n];
+    if (size == 0) return 0;
+    long pagesize = sysconf(_SC_PAGESIZE);
+    off_t offset = header->offsets[n] - header->offsets[n] % pagesize;
+    size_t skip = header->offsets[n] - offset;
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) return errno;
+    char * p = mmap(NULL, skip+size, PROT_READ, MAP_PRIVATE, fd, offset);
+    if (p == MAP_FAILED) { int err = errno; close(fd); return err; }
+    close(fd);
+    madvise(p, skip+size, MADV_WILLNEED);
+    const char * src = p + skip;
+    int64_t num_chunks = (size + BINFILE_CHUNK_SIZE - 1) / BINFILE_CHUNK_SIZE;
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for (int64_t k = 0; k < num_chunks; k++) {
+        int64_t chunksize = k < num_chunks-1 ? BINFILE_CHUNK_SIZE : size - k*BINFILE_CHUNK_SIZE;
+        memcpy((char *) dst + k*BINFILE_CHUNK_SIZE, src + k*BINFILE_CHUNK_SIZE, chunksize);
+    }
+    munmap(p, skip+size);
+    *bytes_read += size;
+    return 0;
+}
+
+/*
+ * The kernels below are called by every thread of an enclosing
+ * parallel region, and, unless they need to synchronise internally,
+ * they return without a barrier at the end, so that a thread may
+ * measure the time it spends waiting for the others. The caller must
+ * therefore place a barrier after each call before using the result.
+ */
+
+static int ellgemv(
+    idx_t num_rows,
+    vec_t * __restrict y,
+    idx_t num_columns,
+    const vec_t * __restrict x,
+    int64_t ellsize,
+    idx_t rowsize,
+    const idx_t * __restrict colidx,
+    const val_t * __restrict a)
+{
+#if defined(__FCC_version__) && defined(USE_A64FX_SECTOR_CACHE)
+    #pragma procedure scache_isolate_assign a, colidx
+#endif
+
+#ifdef _OPENMP
+    #pragma omp for simd nowait
+#endif
+    for (idx_t i = 0; i < num_rows; i++) {
+        double yi = 0;
+        for (idx_t l = 0; l < rowsize; l++)
+            yi += a[i*rowsize+l] * x[colidx[i*rowsize+l]];
+        y[i] += yi;
+    }
+    return 0;
+}
+
+static int ellgemvsd(
+    idx_t num_rows,
+    vec_t * __restrict y,
+    idx_t num_columns,
+    const vec_t * __restrict x,
+    int64_t ellsize,
+    idx_t rowsize,
+    const idx_t * __restrict colidx,
+    const val_t * __restrict a,
+    const val_t * __restrict ad)
+{
+#if defined(__FCC_version__) && defined(USE_A64FX_SECTOR_CACHE)
+    #pragma procedure scache_isolate_assign a, ad, colidx
+#endif
+
+#ifdef _OPENMP
+    #pragma omp for simd nowait
+#endif
+    for (idx_t i = 0; i < num_rows; i++) {
+        double yi = 0;
+        for (idx_t l = 0; l < rowsize; l++)
+            yi += a[i*rowsize+l] * x[colidx[i*rowsize+l]];
+        y[i] += ad[i]*x[i] + yi;
+    }
+    return 0;
+}
+
+/*
+ * With ‘--sw-prefetch-distance’, the kernels issue software prefetches
+ * for the source vector entries that are needed a number of nonzeros
+ * ahead, since the hardware prefetchers only follow the streaming
+ * accesses to the matrix, and not the gathered accesses to ‘x’.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define SW_PREFETCH(p) __builtin_prefetch((p), 0, 3)
+#else
+#define SW_PREFETCH(p) ((void) (p))
+#endif
+
+/**
+ * ‘ellgemv_swpf()’ multiplies a matrix in ELLPACK format with a
+ * vector, while prefetching the entries of ‘x’ that are needed
+ * ‘distance’ nonzeros ahead, and the column offsets that are needed
+ * ‘distance’ nonzeros ahead of those. In the column-major layout, the
+ * nonzeros ahead belong to the same column of subsequent rows. If
+ * ‘ad’ is not ‘NULL’, the diagonal nonzeros are stored separately.
+ */
+static int ellgemv_swpf(
+    idx_t num_rows,
+    vec_t * __restrict y,
+    idx_t num_columns,
+    const vec_t * __restrict x,
+    int64_t ellsize,
+    idx_t rowsize,
+    const idx_t * __restrict colidx,
+    const val_t * __restrict a,
+    const val_t * __restrict ad,
+    bool column_major,
+    int distance)
+{
+#if defined(__FCC_version__) && defined(USE_A64FX_SECTOR_CACHE)
+    #pragma procedure scache_isolate_assign a, ad, colidx
+#endif
+
+    if (column_major) {
+#ifdef _OPENMP
+        #pragma omp for nowait
+#endif
+        for (idx_t i = 0; i < num_rows; i++) {
+            double yi = 0;
+            for (idx_t l = 0; l < rowsize; l++) {
+                int64_t k = (int64_t) l*num_rows+i;
+                if (i+2*(int64_t)distance < num_rows) SW_PREFETCH(&colidx[k+2*distance]);
+                if (i+(int64_t)distance < num_rows) SW_PREFETCH(&x[colidx[k+distance]]);
+                yi += a[k] * x[colidx[k]];
+            }
+            y[i] += (ad ? ad[i]*x[i] : 0) + yi;
+        }
+    } else {
+#ifdef _OPENMP
+        #pragma omp for nowait
+#endif
+        for (idx_t i = 0; i < num_rows; i++) {
+            double yi = 0;
+            for (idx_t l = 0; l < rowsize; l++) {
+                int64_t k = (int64_t) i*rowsize+l;
+                if (k+2*distance < ellsize) SW_PREFETCH(&colidx[k+2*distance]);
+                if (k+distance < ellsize) SW_PREFETCH(&x[colidx[k+distance]]);
+                yi += a[k] * x[colidx[k]];
+            }
+            y[i] += (ad ? ad[i]*x[i] : 0) + yi;
+        }
+    }
+    return 0;
+}
+
+/*
+ * With ‘--nontemporal’, the kernels overwrite the destination vector
+ * with non-temporal stores, instead of adding to it, so that it is
+ * neither read nor kept in cache. The matrix is loaded with prefetches
+ * that hint that it is used only once, which leaves more of the cache
+ * for the source vector.
+ */
+#define NT_PREFETCH_DISTANCE 64
+#if defined(__GNUC__) || defined(__clang__)
+#define NT_PREFETCH(p) __builtin_prefetch((p), 0, 0)
+#else
+#define NT_PREFETCH(p) ((void) (p))
+#endif
+
+/**
+ * ‘vec_store_nontemporal()’ stores a value without first reading the
+ * cache line that it belongs to. Clang's builtin is used if it is
+ * available, and otherwise ‘movnti’ on x86. On other architectures,
+ * an ordinary store is used.
+ */
+static inline void vec_store_nontemporal(
+    vec_t * p,
+    vec_t v)
+{
+#if defined(__clang__)
+    __builtin_nontemporal_store(v, p);
+#elif defined(__x86_64__) && VECTYPEWIDTH == 64
+    long long u;
+    memcpy(&u, &v, sizeof(u));
+    _mm_stream_si64((long long *) p, u);
+#elif (defined(__x86_64__) || defined(__i386__)) && VECTYPEWIDTH == 32
+    int u;
+    memcpy(&u, &v, sizeof(u));
+    _mm_stream_si32((int *) p, u);
+#else
+    *p = v;
+#endif
+}
+
+/**
+ * ‘vec_store_nontemporal_fence()’ orders earlier non-temporal stores
+ * before any later stores, which is needed on x86, since non-temporal
+ * stores are weakly ordered.
+ */
+static inline void vec_store_nontemporal_fence(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_sfence();
+#endif
+}
+
+/**
+ * ‘ellgemv_nt()’ computes y = A*x for a matrix in ELLPACK format,
+ * where the destination vector is written with non-temporal stores.
+ * If ‘ad’ is not ‘NULL’, the diagonal nonzeros are stored separately.
+ */
+static int ellgemv_nt(
     idx_t num_rows,
+    vec_t * __restrict y,
     idx_t num_columns,
-    int64_t num_nonzeros,
-    idx_t * rowidx,
-    idx_t * colidx,
-    double * a,
-    enum streamtype streamtype,
-    union stream stream,
-    int64_t * lines_read,
-    int64_t * bytes_read)
+    const vec_t * __restrict x,
+    int64_t ellsize,
+    idx_t rowsize,
+    const idx_t * __restrict colidx,
+    const val_t * __restrict a,
+    const val_t * __restrict ad,
+    bool column_major)
+{
+    if (column_major) {
+#ifdef _OPENMP
+        #pragma omp for nowait
+#endif
+        for (idx_t i = 0; i < num_rows; i++) {
+            double yi = 0;
+            for (idx_t l = 0; l < rowsize; l++) {
+                int64_t k = (int64_t) l*num_rows+i;
+                if (i+NT_PREFETCH_DISTANCE < num_rows) {
+                    NT_PREFETCH(&a[k+NT_PREFETCH_DISTANCE]);
+                    NT_PREFETCH(&colidx[k+NT_PREFETCH_DISTANCE]);
+                }
+                yi += a[k] * x[colidx[k]];
+            }
+            vec_store_nontemporal(&y[i], ad ? ad[i]*x[i] + yi : yi);
+        }
+    } else {
+#ifdef _OPENMP
+        #pragma omp for nowait
+#endif
+        for (idx_t i = 0; i < num_rows; i++) {
+            double yi = 0;
+            for (idx_t l = 0; l < rowsize; l++) {
+                int64_t k = (int64_t) i*rowsize+l;
+                if (k+NT_PREFETCH_DISTANCE < ellsize) {
+                    NT_PREFETCH(&a[k+NT_PREFETCH_DISTANCE]);
+                    NT_PREFETCH(&colidx[k+NT_PREFETCH_DISTANCE]);
+                }
+                yi += a[k] * x[colidx[k]];
+            }
+            vec_store_nontemporal(&y[i], ad ? ad[i]*x[i] + yi : yi);
+        }
+    }
+    vec_store_nontemporal_fence();
+    return 0;
+}
+
+#ifdef _OPENMP
+/**
+ * ‘ellgemv_target()’ multiplies a matrix in ELLPACK format with a
+ * vector on the default device of OpenMP target offloading, where the
+ * matrix and both vectors must already be mapped. Unlike the other
+ * kernels, it is called by a single thread, and every row is computed
+ * by one device thread. In the column-major layout, neighbouring
+ * device threads therefore access consecutive matrix entries. If
+ * ‘ad’ is not ‘NULL’, the diagonal nonzeros are stored separately.
+ */
+static int ellgemv_target(
+    idx_t num_rows,
+    vec_t * __restrict y,
+    idx_t num_columns,
+    const vec_t * __restrict x,
+    int64_t ellsize,
+    idx_t rowsize,
+    const idx_t * __restrict colidx,
+    const val_t * __restrict a,
+    const val_t * __restrict ad,
+    bool column_major)
+{
+    if (column_major && ad) {
+        #pragma omp target teams distribute parallel for
+        for (idx_t i = 0; i < num_rows; i++) {
+            double yi = 0;
+            for (idx_t l = 0; l < rowsize; l++)
+                yi += a[(int64_t) l*num_rows+i] * x[colidx[(int64_t) l*num_rows+i]];
+            y[i] += ad[i]*x[i] + yi;
+        }
+    } else if (column_major) {
+        #pragma omp target teams distribute parallel for
+        for (idx_t i = 0; i < num_rows; i++) {
+            double yi = 0;
+            for (idx_t l = 0; l < rowsize; l++)
+                yi += a[(int64_t) l*num_rows+i] * x[colidx[(int64_t) l*num_rows+i]];
+            y[i] += yi;
+        }
+    } else if (ad) {
+        #pragma omp target teams distribute parallel for
+        for (idx_t i = 0; i < num_rows; i++) {
+            double yi = 0;
+            for (idx_t l = 0; l < rowsize; l++)
+                yi += a[i*rowsize+l] * x[colidx[i*rowsize+l]];
+            y[i] += ad[i]*x[i] + yi;
+        }
+    } else {
+        #pragma omp target teams distribute parallel for
+        for (idx_t i = 0; i < num_rows; i++) {
+            double yi = 0;
+            for (idx_t l = 0; l < rowsize; l++)
+                yi += a[i*rowsize+l] * x[colidx[i*rowsize+l]];
+            y[i] += yi;
+        }
+    }
+    return 0;
+}
+#endif
+
+/*
+ * ELLPACK kernels that are specialised for a fixed number of nonzeros
+ * per row. Because the trip count of the innermost loop is known at
+ * compile time, the compiler can unroll it completely.
+ */
+
+#define ELLGEMV_MAX_ROWSIZE 64
+#define ELLGEMV_ROWSIZES(X) \
+    X(1) X(2) X(3) X(4) X(5) X(6) X(7) X(8) \
+    X(9) X(10) X(11) X(12) X(13) X(14) X(15) X(16) \
+    X(17) X(18) X(19) X(20) X(21) X(22) X(23) X(24) \
+    X(25) X(26) X(27) X(28) X(29) X(30) X(31) X(32) \
+    X(33) X(34) X(35) X(36) X(37) X(38) X(39) X(40) \
+    X(41) X(42) X(43) X(44) X(45) X(46) X(47) X(48) \
+    X(49) X(50) X(51) X(52) X(53) X(54) X(55) X(56) \
+    X(57) X(58) X(59) X(60) X(61) X(62) X(63) X(64)
+
+#ifdef _OPENMP
+#define ELLGEMV_OMP_FOR_SIMD _Pragma("omp for simd nowait")
+#else
+#define ELLGEMV_OMP_FOR_SIMD
+#endif
+#if defined(__FCC_version__) && defined(USE_A64FX_SECTOR_CACHE)
+#define ELLGEMV_SCACHE_ISOLATE _Pragma("procedure scache_isolate_assign a, colidx")
+#define ELLGEMVSD_SCACHE_ISOLATE _Pragma("procedure scache_isolate_assign a, ad, colidx")
+#else
+#define ELLGEMV_SCACHE_ISOLATE
+#define ELLGEMVSD_SCACHE_ISOLATE
+#endif
+
+#define ELLGEMVN(N)                                                     \
+    static int ellgemv##N(                                              \
+        idx_t num_rows,                                                 \
+        vec_t * __restrict y,                                           \
+        idx_t num_columns,                                              \
+        const vec_t * __restrict x,                                     \
+        int64_t ellsize,                                                \
+        idx_t rowsize,                                                  \
+        const idx_t * __restrict colidx,                                \
+        const val_t * __restrict a)                                     \
+    {                                                                   \
+        ELLGEMV_SCACHE_ISOLATE                                          \
+        if (rowsize != N) return EINVAL;                                \
+        ELLGEMV_OMP_FOR_SIMD                                            \
+        for (idx_t i = 0; i < num_rows; i++) {                          \
+            double yi = 0;                                              \
+            for (idx_t l = 0; l < N; l++)                               \
+                yi += a[i*N+l] * x[colidx[i*N+l]];                      \
+            y[i] += yi;                                                 \
+        }                                                               \
+        return 0;                                                       \
+    }                                                                   \
+                                                                        \
+    static int ellgemv##N##sd(                                          \
+        idx_t num_rows,                                                 \
+        vec_t * __restrict y,                                           \
+        idx_t num_columns,                                              \
+        const vec_t * __restrict x,                                     \
+        int64_t ellsize,                                                \
+        idx_t rowsize,                                                  \
+        const idx_t * __restrict colidx,                                \
+        const val_t * __restrict a,                                     \
+        const val_t * __restrict ad)                                    \
+    {                                                                   \
+        ELLGEMVSD_SCACHE_ISOLATE                                        \
+        if (rowsize != N) return EINVAL;                                \
+        ELLGEMV_OMP_FOR_SIMD                                            \
+        for (idx_t i = 0; i < num_rows; i++) {                          \
+            double yi = 0;                                              \
+            for (idx_t l = 0; l < N; l++)                               \
+                yi += a[i*N+l] * x[colidx[i*N+l]];                      \
+            y[i] += ad[i]*x[i] + yi;                                    \
+        }                                                               \
+        return 0;                                                       \
+    }
+
+ELLGEMV_ROWSIZES(ELLGEMVN)
+
+#define ELLGEMVN_ENTRY(N) [N] = ellgemv##N,
+#define ELLGEMVNSD_ENTRY(N) [N] = ellgemv##N##sd,
+
+/**
+ * ‘ellgemvn’ and ‘ellgemvnsd’ are the specialised kernels for each
+ * number of nonzeros per row from 1 up to ‘ELLGEMV_MAX_ROWSIZE’,
+ * without and with a separately stored diagonal, respectively.
+ */
+static int (* const ellgemvn[ELLGEMV_MAX_ROWSIZE+1])(
+    idx_t, vec_t *, idx_t, const vec_t *, int64_t, idx_t,
+    const idx_t *, const val_t *) =
+{
+    ELLGEMV_ROWSIZES(ELLGEMVN_ENTRY)
+};
+
+static int (* const ellgemvnsd[ELLGEMV_MAX_ROWSIZE+1])(
+    idx_t, vec_t *, idx_t, const vec_t *, int64_t, idx_t,
+    const idx_t *, const val_t *, const val_t *) =
+{
+    ELLGEMV_ROWSIZES(ELLGEMVNSD_ENTRY)
+};
+
+/**
+ * ‘ellgemvcm()’ multiplies a matrix in ELLPACK format with a vector,
+ * where the nonzeros are stored in column-major order, so that the
+ * ‘l’-th nonzero of the ‘i’-th row is found at ‘l*num_rows+i’.
+ * Consecutive rows are thus read with unit stride when the loop over
+ * rows is vectorised.
+ */
+static int ellgemvcm(
+    idx_t num_rows,
+    vec_t * __restrict y,
+    idx_t num_columns,
+    const vec_t * __restrict x,
+    int64_t ellsize,
+    idx_t rowsize,
+    const idx_t * __restrict colidx,
+    const val_t * __restrict a)
+{
+#if defined(__FCC_version__) && defined(USE_A64FX_SECTOR_CACHE)
+    #pragma procedure scache_isolate_assign a, colidx
+#endif
+
+#ifdef _OPENMP
+    #pragma omp for simd nowait
+#endif
+    for (idx_t i = 0; i < num_rows; i++) {
+        double yi = 0;
+        for (idx_t l = 0; l < rowsize; l++)
+            yi += a[l*num_rows+i] * x[colidx[l*num_rows+i]];
+        y[i] += yi;
+    }
+    return 0;
+}
+
+static int ellgemvcmsd(
+    idx_t num_rows,
+    vec_t * __restrict y,
+    idx_t num_columns,
+    const vec_t * __restrict x,
+    int64_t ellsize,
+    idx_t rowsize,
+    const idx_t * __restrict colidx,
+    const val_t * __restrict a,
+    const val_t * __restrict ad)
+{
+#if defined(__FCC_version__) && defined(USE_A64FX_SECTOR_CACHE)
+    #pragma procedure scache_isolate_assign a, ad, colidx
+#endif
+
+#ifdef _OPENMP
+    #pragma omp for simd nowait
+#endif
+    for (idx_t i = 0; i < num_rows; i++) {
+        double yi = 0;
+        for (idx_t l = 0; l < rowsize; l++)
+            yi += a[l*num_rows+i] * x[colidx[l*num_rows+i]];
+        y[i] += ad[i]*x[i] + yi;
+    }
+    return 0;
+}
+
+/**
+ * ‘ellgemm()’ multiplies a matrix in ELLPACK format with
+ * ‘num_vectors’ vectors at once. The vectors are stored as the
+ * columns of the dense matrices ‘x’ and ‘y’ in row-major order, so
+ * that each nonzero is loaded only once and multiplied with
+ * ‘num_vectors’ contiguous values of ‘x’.
+ */
+static int ellgemm(
+    idx_t num_rows,
+    vec_t * __restrict y,
+    idx_t num_columns,
+    const vec_t * __restrict x,
+    int num_vectors,
+    int64_t ellsize,
+    idx_t rowsize,
+    const idx_t * __restrict colidx,
+    const val_t * __restrict a)
+{
+#if defined(__FCC_version__) && defined(USE_A64FX_SECTOR_CACHE)
+    #pragma procedure scache_isolate_assign a, colidx
+#endif
+
+    if (num_vectors > MAX_NUM_VECTORS) return EINVAL;
+#ifdef _OPENMP
+    #pragma omp for nowait
+#endif
+    for (idx_t i = 0; i < num_rows; i++) {
+        double yi[MAX_NUM_VECTORS];
+        for (int v = 0; v < num_vectors; v++) yi[v] = 0;
+        for (idx_t l = 0; l < rowsize; l++) {
+            double al = a[i*rowsize+l];
+            const vec_t * xj = &x[(int64_t) colidx[i*rowsize+l]*num_vectors];
+#ifdef _OPENMP
+            #pragma omp simd
+#endif
+            for (int v = 0; v < num_vectors; v++) yi[v] += al * xj[v];
+        }
+        for (int v = 0; v < num_vectors; v++) y[(int64_t) i*num_vectors+v] += yi[v];
+    }
+    return 0;
+}
+
+static int ellgemmsd(
+    idx_t num_rows,
+    vec_t * __restrict y,
+    idx_t num_columns,
+    const vec_t * __restrict x,
+    int num_vectors,
+    int64_t ellsize,
+    idx_t rowsize,
+    const idx_t * __restrict colidx,
+    const val_t * __restrict a,
+    const val_t * __restrict ad)
+{
+#if defined(__FCC_version__) && defined(USE_A64FX_SECTOR_CACHE)
+    #pragma procedure scache_isolate_assign a, ad, colidx
+#endif
+
+    if (num_vectors > MAX_NUM_VECTORS) return EINVAL;
+#ifdef _OPENMP
+    #pragma omp for nowait
+#endif
+    for (idx_t i = 0; i < num_rows; i++) {
+        double yi[MAX_NUM_VECTORS];
+        const vec_t * xi = &x[(int64_t) i*num_vectors];
+        for (int v = 0; v < num_vectors; v++) yi[v] = ad[i]*xi[v];
+        for (idx_t l = 0; l < rowsize; l++) {
+            double al = a[i*rowsize+l];
+            const vec_t * xj = &x[(int64_t) colidx[i*rowsize+l]*num_vectors];
+#ifdef _OPENMP
+            #pragma omp simd
+#endif
+            for (int v = 0; v < num_vectors; v++) yi[v] += al * xj[v];
+        }
+        for (int v = 0; v < num_vectors; v++) y[(int64_t) i*num_vectors+v] += yi[v];
+    }
+    return 0;
+}
+
+/**
+ * ‘ellgemmcm()’ is the same as ‘ellgemm()’, except that the nonzeros
+ * are stored in column-major order, as for ‘ellgemvcm()’.
+ */
+static int ellgemmcm(
+    idx_t num_rows,
+    vec_t * __restrict y,
+    idx_t num_columns,
+    const vec_t * __restrict x,
+    int num_vectors,
+    int64_t ellsize,
+    idx_t rowsize,
+    const idx_t * __restrict colidx,
+    const val_t * __restrict a)
+{
+#if defined(__FCC_version__) && defined(USE_A64FX_SECTOR_CACHE)
+    #pragma procedure scache_isolate_assign a, colidx
+#endif
+
+    if (num_vectors > MAX_NUM_VECTORS) return EINVAL;
+#ifdef _OPENMP
+    #pragma omp for nowait
+#endif
+    for (idx_t i = 0; i < num_rows; i++) {
+        double yi[MAX_NUM_VECTORS];
+        for (int v = 0; v < num_vectors; v++) yi[v] = 0;
+        for (idx_t l = 0; l < rowsize; l++) {
+            double al = a[l*num_rows+i];
+            const vec_t * xj = &x[(int64_t) colidx[l*num_rows+i]*num_vectors];
+#ifdef _OPENMP
+            #pragma omp simd
+#endif
+            for (int v = 0; v < num_vectors; v++) yi[v] += al * xj[v];
+        }
+        for (int v = 0; v < num_vectors; v++) y[(int64_t) i*num_vectors+v] += yi[v];
+    }
+    return 0;
+}
+
+static int ellgemmcmsd(
+    idx_t num_rows,
+    vec_t * __restrict y,
+    idx_t num_columns,
+    const vec_t * __restrict x,
+    int num_vectors,
+    int64_t ellsize,
+    idx_t rowsize,
+    const idx_t * __restrict colidx,
+    const val_t * __restrict a,
+    const val_t * __restrict ad)
+{
+#if defined(__FCC_version__) && defined(USE_A64FX_SECTOR_CACHE)
+    #pragma procedure scache_isolate_assign a, ad, colidx
+#endif
+
+    if (num_vectors > MAX_NUM_VECTORS) return EINVAL;
+#ifdef _OPENMP
+    #pragma omp for nowait
+#endif
+    for (idx_t i = 0; i < num_rows; i++) {
+        double yi[MAX_NUM_VECTORS];
+        const vec_t * xi = &x[(int64_t) i*num_vectors];
+        for (int v = 0; v < num_vectors; v++) yi[v] = ad[i]*xi[v];
+        for (idx_t l = 0; l < rowsize; l++) {
+            double al = a[l*num_rows+i];
+            const vec_t * xj = &x[(int64_t) colidx[l*num_rows+i]*num_vectors];
+#ifdef _OPENMP
+            #pragma omp simd
+#endif
+            for (int v = 0; v < num_vectors; v++) yi[v] += al * xj[v];
+        }
+        for (int v = 0; v < num_vectors; v++) y[(int64_t) i*num_vectors+v] += yi[v];
+    }
+    return 0;
+}
+
+/*
+ * Vectorised kernels using AVX-512 or SVE gather instructions.
+ *
+ * For the row-major ELLPACK layout, the nonzeros of each row are
+ * processed one vector at a time, and a mask (or predicate) disables
+ * the lanes beyond the end of the row. For the column-major layout,
+ * each vector lane instead handles its own row, so that the values
+ * and column offsets are loaded with unit stride.
+ */
+
+#ifdef USE_AVX512_KERNELS
+/**
+ * ‘gather_avx512()’ loads up to eight column offsets, as given by the
+ * mask ‘m’, and gathers the corresponding elements of ‘x’.
+ */
+static inline __m512d gather_avx512(
+    __mmask8 m,
+    const idx_t * colidx,
+    const double * x)
+{
+#if IDXTYPEWIDTH == 64
+    __m512i j = _mm512_maskz_loadu_epi64(m, colidx);
+    return _mm512_mask_i64gather_pd(_mm512_setzero_pd(), m, j, x, sizeof(double));
+#else
+    __m256i j = _mm512_castsi512_si256(_mm512_maskz_loadu_epi32((__mmask16) m, colidx));
+    return _mm512_mask_i32gather_pd(_mm512_setzero_pd(), m, j, x, sizeof(double));
+#endif
+}
+
+static inline __mmask8 mask_avx512(int64_t n)
+{
+    return n >= 8 ? 0xff : (__mmask8) ((1u << n) - 1);
+}
+
+static int ellgemv_avx512(
+    idx_t num_rows,
+    vec_t * __restrict y,
+    idx_t num_columns,
+    const vec_t * __restrict x,
+    int64_t ellsize,
+    idx_t rowsize,
+    const idx_t * __restrict colidx,
+    const val_t * __restrict a)
 {
-    int line_max = sysconf(_SC_LINE_MAX);
-    char * linebuf = malloc(line_max+1);
-    if (!linebuf) return errno;
-    if (field == mtxreal || field == mtxinteger) {
-        for (int64_t i = 0; i < num_nonzeros; i++) {
-            int err = freadline(linebuf, line_max, streamtype, stream);
-            if (err) { free(linebuf); return err; }
-            char * s = linebuf;
-            char * t = s;
-            err = parse_idx_t(&rowidx[i], s, &t, bytes_read);
-            if (err) { free(linebuf); return err; }
-            if (s == t || *t != ' ') { free(linebuf); return EINVAL; }
-            if (bytes_read) (*bytes_read)++;
-            s = t+1;
-            err = parse_idx_t(&colidx[i], s, &t, bytes_read);
-            if (err) { free(linebuf); return err; }
-            if (s == t || *t != ' ') { free(linebuf); return EINVAL; }
-            if (bytes_read) (*bytes_read)++;
-            s = t+1;
-            err = parse_double(&a[i], s, &t, bytes_read);
-            if (err) { free(linebuf); return err; }
-            if (s == t) { free(linebuf); return EINVAL; }
-            if (lines_read) (*lines_read)++;
-        }
-    } else if (field == mtxinteger) {
-        for (int64_t i = 0; i < num_nonzeros; i++) {
-            int err = freadline(linebuf, line_max, streamtype, stream);
-            if (err) { free(linebuf); return err; }
-            char * s = linebuf;
-            char * t = s;
-            err = parse_idx_t(&rowidx[i], s, &t, bytes_read);
-            if (err) { free(linebuf); return err; }
-            if (s == t || *t != ' ') { free(linebuf); return EINVAL; }
-            if (bytes_read) (*bytes_read)++;
-            s = t+1;
-            err = parse_idx_t(&colidx[i], s, &t, bytes_read);
-            if (err) { free(linebuf); return err; }
-            if (s == t || *t != ' ') { free(linebuf); return EINVAL; }
-            if (bytes_read) (*bytes_read)++;
-            s = t+1;
-            int x;
-            err = parse_int(&x, s, &t, bytes_read);
-            if (err) { free(linebuf); return err; }
-            if (s == t) { free(linebuf); return EINVAL; }
-            a[i] = x;
-            if (lines_read) (*lines_read)++;
-        }
-    } else if (field == mtxpattern) {
-        for (int64_t i = 0; i < num_nonzeros; i++) {
-            int err = freadline(linebuf, line_max, streamtype, stream);
-            if (err) { free(linebuf); return err; }
-            char * s = linebuf;
-            char * t = s;
-            err = parse_idx_t(&rowidx[i], s, &t, bytes_read);
-            if (err) { free(linebuf); return err; }
-            if (s == t || *t != ' ') { free(linebuf); return EINVAL; }
-            if (bytes_read) (*bytes_read)++;
-            s = t+1;
-            err = parse_idx_t(&colidx[i], s, &t, bytes_read);
-            if (err) { free(linebuf); return err; }
-            if (s == t) { free(linebuf); return EINVAL; }
-            a[i] = 1;
-            if (lines_read) (*lines_read)++;
+#ifdef _OPENMP
+    #pragma omp for nowait
+#endif
+    for (idx_t i = 0; i < num_rows; i++) {
+        __m512d yi = _mm512_setzero_pd();
+        for (idx_t l = 0; l < rowsize; l += 8) {
+            __mmask8 m = mask_avx512(rowsize-l);
+            __m512d al = _mm512_maskz_loadu_pd(m, &a[i*rowsize+l]);
+            __m512d xl = gather_avx512(m, &colidx[i*rowsize+l], x);
+            yi = _mm512_fmadd_pd(al, xl, yi);
         }
-    } else { free(linebuf); return EINVAL; }
-    free(linebuf);
+        y[i] += _mm512_reduce_add_pd(yi);
+    }
     return 0;
 }
 
-static int mtxfile_fread_vector_array(
-    enum mtxfield field,
+static int ellgemvsd_avx512(
     idx_t num_rows,
-    double * x,
-    enum streamtype streamtype,
-    union stream stream,
-    int64_t * lines_read,
-    int64_t * bytes_read)
+    vec_t * __restrict y,
+    idx_t num_columns,
+    const vec_t * __restrict x,
+    int64_t ellsize,
+    idx_t rowsize,
+    const idx_t * __restrict colidx,
+    const val_t * __restrict a,
+    const val_t * __restrict ad)
 {
-    int line_max = sysconf(_SC_LINE_MAX);
-    char * linebuf = malloc(line_max+1);
-    if (!linebuf) return errno;
-    if (field == mtxreal) {
-        for (idx_t i = 0; i < num_rows; i++) {
-            int err = freadline(linebuf, line_max, streamtype, stream);
-            if (err) { free(linebuf); return err; }
-            char * s = linebuf;
-            char * t = s;
-            err = parse_double(&x[i], s, &t, bytes_read);
-            if (err) { free(linebuf); return err; }
-            if (s == t) { free(linebuf); return EINVAL; }
-            if (lines_read) (*lines_read)++;
-        }
-    } else if (field == mtxinteger) {
-        for (idx_t i = 0; i < num_rows; i++) {
-            int err = freadline(linebuf, line_max, streamtype, stream);
-            if (err) { free(linebuf); return err; }
-            char * s = linebuf;
-            char * t = s;
-            int y;
-            err = parse_int(&y, s, &t, bytes_read);
-            if (err) { free(linebuf); return err; }
-            if (s == t) { free(linebuf); return EINVAL; }
-            x[i] = y;
-            if (lines_read) (*lines_read)++;
+#ifdef _OPENMP
+    #pragma omp for nowait
+#endif
+    for (idx_t i = 0; i < num_rows; i++) {
+        __m512d yi = _mm512_setzero_pd();
+        for (idx_t l = 0; l < rowsize; l += 8) {
+            __mmask8 m = mask_avx512(rowsize-l);
+            __m512d al = _mm512_maskz_loadu_pd(m, &a[i*rowsize+l]);
+            __m512d xl = gather_avx512(m, &colidx[i*rowsize+l], x);
+            yi = _mm512_fmadd_pd(al, xl, yi);
         }
-    } else { free(linebuf); return EINVAL; }
-    free(linebuf);
+        y[i] += ad[i]*x[i] + _mm512_reduce_add_pd(yi);
+    }
     return 0;
 }
 
-static int ell_from_coo_size(
+static int ellgemvcm_avx512(
     idx_t num_rows,
+    vec_t * __restrict y,
     idx_t num_columns,
-    int64_t num_nonzeros,
-    const idx_t * rowidx,
-    const idx_t * colidx,
-    const double * a,
-    int64_t * rowptr,
-    int64_t * ellsize,
-    idx_t * rowsize,
-    idx_t * diagsize,
-    bool separate_diagonal)
+    const vec_t * __restrict x,
+    int64_t ellsize,
+    idx_t rowsize,
+    const idx_t * __restrict colidx,
+    const val_t * __restrict a)
 {
-    idx_t rowmax = 0;
-    for (idx_t i = 0; i <= num_rows; i++) rowptr[i] = 0;
-    for (int64_t k = 0; k < num_nonzeros; k++) {
-        if (!separate_diagonal || rowidx[k] != colidx[k])
-            rowptr[rowidx[k]]++;
-    }
-    for (idx_t i = 1; i <= num_rows; i++) {
-        rowmax = rowmax >= rowptr[i] ? rowmax : rowptr[i];
-        rowptr[i] += rowptr[i-1];
+#ifdef _OPENMP
+    #pragma omp for nowait
+#endif
+    for (idx_t i = 0; i < num_rows; i += 8) {
+        __mmask8 m = mask_avx512(num_rows-i);
+        __m512d yi = _mm512_setzero_pd();
+        for (idx_t l = 0; l < rowsize; l++) {
+            __m512d al = _mm512_maskz_loadu_pd(m, &a[l*num_rows+i]);
+            __m512d xl = gather_avx512(m, &colidx[l*num_rows+i], x);
+            yi = _mm512_fmadd_pd(al, xl, yi);
+        }
+        yi = _mm512_add_pd(_mm512_maskz_loadu_pd(m, &y[i]), yi);
+        _mm512_mask_storeu_pd(&y[i], m, yi);
     }
-    *rowsize = rowmax;
-    *ellsize = num_rows * (*rowsize);
-    *diagsize = num_rows < num_columns ? num_rows : num_columns;
     return 0;
 }
 
-static int rowsort(
+static int ellgemvcmsd_avx512(
     idx_t num_rows,
+    vec_t * __restrict y,
     idx_t num_columns,
-    int64_t * __restrict rowptr,
-    idx_t rowsizemax,
-    idx_t * __restrict colidx,
-    double * __restrict a)
+    const vec_t * __restrict x,
+    int64_t ellsize,
+    idx_t rowsize,
+    const idx_t * __restrict colidx,
+    const val_t * __restrict a,
+    const val_t * __restrict ad)
 {
-    idx_t threshold = 1 << 4;
-
-    /* sort short rows using insertion sort */
-    #pragma omp parallel for
-    for (idx_t i = 0; i < num_rows; i++) {
-        idx_t rowlen = rowptr[i+1]-rowptr[i];
-        if (rowlen > threshold) continue;
-        for (int64_t k = rowptr[i]+1; k < rowptr[i+1]; k++) {
-            idx_t j = colidx[k];
-            double b = a[k];
-            int64_t l = k-1;
-            while (l >= rowptr[i] && colidx[l] > j) {
-                colidx[l+1] = colidx[l];
-                a[l+1] = a[l];
-                l--;
-            }
-            colidx[l+1] = j;
-            a[l+1] = b;
+#ifdef _OPENMP
+    #pragma omp for nowait
+#endif
+    for (idx_t i = 0; i < num_rows; i += 8) {
+        __mmask8 m = mask_avx512(num_rows-i);
+        __m512d yi = _mm512_mul_pd(
+            _mm512_maskz_loadu_pd(m, &ad[i]), _mm512_maskz_loadu_pd(m, &x[i]));
+        for (idx_t l = 0; l < rowsize; l++) {
+            __m512d al = _mm512_maskz_loadu_pd(m, &a[l*num_rows+i]);
+            __m512d xl = gather_avx512(m, &colidx[l*num_rows+i], x);
+            yi = _mm512_fmadd_pd(al, xl, yi);
         }
+        yi = _mm512_add_pd(_mm512_maskz_loadu_pd(m, &y[i]), yi);
+        _mm512_mask_storeu_pd(&y[i], m, yi);
     }
+    return 0;
+}
+#endif
 
-    if (rowsizemax <= threshold) return 0;
+#ifdef USE_SVE_KERNELS
+/**
+ * ‘gather_sve()’ loads the column offsets of the active lanes of the
+ * predicate ‘pg’ and gathers the corresponding elements of ‘x’.
+ */
+static inline svfloat64_t gather_sve(
+    svbool_t pg,
+    const idx_t * colidx,
+    const double * x)
+{
+#if IDXTYPEWIDTH == 64
+    svint64_t j = svld1_s64(pg, colidx);
+#else
+    svint64_t j = svld1sw_s64(pg, colidx);
+#endif
+    return svld1_gather_s64index_f64(pg, x, j);
+}
 
-    /* sort long rows using a hybrid sort that first uses insertion
-     * sort to sort blocks of size 'threshold', and then switches to a
-     * bottom-up merge sort. */
-    idx_t * tmpcolidx = malloc(rowsizemax * sizeof(idx_t));
-    if (!tmpcolidx) return errno;
-    double * tmpa = malloc(rowsizemax * sizeof(double));
-    if (!tmpa) { free(tmpcolidx); return errno; }
-    #pragma omp parallel
+static int ellgemv_sve(
+    idx_t num_rows,
+    vec_t * __restrict y,
+    idx_t num_columns,
+    const vec_t * __restrict x,
+    int64_t ellsize,
+    idx_t rowsize,
+    const idx_t * __restrict colidx,
+    const val_t * __restrict a)
+{
+    const int64_t vl = svcntd();
+#ifdef _OPENMP
+    #pragma omp for nowait
+#endif
     for (idx_t i = 0; i < num_rows; i++) {
-        idx_t rowlen = rowptr[i+1]-rowptr[i];
-        if (rowlen <= threshold) continue;
-
-        /* #pragma omp single */
-        /* fprintf(stderr, "i=%d, rowlen=%d\n", i, rowlen); */
-
-        idx_t p = threshold;
-        #pragma omp for
-        for (idx_t q = 0; q < rowlen-1; q += p) {
-            idx_t r = q+p < rowlen ? q+p : rowlen;
-            for (int64_t k = q+1; k < r; k++) {
-                idx_t j = colidx[rowptr[i]+k];
-                double b = a[rowptr[i]+k];
-                int64_t l = rowptr[i]+k-1;
-                while (l >= rowptr[i]+q && colidx[l] > j) {
-                    colidx[l+1] = colidx[l];
-                    a[l+1] = a[l];
-                    l--;
-                }
-                colidx[l+1] = j;
-                a[l+1] = b;
-            }
-        }
-
-        for (; p < rowlen; p*=2) {
-            /* fprintf(stderr, "a) t=%d, i=%d, p=%d, rowlen=%d\n", omp_get_thread_num(), i, p, rowlen); */
-
-            #pragma omp for
-            for (idx_t k = 0; k < rowlen; k++) {
-                tmpcolidx[k] = colidx[rowptr[i]+k];
-                tmpa[k] = a[rowptr[i]+k];
-            }
-
-            #pragma omp for
-            for (idx_t q = 0; q < rowlen-1; q += 2*p) {
-                idx_t left = q;
-                idx_t middle = q+p < rowlen ? q+p : rowlen;
-                idx_t right = q+2*p < rowlen ? q+2*p : rowlen;
-
-                /* printf("i=%d: merging [", i); */
-                /* for (idx_t j = left; j < middle; j++) printf(" %d", tmpcolidx[j]); */
-                /* printf("] and ["); */
-                /* for (idx_t j = middle; j < right; j++) printf(" %d", tmpcolidx[j]); */
-                /* printf("] -> "); */
-
-                idx_t u = left, v = left, w = middle;
-                while (v < middle && w < right) {
-                    if (tmpcolidx[v] < tmpcolidx[w]) {
-                        colidx[rowptr[i]+u] = tmpcolidx[v]; a[rowptr[i]+u] = tmpa[v++]; u++;
-                    } else {
-                        colidx[rowptr[i]+u] = tmpcolidx[w]; a[rowptr[i]+u] = tmpa[w++]; u++;
-                    }
-                }
-                while (v < middle) {
-                    colidx[rowptr[i]+u] = tmpcolidx[v]; a[rowptr[i]+u] = tmpa[v++]; u++;
-                }
-                while (w < right) {
-                    colidx[rowptr[i]+u] = tmpcolidx[w]; a[rowptr[i]+u] = tmpa[w++]; u++;
-                }
-
-                /* printf("["); */
-                /* for (idx_t j = left; j < right; j++) printf(" %d", colidx[rowptr[i]+j]); */
-                /* printf("]\n"); */
-            }
-
-            /* fprintf(stderr, "b) t=%d, i=%d, p=%d, rowlen=%d\n", omp_get_thread_num(), i, p, rowlen); */
+        svfloat64_t yi = svdup_f64(0.0);
+        for (int64_t l = 0; l < rowsize; l += vl) {
+            svbool_t pg = svwhilelt_b64_s64(l, rowsize);
+            svfloat64_t al = svld1_f64(pg, &a[i*rowsize+l]);
+            svfloat64_t xl = gather_sve(pg, &colidx[i*rowsize+l], x);
+            yi = svmla_f64_m(pg, yi, al, xl);
         }
+        y[i] += svaddv_f64(svptrue_b64(), yi);
     }
-    free(tmpa); free(tmpcolidx);
+    return 0;
+}
 
-#if 0
-    /* verify that rows are sorted */
+static int ellgemvsd_sve(
+    idx_t num_rows,
+    vec_t * __restrict y,
+    idx_t num_columns,
+    const vec_t * __restrict x,
+    int64_t ellsize,
+    idx_t rowsize,
+    const idx_t * __restrict colidx,
+    const val_t * __restrict a,
+    const val_t * __restrict ad)
+{
+    const int64_t vl = svcntd();
+#ifdef _OPENMP
+    #pragma omp for nowait
+#endif
     for (idx_t i = 0; i < num_rows; i++) {
-        for (int64_t k = rowptr[i]+1; k < rowptr[i+1]; k++) {
-            if (colidx[k] < colidx[k-1]) return EINVAL;
+        svfloat64_t yi = svdup_f64(0.0);
+        for (int64_t l = 0; l < rowsize; l += vl) {
+            svbool_t pg = svwhilelt_b64_s64(l, rowsize);
+            svfloat64_t al = svld1_f64(pg, &a[i*rowsize+l]);
+            svfloat64_t xl = gather_sve(pg, &colidx[i*rowsize+l], x);
+            yi = svmla_f64_m(pg, yi, al, xl);
         }
+        y[i] += ad[i]*x[i] + svaddv_f64(svptrue_b64(), yi);
     }
-#endif
     return 0;
 }
 
-static int ell_from_coo(
+static int ellgemvcm_sve(
     idx_t num_rows,
+    vec_t * __restrict y,
     idx_t num_columns,
-    int64_t num_nonzeros,
-    const idx_t * rowidx,
-    const idx_t * colidx,
-    const double * a,
-    int64_t * rowptr,
+    const vec_t * __restrict x,
     int64_t ellsize,
     idx_t rowsize,
-    idx_t * ellcolidx,
-    double * ella,
-    double * ellad,
-    bool separate_diagonal,
-    bool sort_rows)
+    const idx_t * __restrict colidx,
+    const val_t * __restrict a)
 {
-    for (idx_t i = 0; i <= num_rows; i++) rowptr[i] = 0;
-    for (int64_t k = 0; k < num_nonzeros; k++) {
-        if (separate_diagonal && rowidx[k] == colidx[k]) {
-            ellad[rowidx[k]-1] += a[k];
-        } else {
-            idx_t i = rowidx[k]-1;
-            ellcolidx[i*rowsize+rowptr[i]] = colidx[k]-1;
-            ella[i*rowsize+rowptr[i]] = a[k];
-            rowptr[i]++;
-        }
-    }
+    const int64_t vl = svcntd();
 #ifdef _OPENMP
-    #pragma omp for
+    #pragma omp for nowait
 #endif
-    for (idx_t i = 0; i < num_rows; i++) {
-        idx_t j =  i < num_columns ? i : num_columns-1;
-        for (int64_t l = rowptr[i]; l < rowsize; l++) {
-            ellcolidx[i*rowsize+l] = j;
-            ella[i*rowsize+l] = 0.0;
+    for (int64_t i = 0; i < num_rows; i += vl) {
+        svbool_t pg = svwhilelt_b64_s64(i, num_rows);
+        svfloat64_t yi = svdup_f64(0.0);
+        for (idx_t l = 0; l < rowsize; l++) {
+            svfloat64_t al = svld1_f64(pg, &a[l*num_rows+i]);
+            svfloat64_t xl = gather_sve(pg, &colidx[l*num_rows+i], x);
+            yi = svmla_f64_m(pg, yi, al, xl);
         }
-    }
-
-    /* If requested, sort nonzeros by column within each row */
-    if (sort_rows) {
-        int err = rowsort(
-            num_rows, num_columns,
-            rowptr, rowsize, ellcolidx, ella);
-        if (err) return err;
+        svst1_f64(pg, &y[i], svadd_f64_m(pg, svld1_f64(pg, &y[i]), yi));
     }
     return 0;
 }
 
-static int ellgemv(
+static int ellgemvcmsd_sve(
     idx_t num_rows,
-    double * __restrict y,
+    vec_t * __restrict y,
     idx_t num_columns,
-    const double * __restrict x,
+    const vec_t * __restrict x,
     int64_t ellsize,
     idx_t rowsize,
     const idx_t * __restrict colidx,
-    const double * __restrict a)
+    const val_t * __restrict a,
+    const val_t * __restrict ad)
+{
+    const int64_t vl = svcntd();
+#ifdef _OPENMP
+    #pragma omp for nowait
+#endif
+    for (int64_t i = 0; i < num_rows; i += vl) {
+        svbool_t pg = svwhilelt_b64_s64(i, num_rows);
+        svfloat64_t yi = svmul_f64_z(pg, svld1_f64(pg, &ad[i]), svld1_f64(pg, &x[i]));
+        for (idx_t l = 0; l < rowsize; l++) {
+            svfloat64_t al = svld1_f64(pg, &a[l*num_rows+i]);
+            svfloat64_t xl = gather_sve(pg, &colidx[l*num_rows+i], x);
+            yi = svmla_f64_m(pg, yi, al, xl);
+        }
+        svst1_f64(pg, &y[i], svadd_f64_m(pg, svld1_f64(pg, &y[i]), yi));
+    }
+    return 0;
+}
+#endif
+
+static int sellgemv(
+    idx_t num_rows,
+    vec_t * __restrict y,
+    idx_t num_columns,
+    const vec_t * __restrict x,
+    int64_t sellsize,
+    idx_t chunksize,
+    const int64_t * __restrict chunkptr,
+    const idx_t * __restrict perm,
+    const idx_t * __restrict colidx,
+    const val_t * __restrict a)
 {
 #if defined(__FCC_version__) && defined(USE_A64FX_SECTOR_CACHE)
     #pragma procedure scache_isolate_assign a, colidx
 #endif
 
+    if (chunksize > SELL_MAX_CHUNK_SIZE) return EINVAL;
+    idx_t num_chunks = (num_rows + chunksize - 1) / chunksize;
 #ifdef _OPENMP
-    #pragma omp for simd
+    #pragma omp for nowait
 #endif
-    for (idx_t i = 0; i < num_rows; i++) {
-        double yi = 0;
-        for (idx_t l = 0; l < rowsize; l++)
-            yi += a[i*rowsize+l] * x[colidx[i*rowsize+l]];
-        y[i] += yi;
+    for (idx_t c = 0; c < num_chunks; c++) {
+        const idx_t * __restrict chunkcolidx = &colidx[chunkptr[c]];
+        const val_t * __restrict chunka = &a[chunkptr[c]];
+        idx_t chunklen = (chunkptr[c+1]-chunkptr[c]) / chunksize;
+        double yc[SELL_MAX_CHUNK_SIZE];
+        for (idx_t r = 0; r < chunksize; r++) yc[r] = 0;
+        for (idx_t l = 0; l < chunklen; l++) {
+#ifdef _OPENMP
+            #pragma omp simd
+#endif
+            for (idx_t r = 0; r < chunksize; r++)
+                yc[r] += chunka[l*chunksize+r] * x[chunkcolidx[l*chunksize+r]];
+        }
+        idx_t n = num_rows - c*chunksize < chunksize ? num_rows - c*chunksize : chunksize;
+        for (idx_t r = 0; r < n; r++) y[perm[c*chunksize+r]] += yc[r];
     }
     return 0;
 }
 
-static int ellgemvsd(
+static int sellgemvsd(
     idx_t num_rows,
-    double * __restrict y,
+    vec_t * __restrict y,
     idx_t num_columns,
-    const double * __restrict x,
-    int64_t ellsize,
-    idx_t rowsize,
+    const vec_t * __restrict x,
+    int64_t sellsize,
+    idx_t chunksize,
+    const int64_t * __restrict chunkptr,
+    const idx_t * __restrict perm,
+    const idx_t * __restrict colidx,
+    const val_t * __restrict a,
+    const val_t * __restrict ad)
+{
+#if defined(__FCC_version__) && defined(USE_A64FX_SECTOR_CACHE)
+    #pragma procedure scache_isolate_assign a, ad, colidx
+#endif
+
+    if (chunksize > SELL_MAX_CHUNK_SIZE) return EINVAL;
+    idx_t num_chunks = (num_rows + chunksize - 1) / chunksize;
+#ifdef _OPENMP
+    #pragma omp for nowait
+#endif
+    for (idx_t c = 0; c < num_chunks; c++) {
+        const idx_t * __restrict chunkcolidx = &colidx[chunkptr[c]];
+        const val_t * __restrict chunka = &a[chunkptr[c]];
+        idx_t chunklen = (chunkptr[c+1]-chunkptr[c]) / chunksize;
+        double yc[SELL_MAX_CHUNK_SIZE];
+        for (idx_t r = 0; r < chunksize; r++) yc[r] = 0;
+        for (idx_t l = 0; l < chunklen; l++) {
+#ifdef _OPENMP
+            #pragma omp simd
+#endif
+            for (idx_t r = 0; r < chunksize; r++)
+                yc[r] += chunka[l*chunksize+r] * x[chunkcolidx[l*chunksize+r]];
+        }
+        idx_t n = num_rows - c*chunksize < chunksize ? num_rows - c*chunksize : chunksize;
+        for (idx_t r = 0; r < n; r++) {
+            idx_t i = perm[c*chunksize+r];
+            y[i] += ad[i]*x[i] + yc[r];
+        }
+    }
+    return 0;
+}
+
+/**
+ * ‘coogemv()’ multiplies the coordinate part of a matrix in hybrid
+ * (HYB) format by a vector, where the nonzeros are sorted by row.
+ *
+ * The nonzeros are divided evenly among threads, regardless of row
+ * boundaries. A thread updates ‘y’ directly for rows whose nonzeros
+ * all belong to it, whereas the partial sums of its first and last
+ * rows, if these are shared with other threads, are stored in
+ * ‘carryrows’ and ‘carryvals’, which must each have room for two
+ * elements per thread. The partial sums are added to ‘y’ after a
+ * barrier, so that no atomic operations are needed.
+ */
+static int coogemv(
+    idx_t num_rows,
+    vec_t * __restrict y,
+    idx_t num_columns,
+    const vec_t * __restrict x,
+    int64_t coosize,
+    const idx_t * __restrict rowidx,
     const idx_t * __restrict colidx,
-    const double * __restrict a,
-    const double * __restrict ad)
+    const val_t * __restrict a,
+    idx_t * __restrict carryrows,
+    double * __restrict carryvals)
 {
 #if defined(__FCC_version__) && defined(USE_A64FX_SECTOR_CACHE)
-    #pragma procedure scache_isolate_assign a, ad, colidx
+    #pragma procedure scache_isolate_assign a, rowidx, colidx
 #endif
 
 #ifdef _OPENMP
-    #pragma omp for simd
-#endif
-    for (idx_t i = 0; i < num_rows; i++) {
+    int nthreads = omp_get_num_threads();
+    int p = omp_get_thread_num();
+    int64_t k = p*coosize/nthreads;
+    int64_t end = (p+1)*coosize/nthreads;
+    carryrows[2*p] = carryrows[2*p+1] = num_rows;
+
+    /* a first row that is shared with the preceding thread */
+    if (k < end && k > 0 && rowidx[k] == rowidx[k-1]) {
+        idx_t i = rowidx[k];
         double yi = 0;
-        for (idx_t l = 0; l < rowsize; l++)
-            yi += a[i*rowsize+l] * x[colidx[i*rowsize+l]];
-        y[i] += ad[i]*x[i] + yi;
+        for (; k < end && rowidx[k] == i; k++)
+            yi += a[k] * x[colidx[k]];
+        carryrows[2*p] = i;
+        carryvals[2*p] = yi;
+    }
+    while (k < end) {
+        idx_t i = rowidx[k];
+        double yi = 0;
+        for (; k < end && rowidx[k] == i; k++)
+            yi += a[k] * x[colidx[k]];
+        if (k < coosize && rowidx[k] == i) {
+            /* the last row is shared with the subsequent thread */
+            carryrows[2*p+1] = i;
+            carryvals[2*p+1] = yi;
+        } else { y[i] += yi; }
+    }
+    #pragma omp barrier
+    #pragma omp master
+    for (int q = 0; q < 2*nthreads; q++) {
+        if (carryrows[q] < num_rows) y[carryrows[q]] += carryvals[q];
     }
+    #pragma omp barrier
+#else
+    for (int64_t k = 0; k < coosize; k++)
+        y[rowidx[k]] += a[k] * x[colidx[k]];
+#endif
     return 0;
 }
 
-static int ellgemv16sd(
+/**
+ * ‘ellgemvcz()’ multiplies a matrix in ELLPACK format by a vector,
+ * where the column offsets of the matrix have been compressed by
+ * ‘ell_compress_colidx()’.
+ *
+ * Blocks of rows are distributed among threads, and the column
+ * offsets of each narrow block are decoded on the fly by adding the
+ * 16-bit offsets to the block's base column.
+ */
+static int ellgemvcz(
     idx_t num_rows,
-    double * __restrict y,
+    vec_t * __restrict y,
     idx_t num_columns,
-    const double * __restrict x,
+    const vec_t * __restrict x,
     int64_t ellsize,
     idx_t rowsize,
-    const idx_t * __restrict colidx,
-    const double * __restrict a,
-    const double * __restrict ad)
+    idx_t blocksize,
+    const idx_t * __restrict blockbase,
+    const int64_t * __restrict blockwideptr,
+    const uint16_t * __restrict colidx16,
+    const idx_t * __restrict colidxwide,
+    const val_t * __restrict a,
+    const val_t * __restrict ad)
 {
 #if defined(__FCC_version__) && defined(USE_A64FX_SECTOR_CACHE)
-    #pragma procedure scache_isolate_assign a, ad, colidx
+    #pragma procedure scache_isolate_assign a, colidx16, colidxwide
 #endif
 
-    if (rowsize != 16) return EINVAL;
+    idx_t num_blocks = (num_rows + blocksize - 1) / blocksize;
 #ifdef _OPENMP
-    #pragma omp for simd
+    #pragma omp for nowait
 #endif
-    for (idx_t i = 0; i < num_rows; i++) {
-        y[i] += ad[i]*x[i] +
-            a[i*16+ 0] * x[colidx[i*16+ 0]] +
-            a[i*16+ 1] * x[colidx[i*16+ 1]] +
-            a[i*16+ 2] * x[colidx[i*16+ 2]] +
-            a[i*16+ 3] * x[colidx[i*16+ 3]] +
-            a[i*16+ 4] * x[colidx[i*16+ 4]] +
-            a[i*16+ 5] * x[colidx[i*16+ 5]] +
-            a[i*16+ 6] * x[colidx[i*16+ 6]] +
-            a[i*16+ 7] * x[colidx[i*16+ 7]] +
-            a[i*16+ 8] * x[colidx[i*16+ 8]] +
-            a[i*16+ 9] * x[colidx[i*16+ 9]] +
-            a[i*16+10] * x[colidx[i*16+10]] +
-            a[i*16+11] * x[colidx[i*16+11]] +
-            a[i*16+12] * x[colidx[i*16+12]] +
-            a[i*16+13] * x[colidx[i*16+13]] +
-            a[i*16+14] * x[colidx[i*16+14]] +
-            a[i*16+15] * x[colidx[i*16+15]];
+    for (idx_t b = 0; b < num_blocks; b++) {
+        idx_t startrow = b*blocksize;
+        idx_t endrow = num_rows - startrow < blocksize ? num_rows : startrow+blocksize;
+        if (blockwideptr[b+1] > blockwideptr[b]) {
+            const idx_t * __restrict bcolidx = &colidxwide[blockwideptr[b]];
+            const val_t * __restrict ba = &a[(int64_t) startrow*rowsize];
+            for (idx_t i = 0; i < endrow-startrow; i++) {
+                double yi = 0;
+                for (idx_t l = 0; l < rowsize; l++)
+                    yi += ba[i*rowsize+l] * x[bcolidx[i*rowsize+l]];
+                y[startrow+i] += yi;
+            }
+        } else {
+            const uint16_t * __restrict bcolidx =
+                &colidx16[(int64_t) startrow*rowsize - blockwideptr[b]];
+            const val_t * __restrict ba = &a[(int64_t) startrow*rowsize];
+            const vec_t * __restrict bx = &x[blockbase[b]];
+            for (idx_t i = 0; i < endrow-startrow; i++) {
+                double yi = 0;
+                for (idx_t l = 0; l < rowsize; l++)
+                    yi += ba[i*rowsize+l] * bx[bcolidx[i*rowsize+l]];
+                y[startrow+i] += yi;
+            }
+        }
+        if (ad) {
+            for (idx_t i = startrow; i < endrow; i++)
+                y[i] += ad[i]*x[i];
+        }
     }
     return 0;
 }
@@ -1215,290 +6010,512 @@ static int ellgemv16sd(
 /**
  * `main()`.
  */
-int main(int argc, char *argv[])
-{
-    int err;
-    struct timespec t0, t1;
-    setlocale(LC_ALL, "");
+/*
+ * benchmark phases
+ */
 
-#ifdef HAVE_ALIGNED_ALLOC
-    long pagesize = sysconf(_SC_PAGESIZE);
+/**
+ * ‘benchmark’ is the state of a benchmark between its phases, which
+ * are reading the matrix and vectors, converting the matrix to
+ * ELLPACK, sliced ELLPACK or hybrid format and performing the
+ * multiplications. The matrix in coordinate format and the vectors
+ * are kept in a ‘spmv_problem’ instead, so that the ‘spmv’ driver
+ * can benchmark several formats with the same matrix and vectors.
+ */
+struct benchmark
+{
+    struct program_options args;
+    struct binfile_header binheader;
+#ifdef HAVE_PAPI
+    struct papi_util_opt papi_opt;
 #endif
+    idx_t num_chunks;
+    int64_t * sellchunkptr;
+    idx_t * sellperm;
+    int64_t ellsize;
+    idx_t rowsize, rowsizemax;
+    idx_t diagsize;
+    int64_t num_padding;
+    int64_t rowlenmin, rowlenmax;
+    idx_t * ellcolidx;
+    val_t * ella, * ellad;
+    int64_t coosize;
+    idx_t * coorowidx, * coocolidx;
+    val_t * cooa;
+    idx_t * coocarryrows;
+    double * coocarryvals;
+};
 
-    /* Set program invocation name. */
-    program_invocation_name = argv[0];
-    program_invocation_short_name = (
-        strrchr(program_invocation_name, '/')
-        ? strrchr(program_invocation_name, '/') + 1
-        : program_invocation_name);
+/**
+ * ‘benchmark_free()’ frees the converted matrix and the program
+ * options of a benchmark.
+ */
+static void benchmark_free(
+    struct benchmark * b)
+{
+    free(b->coocarryvals); free(b->coocarryrows); free(b->cooa); free(b->coocolidx); free(b->coorowidx);
+    array_free(b->ellad); array_free(b->ella); array_free(b->ellcolidx);
+    free(b->sellperm); free(b->sellchunkptr);
+    program_options_free(&b->args);
+}
 
-    /* 1. Parse program options. */
-    struct program_options args;
+/**
+ * ‘benchmark_options()’ parses the program options, applies the
+ * options from a tuning file, if one is given without ‘--autotune’,
+ * and checks that the options can be used together.
+ *
+ * If an error occurs, a message is printed, the options are freed
+ * and ‘EXIT_FAILURE’ is returned.
+ */
+static int benchmark_options(
+    int argc,
+    char * argv[],
+    struct program_options * args)
+{
     int nargs;
-    err = parse_program_options(argc, argv, &args, &nargs);
+    int err = parse_program_options(argc, argv, args, &nargs);
     if (err) {
         fprintf(stderr, "%s: %s %s\n", program_invocation_short_name,
                 strerror(err), argv[nargs]);
         return EXIT_FAILURE;
     }
 
-#ifdef _OPENMP
-#pragma omp parallel
+    /*
+     * A generated matrix has no file from which to obtain the hash
+     * that identifies the matrix in a tuning file.
+     */
+    if (args->generate != generate_none &&
+        (args->load_binary_path || args->tuning_file))
     {
-      /*
-       * This empty parallel section is used to make the OpenMP
-       * runtime output its configuration now if the environment
-       * variable OMP_DISPLAY_ENV is set.
-       */
+        fprintf(stderr, "%s: %s\n", program_invocation_short_name,
+                "--generate cannot be used with --load-binary or --tuning-file");
+        program_options_free(args);
+        return EXIT_FAILURE;
     }
-#endif
 
-    /* 2. Read the matrix from a Matrix Market file. */
-    if (args.verbose > 0) {
-        fprintf(stderr, "mtxfile_read: ");
-        clock_gettime(CLOCK_MONOTONIC, &t0);
+    /*
+     * A benchmark report summarises the measured repetitions, so at
+     * least one is needed.
+     */
+    if ((args->output != output_none || args->autotune) && args->repeat <= 0) {
+        fprintf(stderr, "%s: %s\n", program_invocation_short_name,
+                "--output and --autotune require --repeat to be at least 1");
+        program_options_free(args);
+        return EXIT_FAILURE;
     }
 
-    enum streamtype streamtype;
-    union stream stream;
-#ifdef HAVE_LIBZ
-    if (!args.gzip) {
-#endif
-        streamtype = stream_stdio;
-        if ((stream.f = fopen(args.Apath, "r")) == NULL) {
-            fprintf(stderr, "%s: %s: %s\n",
-                    program_invocation_short_name, args.Apath, strerror(errno));
-            program_options_free(&args);
+    /* Use the options that were saved for the matrix in a tuning file. */
+    if (!args->autotune && args->tuning_file) {
+        err = apply_tuning_file(argc, argv, "ellspmv", args, &nargs);
+        if (err) {
+            fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(err));
+            program_options_free(args);
             return EXIT_FAILURE;
         }
-#ifdef HAVE_LIBZ
-    } else {
-        streamtype = stream_zlib;
-        if ((stream.gzf = gzopen(args.Apath, "r")) == NULL) {
-            fprintf(stderr, "%s: %s: %s\n",
-                    program_invocation_short_name, args.Apath, strerror(errno));
-            program_options_free(&args);
+    }
+
+    /*
+     * Binary files store the matrix after conversion, whereas the
+     * vectors are always given in the original order, so reordering
+     * is only performed when reading Matrix Market files.
+     */
+    if (args->reorder != reorder_none &&
+        (args->load_binary_path || args->save_binary_path))
+    {
+        fprintf(stderr, "%s: %s\n", program_invocation_short_name,
+                "--reorder cannot be used with --load-binary or --save-binary");
+        program_options_free(args);
+        return EXIT_FAILURE;
+    }
+    if (args->format == format_hyb &&
+        (args->load_binary_path || args->save_binary_path))
+    {
+        fprintf(stderr, "%s: %s\n", program_invocation_short_name,
+                "--format=hyb cannot be used with --load-binary or --save-binary");
+        program_options_free(args);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+#ifdef HAVE_PAPI
+/**
+ * ‘benchmark_papi_setup()’ configures hardware performance monitoring
+ * with PAPI, if an event file is given.
+ */
+static int benchmark_papi_setup(
+    struct benchmark * b)
+{
+    int papierr = 0;
+    struct papi_util_opt papi_opt = {
+        .event_file = b->args.papi_event_file,
+        .print_csv = b->args.papi_event_format == 1,
+        .print_threads = b->args.papi_event_per_thread,
+        .print_summary = b->args.papi_event_summary,
+        .print_region = 0,
+        .component = 0,
+        .multiplex = 0,
+        .output = stderr
+    };
+    b->papi_opt = papi_opt;
+    if (papi_opt.event_file) {
+        fprintf(stderr, "[PAPI util] using event file: %s\n", papi_opt.event_file);
+        int err = PAPI_UTIL_setup(&b->papi_opt, &papierr);
+        if (err) {
+            fprintf(stderr, "%s: %s\n",
+                    program_invocation_short_name, PAPI_UTIL_strerror(err, papierr));
             return EXIT_FAILURE;
         }
     }
+    return EXIT_SUCCESS;
+}
 #endif
 
-    enum mtxobject object;
-    enum mtxformat format;
-    enum mtxfield field;
-    enum mtxsymmetry symmetry;
-    idx_t num_rows;
-    idx_t num_columns;
-    int64_t num_nonzeros;
-    int64_t lines_read = 0;
-    int64_t bytes_read = 0;
-    err = mtxfile_fread_header(
-        &object, &format, &field, &symmetry,
-        &num_rows, &num_columns, &num_nonzeros,
-        streamtype, stream, &lines_read, &bytes_read);
-    if (err) {
-        if (args.verbose > 0) fprintf(stderr, "\n");
-        fprintf(stderr, "%s: %s:%"PRId64": %s\n",
-                program_invocation_short_name,
-                args.Apath, lines_read+1, strerror(err));
-        stream_close(streamtype, stream);
-        program_options_free(&args);
-        return EXIT_FAILURE;
-    }
+/**
+ * ‘benchmark_read()’ reads the matrix from a Matrix Market file, or
+ * generates it, and, if requested, reorders its rows and columns.
+ * Then the source and destination vectors are read, if they are
+ * given. For a binary file, only the header is read.
+ *
+ * The arrays are stored in ‘A’ even if an error occurs, so that they
+ * are freed by ‘spmv_problem_free()’.
+ */
+static int benchmark_read(
+    struct benchmark * b,
+    struct spmv_problem * A)
+{
+    int err = 0;
+    int status = EXIT_FAILURE;
+    struct timespec t0, t1;
+    struct program_options * args = &b->args;
+    enum mtxsymmetry symmetry = mtxgeneral;
+    idx_t num_rows = 0;
+    idx_t num_columns = 0;
+    int64_t num_nonzeros = 0;
+    int num_vectors = args->num_vectors;
+    idx_t * rowidx = NULL, * colidx = NULL;
+    double * a = NULL;
+    idx_t * rowperm = NULL;
+    vec_t * x = NULL, * y = NULL;
 #ifdef HAVE_ALIGNED_ALLOC
-    size_t rowidxsize = num_nonzeros*sizeof(idx_t);
-    idx_t * rowidx = aligned_alloc(pagesize, rowidxsize + pagesize - rowidxsize % pagesize);
-#else
-    idx_t * rowidx = malloc(num_nonzeros * sizeof(idx_t));
+    long pagesize = sysconf(_SC_PAGESIZE);
 #endif
-    if (!rowidx) {
-        if (args.verbose > 0) fprintf(stderr, "\n");
-        fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(errno));
-        stream_close(streamtype, stream);
-        program_options_free(&args);
-        return EXIT_FAILURE;
-    }
+
+    /*
+     * 2. Read the matrix from a Matrix Market file, or read the
+     * header of a binary file containing a matrix in ELLPACK format.
+     */
+    if (args->load_binary_path) {
+        err = binfile_read_header(args->load_binary_path, &b->binheader);
+        if (!err && b->binheader.format != binfile_ell && b->binheader.format != binfile_sell)
+            err = EINVAL;
+        if (err) {
+            fprintf(stderr, "%s: %s: %s\n",
+                    program_invocation_short_name,
+                    args->load_binary_path, strerror(err));
+            goto cleanup;
+        }
+        if (b->binheader.idxtypewidth != sizeof(idx_t)*CHAR_BIT) {
+            fprintf(stderr, "%s: %s: expected %d-bit row/column offsets, "
+                    "but the matrix was saved with %"PRIu32"-bit offsets\n",
+                    program_invocation_short_name, args->load_binary_path,
+                    (int) (sizeof(idx_t)*CHAR_BIT), b->binheader.idxtypewidth);
+            goto cleanup;
+        }
+        if (b->binheader.valtypewidth != sizeof(val_t)*CHAR_BIT) {
+            fprintf(stderr, "%s: %s: expected %d-bit matrix values, "
+                    "but the matrix was saved with %"PRIu32"-bit values\n",
+                    program_invocation_short_name, args->load_binary_path,
+                    (int) (sizeof(val_t)*CHAR_BIT), b->binheader.valtypewidth);
+            goto cleanup;
+        }
+        num_rows = b->binheader.num_rows;
+        num_columns = b->binheader.num_columns;
+        num_nonzeros = b->binheader.num_nonzeros;
+        bool sell = b->binheader.format == binfile_sell;
+        bool sellvalid = b->binheader.chunksize > 0 &&
+            b->binheader.chunksize <= SELL_MAX_CHUNK_SIZE && b->binheader.sigma > 0;
+        int64_t num_chunks = sellvalid
+            ? (num_rows + b->binheader.chunksize - 1) / b->binheader.chunksize : 0;
+        if (b->binheader.num_arrays != (sell ? 5 : 3) ||
+            (!sell && b->binheader.size != num_rows * b->binheader.rowsizemax) ||
+            (sell && !sellvalid) ||
+            b->binheader.sizes[0] != b->binheader.size*sizeof(idx_t) ||
+            b->binheader.sizes[1] != b->binheader.size*sizeof(val_t) ||
+            b->binheader.sizes[2] != b->binheader.diagsize*sizeof(val_t) ||
+            (sell && b->binheader.sizes[3] != (num_chunks+1)*sizeof(int64_t)) ||
+            (sell && b->binheader.sizes[4] != num_rows*sizeof(idx_t)))
+        {
+            fprintf(stderr, "%s: %s: %s\n",
+                    program_invocation_short_name,
+                    args->load_binary_path, strerror(EINVAL));
+            goto cleanup;
+        }
+
+        /*
+         * The matrix is used as it was stored, so the storage format
+         * and any options that determine how the matrix is converted
+         * to ELLPACK or sliced ELLPACK format are taken from the
+         * binary file.
+         */
+        bool separate_diagonal = b->binheader.flags & binfile_separate_diagonal;
+        bool sort_rows = b->binheader.flags & binfile_sort_rows;
+        bool column_major = b->binheader.flags & binfile_column_major;
+        if (args->separate_diagonal != separate_diagonal) {
+            fprintf(stderr, "%s: warning: %s: diagonal nonzeros are %sstored separately\n",
+                    program_invocation_short_name, args->load_binary_path,
+                    separate_diagonal ? "" : "not ");
+        }
+        if (args->sort_rows != sort_rows) {
+            fprintf(stderr, "%s: warning: %s: nonzeros are %ssorted by column within each row\n",
+                    program_invocation_short_name, args->load_binary_path,
+                    sort_rows ? "" : "not ");
+        }
+        if (!sell && args->column_major != column_major) {
+            fprintf(stderr, "%s: warning: %s: nonzeros are stored in %s order\n",
+                    program_invocation_short_name, args->load_binary_path,
+                    column_major ? "column-major" : "row-major");
+        }
+        args->separate_diagonal = separate_diagonal;
+        args->sort_rows = sort_rows;
+        args->column_major = column_major;
+        args->format = sell ? format_sell : format_ell;
+        if (sell) {
+            args->chunk_size = b->binheader.chunksize;
+            args->sigma = b->binheader.sigma;
+        }
+    } else if (args->generate != generate_none) {
+        if (args->verbose > 0) {
+            fprintf(stderr, "generate_matrix: ");
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+        }
+#ifdef HAVE_PAPI
+        PAPI_UTIL_region_begin("generate_matrix", NULL);
+#endif
+        err = generate_size(
+            args->generate, args->generate_size, args->generate_bandwidth,
+            args->generate_rowsize, &num_rows, &num_columns, &num_nonzeros);
+        if (err) {
+            if (args->verbose > 0) fprintf(stderr, "\n");
+            fprintf(stderr, "%s: --generate=%s: %s\n",
+                    program_invocation_short_name, args->generate_spec, strerror(err));
+            goto cleanup;
+        }
 #ifdef HAVE_ALIGNED_ALLOC
-    size_t colidxsize = num_nonzeros*sizeof(idx_t);
-    idx_t * colidx = aligned_alloc(pagesize, colidxsize + pagesize - colidxsize % pagesize);
+        size_t rowidxsize = num_nonzeros*sizeof(idx_t);
+        rowidx = aligned_alloc(pagesize, rowidxsize + pagesize - rowidxsize % pagesize);
 #else
-    idx_t * colidx = malloc(num_nonzeros * sizeof(idx_t));
+        rowidx = malloc(num_nonzeros * sizeof(idx_t));
 #endif
-    if (!colidx) {
-        if (args.verbose > 0) fprintf(stderr, "\n");
-        fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(errno));
-        free(rowidx);
-        stream_close(streamtype, stream);
-        program_options_free(&args);
-        return EXIT_FAILURE;
-    }
+        if (!rowidx) {
+            if (args->verbose > 0) fprintf(stderr, "\n");
+            fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(errno));
+            goto cleanup;
+        }
 #ifdef HAVE_ALIGNED_ALLOC
-    size_t asize = num_nonzeros*sizeof(double);
-    double * a = aligned_alloc(pagesize, asize + pagesize - asize % pagesize);
+        size_t colidxsize = num_nonzeros*sizeof(idx_t);
+        colidx = aligned_alloc(pagesize, colidxsize + pagesize - colidxsize % pagesize);
 #else
-    double * a = malloc(num_nonzeros * sizeof(double));
+        colidx = malloc(num_nonzeros * sizeof(idx_t));
 #endif
-    if (!a) {
-        if (args.verbose > 0) fprintf(stderr, "\n");
-        fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(errno));
-        free(colidx); free(rowidx);
-        stream_close(streamtype, stream);
-        program_options_free(&args);
-        return EXIT_FAILURE;
-    }
-    err = mtxfile_fread_matrix_coordinate(
-        field, num_rows, num_columns, num_nonzeros, rowidx, colidx, a,
-        streamtype, stream, &lines_read, &bytes_read);
-    if (err) {
-        if (args.verbose > 0) fprintf(stderr, "\n");
-        fprintf(stderr, "%s: %s:%"PRId64": %s\n",
-                program_invocation_short_name,
-                args.Apath, lines_read+1, strerror(err));
-        free(a); free(colidx); free(rowidx);
-        stream_close(streamtype, stream);
-        program_options_free(&args);
-        return EXIT_FAILURE;
-    }
-
-    if (args.verbose > 0) {
-        clock_gettime(CLOCK_MONOTONIC, &t1);
-        fprintf(stderr, "%'.6f seconds (%'.1f MB/s)\n",
-                timespec_duration(t0, t1),
-                1.0e-6 * bytes_read / timespec_duration(t0, t1));
-    }
-    stream_close(streamtype, stream);
-
-    /* 3. Convert to ELLPACK format. */
-    if (args.verbose > 0) {
-        fprintf(stderr, "ell_from_coo: ");
-        clock_gettime(CLOCK_MONOTONIC, &t0);
-    }
-
+        if (!colidx) {
+            if (args->verbose > 0) fprintf(stderr, "\n");
+            fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(errno));
+            goto cleanup;
+        }
 #ifdef HAVE_ALIGNED_ALLOC
-    size_t rowptrsize = (num_rows+1)*sizeof(int64_t);
-    int64_t * rowptr = aligned_alloc(pagesize, rowptrsize + pagesize - rowptrsize % pagesize);
+        size_t asize = num_nonzeros*sizeof(double);
+        a = aligned_alloc(pagesize, asize + pagesize - asize % pagesize);
 #else
-    int64_t * rowptr = malloc((num_rows+1) * sizeof(int64_t));
+        a = malloc(num_nonzeros * sizeof(double));
 #endif
-    if (!rowptr) {
-        if (args.verbose > 0) fprintf(stderr, "\n");
-        fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(errno));
-        free(a); free(colidx); free(rowidx);
-        program_options_free(&args);
-        return EXIT_FAILURE;
-    }
-    int64_t ellsize;
-    idx_t rowsize;
-    idx_t diagsize;
-    err = ell_from_coo_size(
-        num_rows, num_columns, num_nonzeros, rowidx, colidx, a,
-        rowptr, &ellsize, &rowsize, &diagsize,
-        args.separate_diagonal);
-    if (err) {
-        if (args.verbose > 0) fprintf(stderr, "\n");
-        fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(err));
-        free(rowptr); free(a); free(colidx); free(rowidx);
-        program_options_free(&args);
-        return EXIT_FAILURE;
-    }
+        if (!a) {
+            if (args->verbose > 0) fprintf(stderr, "\n");
+            fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(errno));
+            goto cleanup;
+        }
+        err = generate_matrix(
+            args->generate, args->generate_size, args->generate_bandwidth,
+            args->generate_rowsize, num_rows, num_nonzeros, rowidx, colidx, a);
+        if (err) {
+            if (args->verbose > 0) fprintf(stderr, "\n");
+            fprintf(stderr, "%s: --generate=%s: %s\n",
+                    program_invocation_short_name, args->generate_spec, strerror(err));
+            goto cleanup;
+        }
+#ifdef HAVE_PAPI
+        PAPI_UTIL_region_count("nonzeros", num_nonzeros);
+        PAPI_UTIL_region_end(NULL);
+#endif
+        if (args->verbose > 0) {
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            fprintf(stderr, "%'.6f seconds, %'"PRIdx" rows, %'"PRId64" nonzeros\n",
+                    timespec_duration(t0, t1), num_rows, num_nonzeros);
+        }
+    } else {
+        if (args->verbose > 0) {
+            fprintf(stderr, "mtxfile_read: ");
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+        }
+#ifdef HAVE_PAPI
+        PAPI_UTIL_region_begin("mtxfile_read", NULL);
+#endif
+
+        enum streamtype streamtype;
+        union stream stream;
+#ifdef HAVE_LIBZ
+        if (!args->gzip) {
+#endif
+            streamtype = stream_stdio;
+            if ((stream.f = fopen(args->Apath, "r")) == NULL) {
+                fprintf(stderr, "%s: %s: %s\n",
+                        program_invocation_short_name, args->Apath, strerror(errno));
+                goto cleanup;
+            }
+#ifdef HAVE_LIBZ
+        } else {
+            streamtype = stream_zlib;
+            if ((stream.gzf = gzopen(args->Apath, "r")) == NULL) {
+                fprintf(stderr, "%s: %s: %s\n",
+                        program_invocation_short_name, args->Apath, strerror(errno));
+                goto cleanup;
+            }
+        }
+#endif
+
+        enum mtxobject object;
+        enum mtxformat format;
+        enum mtxfield field;
+        int64_t lines_read = 0;
+        int64_t bytes_read = 0;
+        err = mtxfile_fread_header(
+            &object, &format, &field, &symmetry,
+            &num_rows, &num_columns, &num_nonzeros,
+            streamtype, stream, &lines_read, &bytes_read);
+        if (err) {
+            if (args->verbose > 0) fprintf(stderr, "\n");
+            fprintf(stderr, "%s: %s:%"PRId64": %s\n",
+                    program_invocation_short_name,
+                    args->Apath, lines_read+1, strerror(err));
+            stream_close(streamtype, stream);
+            goto cleanup;
+        }
 #ifdef HAVE_ALIGNED_ALLOC
-    size_t ellcolidxsize = ellsize*sizeof(idx_t);
-    idx_t * ellcolidx = aligned_alloc(pagesize, ellcolidxsize + pagesize - ellcolidxsize % pagesize);
+        size_t rowidxsize = num_nonzeros*sizeof(idx_t);
+        rowidx = aligned_alloc(pagesize, rowidxsize + pagesize - rowidxsize % pagesize);
 #else
-    idx_t * ellcolidx = malloc(ellsize * sizeof(idx_t));
-#endif
-    if (!ellcolidx) {
-        if (args.verbose > 0) fprintf(stderr, "\n");
-        fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(errno));
-        free(rowptr); free(a); free(colidx); free(rowidx);
-        program_options_free(&args);
-        return EXIT_FAILURE;
-    }
-#ifdef _OPENMP
-    #pragma omp parallel for
+        rowidx = malloc(num_nonzeros * sizeof(idx_t));
 #endif
-    for (idx_t i = 0; i < num_rows; i++) {
-        for (idx_t l = 0; l < rowsize; l++)
-            ellcolidx[i*rowsize+l] = 0;
-    }
+        if (!rowidx) {
+            if (args->verbose > 0) fprintf(stderr, "\n");
+            fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(errno));
+            stream_close(streamtype, stream);
+            goto cleanup;
+        }
 #ifdef HAVE_ALIGNED_ALLOC
-    size_t ellasize = ellsize*sizeof(double);
-    double * ella = aligned_alloc(pagesize, ellasize + pagesize - ellasize % pagesize);
+        size_t colidxsize = num_nonzeros*sizeof(idx_t);
+        colidx = aligned_alloc(pagesize, colidxsize + pagesize - colidxsize % pagesize);
 #else
-    double * ella = malloc(ellsize * sizeof(double));
+        colidx = malloc(num_nonzeros * sizeof(idx_t));
 #endif
-    if (!ella) {
-        if (args.verbose > 0) fprintf(stderr, "\n");
-        fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(errno));
-        free(ellcolidx);
-        free(rowptr); free(a); free(colidx); free(rowidx);
-        program_options_free(&args);
-        return EXIT_FAILURE;
-    }
+        if (!colidx) {
+            if (args->verbose > 0) fprintf(stderr, "\n");
+            fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(errno));
+            stream_close(streamtype, stream);
+            goto cleanup;
+        }
 #ifdef HAVE_ALIGNED_ALLOC
-    size_t elladsize = diagsize*sizeof(double);
-    double * ellad = aligned_alloc(pagesize, elladsize + pagesize - elladsize % pagesize);
+        size_t asize = num_nonzeros*sizeof(double);
+        a = aligned_alloc(pagesize, asize + pagesize - asize % pagesize);
 #else
-    double * ellad = malloc(diagsize * sizeof(double));
+        a = malloc(num_nonzeros * sizeof(double));
 #endif
-    if (!ellad) {
-        if (args.verbose > 0) fprintf(stderr, "\n");
-        fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(errno));
-        free(ella); free(ellcolidx);
-        free(rowptr); free(a); free(colidx); free(rowidx);
-        program_options_free(&args);
-        return EXIT_FAILURE;
-    }
-#ifdef _OPENMP
-    #pragma omp parallel for
+        if (!a) {
+            if (args->verbose > 0) fprintf(stderr, "\n");
+            fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(errno));
+            stream_close(streamtype, stream);
+            goto cleanup;
+        }
+        err = mtxfile_fread_matrix_coordinate(
+            field, num_rows, num_columns, num_nonzeros, rowidx, colidx, a,
+            streamtype, stream, &lines_read, &bytes_read);
+        if (err) {
+            if (args->verbose > 0) fprintf(stderr, "\n");
+            fprintf(stderr, "%s: %s:%"PRId64": %s\n",
+                    program_invocation_short_name,
+                    args->Apath, lines_read+1, strerror(err));
+            stream_close(streamtype, stream);
+            goto cleanup;
+        }
+
+#ifdef HAVE_PAPI
+        PAPI_UTIL_region_count("nonzeros", num_nonzeros);
+        PAPI_UTIL_region_end(NULL);
 #endif
-    for (idx_t i = 0; i < num_rows; i++) {
-        ellad[i] = 0;
-        for (idx_t l = 0; l < rowsize; l++)
-            ella[i*rowsize+l] = 0;
-    }
-    err = ell_from_coo(
-        num_rows, num_columns, num_nonzeros, rowidx, colidx, a,
-        rowptr, ellsize, rowsize, ellcolidx, ella, ellad,
-        args.sort_rows, args.separate_diagonal);
-    if (err) {
-        if (args.verbose > 0) fprintf(stderr, "\n");
-        fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(err));
-        free(ellad); free(ella); free(ellcolidx);
-        free(rowptr); free(a); free(colidx); free(rowidx);
-        program_options_free(&args);
-        return EXIT_FAILURE;
+        if (args->verbose > 0) {
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            fprintf(stderr, "%'.6f seconds (%'.1f MB/s)\n",
+                    timespec_duration(t0, t1),
+                    1.0e-6 * bytes_read / timespec_duration(t0, t1));
+        }
+        stream_close(streamtype, stream);
     }
-    free(rowptr); free(a); free(colidx); free(rowidx);
 
-    if (args.verbose > 0) {
-        clock_gettime(CLOCK_MONOTONIC, &t1);
-        fprintf(stderr, "%'.6f seconds, %'"PRIdx" rows, %'"PRId64" nonzeros, %'"PRIdx" nonzeros per row\n",
-                timespec_duration(t0, t1), num_rows, ellsize + num_rows, rowsize);
-    }
 
-    /* 4. allocate vectors */
-#ifdef HAVE_ALIGNED_ALLOC
-    size_t xsize = num_columns*sizeof(double);
-    double * x = aligned_alloc(pagesize, xsize + pagesize - xsize % pagesize);
-#else
-    double * x = malloc(num_columns * sizeof(double));
-#endif
-    if (!x) {
-        if (args.verbose > 0) fprintf(stderr, "\n");
-        fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(errno));
-        free(ellad); free(ella); free(ellcolidx);
-        program_options_free(&args);
-        return EXIT_FAILURE;
+    /* If requested, reorder the rows and columns of the matrix. */
+    if (args->reorder == reorder_rcm) {
+        if (num_rows != num_columns) {
+            fprintf(stderr, "%s: %s\n", program_invocation_short_name,
+                    "--reorder requires a square matrix");
+            goto cleanup;
+        }
+        if (args->verbose > 0) {
+            fprintf(stderr, "reorder_rcm: ");
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+        }
+        err = 0;
+        idx_t bandwidth = 0, rcmbandwidth = 0;
+        int64_t profile = 0, rcmprofile = 0;
+        if (args->verbose > 0) {
+            err = coo_bandwidth(
+                num_rows, num_nonzeros, rowidx, colidx, &bandwidth, &profile);
+        }
+        if (!err) {
+            rowperm = malloc(num_rows * sizeof(idx_t));
+            if (!rowperm) err = errno;
+        }
+        if (!err) err = rcm(num_rows, num_nonzeros, rowidx, colidx, rowperm);
+        if (!err) err = coo_permute(num_rows, num_nonzeros, rowidx, colidx, rowperm);
+        if (!err && args->verbose > 0) {
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            err = coo_bandwidth(
+                num_rows, num_nonzeros, rowidx, colidx, &rcmbandwidth, &rcmprofile);
+        }
+        if (err) {
+            if (args->verbose > 0) fprintf(stderr, "\n");
+            fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(err));
+            goto cleanup;
+        }
+        if (args->verbose > 0) {
+            fprintf(stderr, "%'.6f seconds, bandwidth %'"PRIdx" (was %'"PRIdx")"
+                    ", profile %'"PRId64" (was %'"PRId64")\n",
+                    timespec_duration(t0, t1), rcmbandwidth, bandwidth,
+                    rcmprofile, profile);
+        }
     }
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-    for (idx_t j = 0; j < num_columns; j++) x[j] = 1.0;
 
-    /* read x vector from a Matrix Market file */
-    if (args.xpath) {
-        if (args.verbose > 0) {
+    /*
+     * Read the source and destination vectors, which are stored as
+     * the columns of dense matrices for multiplication with several
+     * vectors at once.
+     */
+    if (args->xpath) {
+        x = malloc((size_t) num_columns*num_vectors * sizeof(vec_t));
+        if (!x) {
+            fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(errno));
+            goto cleanup;
+        }
+        if (args->verbose > 0) {
             fprintf(stderr, "mtxfile_read: ");
             clock_gettime(CLOCK_MONOTONIC, &t0);
         }
@@ -1506,25 +6523,21 @@ int main(int argc, char *argv[])
         enum streamtype streamtype;
         union stream stream;
 #ifdef HAVE_LIBZ
-        if (!args.gzip) {
+        if (!args->gzip) {
 #endif
             streamtype = stream_stdio;
-            if ((stream.f = fopen(args.xpath, "r")) == NULL) {
+            if ((stream.f = fopen(args->xpath, "r")) == NULL) {
                 fprintf(stderr, "%s: %s: %s\n",
-                        program_invocation_short_name, args.xpath, strerror(errno));
-                free(x); free(ellad); free(ella); free(ellcolidx);
-                program_options_free(&args);
-                return EXIT_FAILURE;
+                        program_invocation_short_name, args->xpath, strerror(errno));
+                goto cleanup;
             }
 #ifdef HAVE_LIBZ
         } else {
             streamtype = stream_zlib;
-            if ((stream.gzf = gzopen(args.xpath, "r")) == NULL) {
+            if ((stream.gzf = gzopen(args->xpath, "r")) == NULL) {
                 fprintf(stderr, "%s: %s: %s\n",
-                        program_invocation_short_name, args.xpath, strerror(errno));
-                free(x); free(ellad); free(ella); free(ellcolidx);
-                program_options_free(&args);
-                return EXIT_FAILURE;
+                        program_invocation_short_name, args->xpath, strerror(errno));
+                goto cleanup;
             }
         }
 #endif
@@ -1543,40 +6556,50 @@ int main(int argc, char *argv[])
             &xnum_rows, &xnum_columns, &xnum_nonzeros,
             streamtype, stream, &lines_read, &bytes_read);
         if (err) {
-            if (args.verbose > 0) fprintf(stderr, "\n");
+            if (args->verbose > 0) fprintf(stderr, "\n");
             fprintf(stderr, "%s: %s:%"PRId64": %s\n",
                     program_invocation_short_name,
-                    args.xpath, lines_read+1, strerror(err));
+                    args->xpath, lines_read+1, strerror(err));
             stream_close(streamtype, stream);
-            free(x); free(ellad); free(ella); free(ellcolidx);
-            program_options_free(&args);
-            return EXIT_FAILURE;
-        } else if (object != mtxvector || format != mtxarray || xnum_rows != num_columns) {
-            if (args.verbose > 0) fprintf(stderr, "\n");
-            fprintf(stderr, "%s: %s:%"PRId64": "
-                    "expected vector in array format of size %"PRIdx"\n",
-                    program_invocation_short_name,
-                    args.xpath, lines_read+1, num_columns);
+            goto cleanup;
+        } else if (format != mtxarray || xnum_rows != num_columns ||
+                   (object == mtxvector && num_vectors != 1) ||
+                   (object == mtxmatrix && xnum_columns != num_vectors))
+        {
+            if (args->verbose > 0) fprintf(stderr, "\n");
+            if (num_vectors == 1) {
+                fprintf(stderr, "%s: %s:%"PRId64": "
+                        "expected vector in array format of size %"PRIdx"\n",
+                        program_invocation_short_name,
+                        args->xpath, lines_read+1, num_columns);
+            } else {
+                fprintf(stderr, "%s: %s:%"PRId64": "
+                        "expected matrix in array format of size %"PRIdx" by %d\n",
+                        program_invocation_short_name,
+                        args->xpath, lines_read+1, num_columns, num_vectors);
+            }
             stream_close(streamtype, stream);
-            free(x); free(ellad); free(ella); free(ellcolidx);
-            program_options_free(&args);
-            return EXIT_FAILURE;
+            goto cleanup;
         }
 
-        err = mtxfile_fread_vector_array(
-            field, num_rows, x, streamtype, stream, &lines_read, &bytes_read);
+        if (object == mtxvector) {
+            err = mtxfile_fread_vector_array(
+                field, num_columns, x, streamtype, stream, &lines_read, &bytes_read);
+        } else {
+            err = mtxfile_fread_matrix_array(
+                field, num_columns, num_vectors, x, streamtype, stream, &lines_read, &bytes_read);
+        }
+        if (!err && rowperm) err = vector_permute(num_columns, num_vectors, x, rowperm, false);
         if (err) {
-            if (args.verbose > 0) fprintf(stderr, "\n");
+            if (args->verbose > 0) fprintf(stderr, "\n");
             fprintf(stderr, "%s: %s:%"PRId64": %s\n",
                     program_invocation_short_name,
-                    args.xpath, lines_read+1, strerror(err));
-            free(x); free(ellad); free(ella); free(ellcolidx);
+                    args->xpath, lines_read+1, strerror(err));
             stream_close(streamtype, stream);
-            program_options_free(&args);
-            return EXIT_FAILURE;
+            goto cleanup;
         }
 
-        if (args.verbose > 0) {
+        if (args->verbose > 0) {
             clock_gettime(CLOCK_MONOTONIC, &t1);
             fprintf(stderr, "%'.6f seconds (%'.1f MB/s)\n",
                     timespec_duration(t0, t1),
@@ -1585,28 +6608,13 @@ int main(int argc, char *argv[])
         stream_close(streamtype, stream);
     }
 
-#ifdef HAVE_ALIGNED_ALLOC
-    size_t ysize = num_rows*sizeof(double);
-    double * y = aligned_alloc(pagesize, ysize + pagesize - ysize % pagesize);
-#else
-    double * y = malloc(num_rows * sizeof(double));
-#endif
-    if (!y) {
-        if (args.verbose > 0) fprintf(stderr, "\n");
-        fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(errno));
-        free(x);
-        free(ellad); free(ella); free(ellcolidx);
-        program_options_free(&args);
-        return EXIT_FAILURE;
-    }
-#ifdef _OPENMP
-    #pragma omp parallel for
-#endif
-    for (idx_t i = 0; i < num_rows; i++) y[i] = 0.0;
-
-    /* read y vector from a Matrix Market file */
-    if (args.ypath) {
-        if (args.verbose > 0) {
+    if (args->ypath) {
+        y = malloc((size_t) num_rows*num_vectors * sizeof(vec_t));
+        if (!y) {
+            fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(errno));
+            goto cleanup;
+        }
+        if (args->verbose > 0) {
             fprintf(stderr, "mtxfile_read: ");
             clock_gettime(CLOCK_MONOTONIC, &t0);
         }
@@ -1614,25 +6622,21 @@ int main(int argc, char *argv[])
         enum streamtype streamtype;
         union stream stream;
 #ifdef HAVE_LIBZ
-        if (!args.gzip) {
+        if (!args->gzip) {
 #endif
             streamtype = stream_stdio;
-            if ((stream.f = fopen(args.ypath, "r")) == NULL) {
+            if ((stream.f = fopen(args->ypath, "r")) == NULL) {
                 fprintf(stderr, "%s: %s: %s\n",
-                        program_invocation_short_name, args.ypath, strerror(errno));
-                free(y); free(x); free(ellad); free(ella); free(ellcolidx);
-                program_options_free(&args);
-                return EXIT_FAILURE;
+                        program_invocation_short_name, args->ypath, strerror(errno));
+                goto cleanup;
             }
 #ifdef HAVE_LIBZ
         } else {
             streamtype = stream_zlib;
-            if ((stream.gzf = gzopen(args.ypath, "r")) == NULL) {
+            if ((stream.gzf = gzopen(args->ypath, "r")) == NULL) {
                 fprintf(stderr, "%s: %s: %s\n",
-                        program_invocation_short_name, args.ypath, strerror(errno));
-                free(y); free(x); free(ellad); free(ella); free(ellcolidx);
-                program_options_free(&args);
-                return EXIT_FAILURE;
+                        program_invocation_short_name, args->ypath, strerror(errno));
+                goto cleanup;
             }
         }
 #endif
@@ -1651,40 +6655,50 @@ int main(int argc, char *argv[])
             &ynum_rows, &ynum_columns, &ynum_nonzeros,
             streamtype, stream, &lines_read, &bytes_read);
         if (err) {
-            if (args.verbose > 0) fprintf(stderr, "\n");
+            if (args->verbose > 0) fprintf(stderr, "\n");
             fprintf(stderr, "%s: %s:%"PRId64": %s\n",
                     program_invocation_short_name,
-                    args.ypath, lines_read+1, strerror(err));
+                    args->ypath, lines_read+1, strerror(err));
             stream_close(streamtype, stream);
-            free(y); free(x); free(ellad); free(ella); free(ellcolidx);
-            program_options_free(&args);
-            return EXIT_FAILURE;
-        } else if (object != mtxvector || format != mtxarray || ynum_rows != num_rows) {
-            if (args.verbose > 0) fprintf(stderr, "\n");
-            fprintf(stderr, "%s: %s:%"PRId64": "
-                    "expected vector in array format of size %"PRIdx"\n",
-                    program_invocation_short_name,
-                    args.ypath, lines_read+1, num_rows);
+            goto cleanup;
+        } else if (format != mtxarray || ynum_rows != num_rows ||
+                   (object == mtxvector && num_vectors != 1) ||
+                   (object == mtxmatrix && ynum_columns != num_vectors))
+        {
+            if (args->verbose > 0) fprintf(stderr, "\n");
+            if (num_vectors == 1) {
+                fprintf(stderr, "%s: %s:%"PRId64": "
+                        "expected vector in array format of size %"PRIdx"\n",
+                        program_invocation_short_name,
+                        args->ypath, lines_read+1, num_rows);
+            } else {
+                fprintf(stderr, "%s: %s:%"PRId64": "
+                        "expected matrix in array format of size %"PRIdx" by %d\n",
+                        program_invocation_short_name,
+                        args->ypath, lines_read+1, num_rows, num_vectors);
+            }
             stream_close(streamtype, stream);
-            free(y); free(x); free(ellad); free(ella); free(ellcolidx);
-            program_options_free(&args);
-            return EXIT_FAILURE;
+            goto cleanup;
         }
 
-        err = mtxfile_fread_vector_array(
-            field, num_rows, y, streamtype, stream, &lines_read, &bytes_read);
+        if (object == mtxvector) {
+            err = mtxfile_fread_vector_array(
+                field, num_rows, y, streamtype, stream, &lines_read, &bytes_read);
+        } else {
+            err = mtxfile_fread_matrix_array(
+                field, num_rows, num_vectors, y, streamtype, stream, &lines_read, &bytes_read);
+        }
+        if (!err && rowperm) err = vector_permute(num_rows, num_vectors, y, rowperm, false);
         if (err) {
-            if (args.verbose > 0) fprintf(stderr, "\n");
+            if (args->verbose > 0) fprintf(stderr, "\n");
             fprintf(stderr, "%s: %s:%"PRId64": %s\n",
                     program_invocation_short_name,
-                    args.ypath, lines_read+1, strerror(err));
-            free(y); free(x); free(ellad); free(ella); free(ellcolidx);
+                    args->ypath, lines_read+1, strerror(err));
             stream_close(streamtype, stream);
-            program_options_free(&args);
-            return EXIT_FAILURE;
+            goto cleanup;
         }
 
-        if (args.verbose > 0) {
+        if (args->verbose > 0) {
             clock_gettime(CLOCK_MONOTONIC, &t1);
             fprintf(stderr, "%'.6f seconds (%'.1f MB/s)\n",
                     timespec_duration(t0, t1),
@@ -1693,37 +6707,572 @@ int main(int argc, char *argv[])
         stream_close(streamtype, stream);
     }
 
+    status = EXIT_SUCCESS;
+
+cleanup:
+    A->symmetry = symmetry;
+    A->num_rows = num_rows;
+    A->num_columns = num_columns;
+    A->num_nonzeros = num_nonzeros;
+    A->idxsize = sizeof(idx_t);
+    A->rowidx = rowidx;
+    A->colidx = colidx;
+    A->a = a;
+    A->rowperm = rowperm;
+    A->num_vectors = num_vectors;
+    A->vecsize = sizeof(vec_t);
+    A->x = x;
+    A->y = y;
+    return status;
+}
+
+/**
+ * ‘benchmark_convert()’ converts the matrix to ELLPACK, sliced
+ * ELLPACK or hybrid format, or loads it from a binary file, and, if
+ * requested, saves it to a binary file.
+ *
+ * The arrays are stored in ‘b’ even if an error occurs, so that they
+ * are freed by ‘benchmark_free()’.
+ */
+static int benchmark_convert(
+    struct benchmark * b,
+    const struct spmv_problem * A)
+{
+    int err = 0;
+    int status = EXIT_FAILURE;
+    struct timespec t0, t1;
+    struct program_options * args = &b->args;
+    idx_t num_rows = A->num_rows;
+    idx_t num_columns = A->num_columns;
+    int64_t num_nonzeros = A->num_nonzeros;
+    const idx_t * rowidx = A->rowidx, * colidx = A->colidx;
+    const double * a = A->a;
+    int64_t * rowptr = NULL;
+    idx_t num_chunks = 0;
+    int64_t * sellchunkptr = NULL;
+    idx_t * sellperm = NULL;
+    int64_t ellsize = 0;
+    idx_t rowsize = 0;
+    idx_t rowsizemax = 0;
+    idx_t diagsize = 0;
+    int64_t num_padding = 0;
+    int64_t rowlenmin = -1, rowlenmax = -1;
+    idx_t * ellcolidx = NULL;
+    val_t * ella = NULL, * ellad = NULL;
+    int64_t coosize = 0;
+    idx_t * coorowidx = NULL, * coocolidx = NULL;
+    val_t * cooa = NULL;
+    idx_t * coocarryrows = NULL;
+    double * coocarryvals = NULL;
+#ifdef HAVE_ALIGNED_ALLOC
+    long pagesize = sysconf(_SC_PAGESIZE);
+#endif
+
     /*
-     * 5. compute the matrix-vector multiplication.
+     * 3. Convert to ELLPACK or sliced ELLPACK format, or load the
+     * matrix from a binary file.
+     */
+    const char * formatname =
+        args->format == format_sell ? "sell" : args->format == format_hyb ? "hyb" : "ell";
+    if (args->verbose > 0) {
+        if (args->load_binary_path) fprintf(stderr, "%s_load_binary: ", formatname);
+        else fprintf(stderr, "%s_from_coo: ", formatname);
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+    }
+#ifdef HAVE_PAPI
+    char regionname[32];
+    snprintf(regionname, sizeof(regionname),
+             args->load_binary_path ? "%s_load_binary" : "%s_from_coo", formatname);
+    PAPI_UTIL_region_begin(regionname, NULL);
+#endif
+
+#ifdef HAVE_ALIGNED_ALLOC
+    size_t rowptrsize = (num_rows+1)*sizeof(int64_t);
+    rowptr = aligned_alloc(pagesize, rowptrsize + pagesize - rowptrsize % pagesize);
+#else
+    rowptr = malloc((num_rows+1) * sizeof(int64_t));
+#endif
+    if (!rowptr) {
+        if (args->verbose > 0) fprintf(stderr, "\n");
+        fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(errno));
+        goto cleanup;
+    }
+
+    /*
+     * For sliced ELLPACK format, the offset to each chunk of rows and
+     * the permutation of rows that results from sorting rows by their
+     * length are also needed.
+     */
+    if (args->format == format_sell) {
+        num_chunks = (num_rows + args->chunk_size - 1) / args->chunk_size;
+#ifdef HAVE_ALIGNED_ALLOC
+        size_t sellchunkptrsize = (num_chunks+1)*sizeof(int64_t);
+        sellchunkptr = aligned_alloc(pagesize, sellchunkptrsize + pagesize - sellchunkptrsize % pagesize);
+#else
+        sellchunkptr = malloc((num_chunks+1) * sizeof(int64_t));
+#endif
+        if (!sellchunkptr) {
+            if (args->verbose > 0) fprintf(stderr, "\n");
+            fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(errno));
+            goto cleanup;
+        }
+#ifdef HAVE_ALIGNED_ALLOC
+        size_t sellpermsize = num_rows*sizeof(idx_t);
+        sellperm = aligned_alloc(pagesize, sellpermsize + pagesize - sellpermsize % pagesize);
+#else
+        sellperm = malloc(num_rows * sizeof(idx_t));
+#endif
+        if (!sellperm) {
+            if (args->verbose > 0) fprintf(stderr, "\n");
+            fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(errno));
+            goto cleanup;
+        }
+    }
+
+    int64_t binbytes = 0;
+    if (args->load_binary_path) {
+        ellsize = b->binheader.size;
+        rowsize = b->binheader.rowsizemax;
+        diagsize = b->binheader.diagsize;
+        num_padding = b->binheader.num_padding;
+        if (args->format == format_sell) {
+            err = binfile_read_array(
+                args->load_binary_path, &b->binheader, 3, sellchunkptr, &binbytes);
+            if (!err) {
+                err = binfile_read_array(
+                    args->load_binary_path, &b->binheader, 4, sellperm, &binbytes);
+            }
+            if (!err && (sellchunkptr[0] != 0 || sellchunkptr[num_chunks] != ellsize))
+                err = EINVAL;
+        } else { err = 0; }
+    } else if (args->format == format_sell) {
+        err = sell_from_coo_size(
+            num_rows, num_columns, num_nonzeros, rowidx, colidx, a,
+            rowptr, args->chunk_size, args->sigma, sellperm, sellchunkptr,
+            &ellsize, &rowsize, &diagsize, args->separate_diagonal);
+        num_padding = ellsize - rowptr[num_rows];
+    } else if (args->format == format_hyb) {
+        err = hyb_from_coo_size(
+            num_rows, num_columns, num_nonzeros, rowidx, colidx, a,
+            rowptr, args->hyb_width, &ellsize, &rowsize, &rowsizemax, &diagsize,
+            &coosize, args->separate_diagonal);
+        num_padding = ellsize - (rowptr[num_rows] - coosize);
+    } else {
+        err = ell_from_coo_size(
+            num_rows, num_columns, num_nonzeros, rowidx, colidx, a,
+            rowptr, &ellsize, &rowsize, &diagsize,
+            args->separate_diagonal);
+        num_padding = ellsize - rowptr[num_rows];
+    }
+    if (err) {
+        if (args->verbose > 0) fprintf(stderr, "\n");
+        fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(err));
+        goto cleanup;
+    }
+
+    /*
+     * Find the number of nonzeros in the shortest and longest row,
+     * which are unknown if the matrix is loaded from a binary file.
+     */
+    if (!args->load_binary_path && num_rows > 0) {
+        rowlenmin = rowlenmax = rowptr[1]-rowptr[0];
+        for (idx_t i = 1; i < num_rows; i++) {
+            int64_t rowlen = rowptr[i+1]-rowptr[i];
+            rowlenmin = rowlenmin <= rowlen ? rowlenmin : rowlen;
+            rowlenmax = rowlenmax >= rowlen ? rowlenmax : rowlen;
+        }
+    }
+    ellcolidx = array_alloc(ellsize * sizeof(idx_t), args->hugepages);
+    if (!ellcolidx) {
+        if (args->verbose > 0) fprintf(stderr, "\n");
+        fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(errno));
+        goto cleanup;
+    }
+    if (args->format == format_sell) {
+#ifdef _OPENMP
+        #pragma omp parallel for if(args->numa_first_touch)
+#endif
+        for (idx_t c = 0; c < num_chunks; c++) {
+            for (int64_t k = sellchunkptr[c]; k < sellchunkptr[c+1]; k++)
+                ellcolidx[k] = 0;
+        }
+    } else {
+#ifdef _OPENMP
+        #pragma omp parallel for if(args->numa_first_touch)
+#endif
+        for (idx_t i = 0; i < num_rows; i++) {
+            for (idx_t l = 0; l < rowsize; l++) {
+                if (args->column_major) ellcolidx[l*num_rows+i] = 0;
+                else ellcolidx[i*rowsize+l] = 0;
+            }
+        }
+    }
+    ella = array_alloc(ellsize * sizeof(val_t), args->hugepages);
+    if (!ella) {
+        if (args->verbose > 0) fprintf(stderr, "\n");
+        fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(errno));
+        goto cleanup;
+    }
+    ellad = array_alloc(diagsize * sizeof(val_t), args->hugepages);
+    if (!ellad) {
+        if (args->verbose > 0) fprintf(stderr, "\n");
+        fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(errno));
+        goto cleanup;
+    }
+    if (args->format == format_sell) {
+#ifdef _OPENMP
+        #pragma omp parallel for if(args->numa_first_touch)
+#endif
+        for (idx_t c = 0; c < num_chunks; c++) {
+            for (int64_t k = sellchunkptr[c]; k < sellchunkptr[c+1]; k++)
+                ella[k] = 0;
+        }
+#ifdef _OPENMP
+        #pragma omp parallel for if(args->numa_first_touch)
+#endif
+        for (idx_t i = 0; i < diagsize; i++) ellad[i] = 0;
+    } else {
+#ifdef _OPENMP
+        #pragma omp parallel for if(args->numa_first_touch)
+#endif
+        for (idx_t i = 0; i < num_rows; i++) {
+            ellad[i] = 0;
+            for (idx_t l = 0; l < rowsize; l++) {
+                if (args->column_major) ella[l*num_rows+i] = 0;
+                else ella[i*rowsize+l] = 0;
+            }
+        }
+    }
+    /*
+     * For hybrid format, the nonzeros that do not fit in the ELLPACK
+     * part are stored in coordinate format, and each thread stores
+     * the partial sums of the rows that it shares with other threads.
      */
+    if (args->format == format_hyb) {
+        int nthreads = 1;
+#ifdef _OPENMP
+        #pragma omp parallel
+        #pragma omp master
+        nthreads = omp_get_num_threads();
+#endif
+        coorowidx = malloc((coosize > 0 ? coosize : 1) * sizeof(idx_t));
+        coocolidx = coorowidx ? malloc((coosize > 0 ? coosize : 1) * sizeof(idx_t)) : NULL;
+        cooa = coocolidx ? malloc((coosize > 0 ? coosize : 1) * sizeof(val_t)) : NULL;
+        coocarryrows = cooa ? malloc(2*nthreads * sizeof(idx_t)) : NULL;
+        coocarryvals = coocarryrows ? malloc(2*nthreads * sizeof(double)) : NULL;
+        if (!coocarryvals) {
+            if (args->verbose > 0) fprintf(stderr, "\n");
+            fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(errno));
+            goto cleanup;
+        }
+    }
+    if (args->load_binary_path) {
+        err = binfile_read_array(
+            args->load_binary_path, &b->binheader, 0, ellcolidx, &binbytes);
+        if (!err) {
+            err = binfile_read_array(
+                args->load_binary_path, &b->binheader, 1, ella, &binbytes);
+        }
+        if (!err) {
+            err = binfile_read_array(
+                args->load_binary_path, &b->binheader, 2, ellad, &binbytes);
+        }
+    } else if (args->format == format_sell) {
+        err = sell_from_coo(
+            num_rows, num_columns, num_nonzeros, rowidx, colidx, a,
+            rowptr, rowsize, args->chunk_size, sellperm, sellchunkptr,
+            ellcolidx, ella, ellad, args->separate_diagonal, args->sort_rows);
+    } else if (args->format == format_hyb) {
+        err = hyb_from_coo(
+            num_rows, num_columns, num_nonzeros, rowidx, colidx, a,
+            rowptr, rowsize, rowsizemax, ellcolidx, ella, ellad,
+            coorowidx, coocolidx, cooa,
+            args->separate_diagonal, args->sort_rows, args->column_major);
+    } else {
+        err = ell_from_coo(
+            num_rows, num_columns, num_nonzeros, rowidx, colidx, a,
+            rowptr, ellsize, rowsize, ellcolidx, ella, ellad,
+            args->separate_diagonal, args->sort_rows, args->column_major);
+    }
+    if (err) {
+        if (args->verbose > 0) fprintf(stderr, "\n");
+        fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(err));
+        goto cleanup;
+    }
 
-    /* configure hardware performance monitoring with PAPI */
 #ifdef HAVE_PAPI
-    int papierr = 0;
-    struct papi_util_opt papi_opt = {
-        .event_file = args.papi_event_file,
-        .print_csv = args.papi_event_format == 1,
-        .print_threads = args.papi_event_per_thread,
-        .print_summary = args.papi_event_summary,
-        .print_region = 0,
-        .component = 0,
-        .multiplex = 0,
-        .output = stderr
-    };
+    PAPI_UTIL_region_count("nonzeros", num_nonzeros);
+    PAPI_UTIL_region_end(NULL);
+#endif
+    if (args->verbose > 0) {
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        fprintf(stderr, "%'.6f seconds, %'"PRIdx" rows, %'"PRId64" nonzeros, %'"PRIdx" nonzeros per row",
+                timespec_duration(t0, t1), num_rows, ellsize + num_rows, rowsize);
+        if (args->format == format_sell) {
+            fprintf(stderr, ", %'"PRIdx" chunks of %'d rows, sorting window of %'d rows",
+                    num_chunks, args->chunk_size, args->sigma);
+        }
+        if (args->format == format_hyb) {
+            fprintf(stderr, " in ell part%s, %'"PRIdx" nonzeros in the longest row",
+                    args->hyb_width > 0 ? "" : " (chosen to minimise size)", rowsizemax);
+        }
+        fprintf(stderr, ", %'.1f%% padding",
+                ellsize > num_padding ? 100.0 * num_padding / (ellsize - num_padding) : 0.0);
+        if (args->format == format_hyb) {
+            fprintf(stderr, ", %'"PRId64" nonzeros in coo part (%'.1f%%)",
+                    coosize, ellsize - num_padding + coosize > 0
+                    ? 100.0 * coosize / (ellsize - num_padding + coosize) : 0.0);
+        }
+        if (args->load_binary_path) {
+            fprintf(stderr, ", %'.1f MB/s",
+                    1.0e-6 * binbytes / timespec_duration(t0, t1));
+        }
+        fputc('\n', stderr);
+    }
 
-    if (papi_opt.event_file) {
-        fprintf(stderr, "[PAPI util] using event file: %s\n", papi_opt.event_file);
-        err = PAPI_UTIL_setup(&papi_opt, &papierr);
+    /*
+     * If requested, save the matrix in ELLPACK or sliced ELLPACK
+     * format to a binary file.
+     */
+    if (args->save_binary_path) {
+        if (args->verbose > 0) {
+            fprintf(stderr, "%s_save_binary: ", formatname);
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+        }
+        uint32_t flags = 0;
+        if (args->separate_diagonal) flags |= binfile_separate_diagonal;
+        if (args->sort_rows) flags |= binfile_sort_rows;
+        if (args->format == format_ell && args->column_major) flags |= binfile_column_major;
+        binfile_header_init(
+            &b->binheader, args->format == format_sell ? binfile_sell : binfile_ell,
+            flags, args->format == format_sell ? 5 : 3, num_rows, num_columns,
+            num_nonzeros, ellsize, rowsize, rowsize, diagsize);
+        b->binheader.num_padding = num_padding;
+        b->binheader.sizes[0] = ellsize*sizeof(idx_t);
+        b->binheader.sizes[1] = ellsize*sizeof(val_t);
+        b->binheader.sizes[2] = diagsize*sizeof(val_t);
+        if (args->format == format_sell) {
+            b->binheader.chunksize = args->chunk_size;
+            b->binheader.sigma = args->sigma;
+            b->binheader.sizes[3] = (num_chunks+1)*sizeof(int64_t);
+            b->binheader.sizes[4] = num_rows*sizeof(idx_t);
+        }
+        const void * arrays[] = {ellcolidx, ella, ellad, sellchunkptr, sellperm};
+        int64_t bytes_written = 0;
+        err = binfile_write(args->save_binary_path, &b->binheader, arrays, &bytes_written);
         if (err) {
-            fprintf(stderr, "%s: %s\n",
-                    program_invocation_short_name, PAPI_UTIL_strerror(err, papierr));
-            free(y); free(x);
-            free(ellad); free(ella); free(ellcolidx);
-            program_options_free(&args);
-            return EXIT_FAILURE;
+            if (args->verbose > 0) fprintf(stderr, "\n");
+            fprintf(stderr, "%s: %s: %s\n", program_invocation_short_name,
+                    args->save_binary_path, strerror(err));
+            goto cleanup;
+        }
+        if (args->verbose > 0) {
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            fprintf(stderr, "%'.6f seconds (%'.1f MB/s)\n",
+                    timespec_duration(t0, t1),
+                    1.0e-6 * bytes_written / timespec_duration(t0, t1));
+        }
+    }
+
+    status = EXIT_SUCCESS;
+
+cleanup:
+    free(rowptr);
+    b->num_chunks = num_chunks;
+    b->sellchunkptr = sellchunkptr;
+    b->sellperm = sellperm;
+    b->ellsize = ellsize;
+    b->rowsize = rowsize;
+    b->rowsizemax = rowsizemax;
+    b->diagsize = diagsize;
+    b->num_padding = num_padding;
+    b->rowlenmin = rowlenmin;
+    b->rowlenmax = rowlenmax;
+    b->ellcolidx = ellcolidx;
+    b->ella = ella;
+    b->ellad = ellad;
+    b->coosize = coosize;
+    b->coorowidx = coorowidx;
+    b->coocolidx = coocolidx;
+    b->cooa = cooa;
+    b->coocarryrows = coocarryrows;
+    b->coocarryvals = coocarryvals;
+    return status;
+}
+
+/**
+ * ‘benchmark_run()’ allocates the vectors, copies those that were
+ * read from files, performs the multiplications, and writes a
+ * benchmark report and the result vector.
+ *
+ * The report is number ‘report_index’ out of ‘num_reports’ reports
+ * that are combined into one by ‘fprint_benchmark_report()’.
+ */
+static int benchmark_run(
+    struct benchmark * b,
+    const struct spmv_problem * A,
+    int report_index,
+    int num_reports)
+{
+    int err = 0;
+    int status = EXIT_FAILURE;
+    struct timespec t0, t1;
+    struct program_options * args = &b->args;
+    idx_t num_rows = A->num_rows;
+    idx_t num_columns = A->num_columns;
+    int64_t num_nonzeros = A->num_nonzeros;
+    const idx_t * rowperm = A->rowperm;
+    idx_t num_chunks = b->num_chunks;
+    int64_t * sellchunkptr = b->sellchunkptr;
+    idx_t * sellperm = b->sellperm;
+    int64_t ellsize = b->ellsize;
+    idx_t rowsize = b->rowsize;
+    idx_t diagsize = b->diagsize;
+    int64_t num_padding = b->num_padding;
+    int64_t rowlenmin = b->rowlenmin, rowlenmax = b->rowlenmax;
+    idx_t * ellcolidx = b->ellcolidx;
+    val_t * ella = b->ella, * ellad = b->ellad;
+    int64_t coosize = b->coosize;
+    idx_t * coorowidx = b->coorowidx, * coocolidx = b->coocolidx;
+    val_t * cooa = b->cooa;
+    idx_t * coocarryrows = b->coocarryrows;
+    double * coocarryvals = b->coocarryvals;
+#ifdef HAVE_PAPI
+    int papierr = 0;
+    struct papi_util_opt papi_opt = b->papi_opt;
+#endif
+
+    /*
+     * Every array that is allocated below is freed at ‘cleanup’, so
+     * they are declared here and initialised to NULL, and errors are
+     * handled by jumping to the end.
+     */
+    vec_t * x = NULL, * y = NULL;
+    idx_t * blockbase = NULL, * colidxwide = NULL;
+    int64_t * blockwideptr = NULL;
+    uint16_t * colidx16 = NULL;
+    uint64_t * batchticks = NULL, * workticks = NULL, * waitticks = NULL;
+    double * timings = NULL;
+
+    /* 4. allocate vectors */
+
+    /*
+     * For multiplication with several vectors at once, the vectors
+     * are stored as the columns of dense matrices with one row for
+     * each matrix column (or row), in row-major order.
+     */
+    int num_vectors = args->num_vectors;
+    x = array_alloc((size_t) num_columns*num_vectors * sizeof(vec_t), args->hugepages);
+    if (!x) {
+        if (args->verbose > 0) fprintf(stderr, "\n");
+        fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(errno));
+        goto cleanup;
+    }
+#ifdef _OPENMP
+    #pragma omp parallel for if(args->numa_first_touch)
+#endif
+    for (idx_t j = 0; j < num_columns; j++) {
+        for (int v = 0; v < num_vectors; v++) x[(int64_t) j*num_vectors+v] = 1.0;
+    }
+
+    /* copy the source vector that was read from a Matrix Market file */
+    if (A->x) memcpy(x, A->x, (size_t) num_columns*num_vectors * sizeof(vec_t));
+
+    y = array_alloc((size_t) num_rows*num_vectors * sizeof(vec_t), args->hugepages);
+    if (!y) {
+        if (args->verbose > 0) fprintf(stderr, "\n");
+        fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(errno));
+        goto cleanup;
+    }
+#ifdef _OPENMP
+    #pragma omp parallel for if(args->numa_first_touch)
+#endif
+    for (idx_t i = 0; i < num_rows; i++) {
+        for (int v = 0; v < num_vectors; v++) y[(int64_t) i*num_vectors+v] = 0.0;
+    }
+
+    /* copy the destination vector that was read from a Matrix Market file */
+    if (A->y) memcpy(y, A->y, (size_t) num_rows*num_vectors * sizeof(vec_t));
+
+    /* report the NUMA nodes of the pages of each array */
+    if (args->verbose > 0) {
+        fprint_page_nodes(stderr, "page_nodes: ellcolidx", ellcolidx, ellsize*sizeof(idx_t));
+        fprint_page_nodes(stderr, "page_nodes: ella", ella, ellsize*sizeof(val_t));
+        if (args->separate_diagonal) fprint_page_nodes(stderr, "page_nodes: ellad", ellad, diagsize*sizeof(val_t));
+        if (args->format == format_sell) {
+            fprint_page_nodes(stderr, "page_nodes: sellchunkptr", sellchunkptr, (num_chunks+1)*sizeof(int64_t));
+            fprint_page_nodes(stderr, "page_nodes: sellperm", sellperm, num_rows*sizeof(idx_t));
+        }
+        if (args->format == format_hyb && coosize > 0) {
+            fprint_page_nodes(stderr, "page_nodes: coorowidx", coorowidx, coosize*sizeof(idx_t));
+            fprint_page_nodes(stderr, "page_nodes: coocolidx", coocolidx, coosize*sizeof(idx_t));
+            fprint_page_nodes(stderr, "page_nodes: cooa", cooa, coosize*sizeof(val_t));
+        }
+        fprint_page_nodes(stderr, "page_nodes: x", x, (size_t) num_columns*num_vectors*sizeof(vec_t));
+        fprint_page_nodes(stderr, "page_nodes: y", y, (size_t) num_rows*num_vectors*sizeof(vec_t));
+    }
+
+    /* report the arrays that reside in huge pages */
+    if (args->verbose > 0 && args->hugepages != hugepages_none) {
+        fprint_hugepages(stderr, "hugepages: ellcolidx", ellcolidx, ellsize*sizeof(idx_t));
+        fprint_hugepages(stderr, "hugepages: ella", ella, ellsize*sizeof(val_t));
+        if (args->separate_diagonal) fprint_hugepages(stderr, "hugepages: ellad", ellad, diagsize*sizeof(val_t));
+        fprint_hugepages(stderr, "hugepages: x", x, (size_t) num_columns*num_vectors*sizeof(vec_t));
+        fprint_hugepages(stderr, "hugepages: y", y, (size_t) num_rows*num_vectors*sizeof(vec_t));
+    }
+
+    /*
+     * If requested, compress the column offsets of every block of
+     * rows to 16-bit offsets from the block's base column.
+     */
+    int64_t wide_nonzeros = 0;
+    if (args->compress_colidx) {
+        if (args->format == format_sell || args->column_major || num_vectors > 1 ||
+            (args->kernel != kernel_auto && args->kernel != kernel_scalar))
+        {
+            fprintf(stderr, "%s: %s\n", program_invocation_short_name,
+                    "--compress-colidx requires ell or hyb format without --column-major, "
+                    "a single vector and the scalar kernel");
+            goto cleanup;
+        }
+        if (args->verbose > 0) {
+            fprintf(stderr, "ell_compress_colidx: ");
+            clock_gettime(CLOCK_MONOTONIC, &t0);
         }
+        err = ell_compress_colidx(
+            num_rows, num_columns, ellsize, rowsize, ellcolidx, ella,
+            COLIDX_BLOCK_SIZE, &blockbase, &blockwideptr, &colidx16, &colidxwide,
+            &wide_nonzeros);
+        if (err) {
+            if (args->verbose > 0) fprintf(stderr, "\n");
+            fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(err));
+            goto cleanup;
+        }
+        if (args->verbose > 0) {
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            idx_t num_blocks = (num_rows + COLIDX_BLOCK_SIZE - 1) / COLIDX_BLOCK_SIZE;
+            idx_t num_wide_blocks = 0;
+            for (idx_t b = 0; b < num_blocks; b++)
+                if (blockwideptr[b+1] > blockwideptr[b]) num_wide_blocks++;
+            int64_t colidx_bytes = ellsize*sizeof(*ellcolidx);
+            int64_t compressed_bytes = (ellsize-wide_nonzeros)*sizeof(*colidx16)
+                + wide_nonzeros*sizeof(*colidxwide)
+                + num_blocks*(sizeof(*blockbase)+sizeof(*blockwideptr));
+            fprintf(stderr, "%'.6f seconds, %'"PRIdx" blocks of %'d rows, "
+                    "%'"PRIdx" wide blocks with %'"PRId64" nonzeros (%'.1f%%), "
+                    "%'.1f MB of column offsets compressed to %'.1f MB (ratio %'.2f)\n",
+                    timespec_duration(t0, t1), num_blocks, COLIDX_BLOCK_SIZE,
+                    num_wide_blocks, wide_nonzeros,
+                    ellsize > 0 ? 100.0 * wide_nonzeros / ellsize : 0.0,
+                    1.0e-6 * colidx_bytes, 1.0e-6 * compressed_bytes,
+                    compressed_bytes > 0 ? (double) colidx_bytes / compressed_bytes : 1.0);
+        }
+        array_free(ellcolidx); ellcolidx = b->ellcolidx = NULL;
     }
-#endif
+
+    /*
+     * 5. compute the matrix-vector multiplication.
+     */
 
     /* enable A64FX sector cache */
 #if defined(__FCC_version__) && defined(USE_A64FX_SECTOR_CACHE)
@@ -1734,30 +7283,266 @@ int main(int argc, char *argv[])
 #endif
 #endif
 
+    /*
+     * Choose between the scalar kernels and the kernels that use
+     * AVX-512 or SVE gather instructions. By default, the latter are
+     * used if they are enabled at compile time, except for rows that
+     * are shorter than the vector length in the row-major layout,
+     * since most vector lanes would then be left unused.
+     */
+    if (args->device == device_gpu &&
+        (args->format != format_ell || args->compress_colidx || num_vectors > 1 ||
+         (args->kernel != kernel_auto && args->kernel != kernel_scalar)))
+    {
+        fprintf(stderr, "%s: %s\n", program_invocation_short_name,
+                "--device=gpu requires ell format, a single vector, the scalar "
+                "kernel and no --compress-colidx");
+        goto cleanup;
+    } else if (args->sw_prefetch_distance > 0 &&
+               (args->format == format_sell || args->compress_colidx || num_vectors > 1 ||
+                args->device != device_host ||
+                (args->kernel != kernel_auto && args->kernel != kernel_scalar)))
+    {
+        fprintf(stderr, "%s: %s\n", program_invocation_short_name,
+                "--sw-prefetch-distance requires ell or hyb format, a single vector, the "
+                "scalar kernel, no --compress-colidx and no --device=gpu");
+        goto cleanup;
+    } else if (args->nontemporal &&
+               (args->format == format_sell || args->compress_colidx || num_vectors > 1 ||
+                args->device != device_host || args->sw_prefetch_distance > 0 ||
+                (args->kernel != kernel_auto && args->kernel != kernel_scalar)))
+    {
+        fprintf(stderr, "%s: %s\n", program_invocation_short_name,
+                "--nontemporal requires ell or hyb format, a single vector, the scalar "
+                "kernel, no --compress-colidx, no --sw-prefetch-distance and no --device=gpu");
+        goto cleanup;
+    } else if (args->thread_stats &&
+               (args->format != format_ell || args->compress_colidx || args->device != device_host))
+    {
+        fprintf(stderr, "%s: %s\n", program_invocation_short_name,
+                "--thread-stats requires ell format, no --compress-colidx and no --device=gpu");
+        goto cleanup;
+    } else if (num_vectors > 1 && args->format != format_ell) {
+        fprintf(stderr, "%s: %s\n", program_invocation_short_name,
+                "multiplying with several vectors requires ell format");
+        goto cleanup;
+    } else if (num_vectors > 1 && args->kernel != kernel_auto && args->kernel != kernel_scalar) {
+        fprintf(stderr, "%s: %s\n", program_invocation_short_name,
+                "vectorised kernels are not available for several vectors");
+        goto cleanup;
+    }
+    enum kernel kernel = args->kernel;
+    if (kernel == kernel_auto &&
+        (num_vectors > 1 || args->device == device_gpu || args->sw_prefetch_distance > 0 ||
+         args->nontemporal))
+    {
+        kernel = kernel_scalar;
+    } else if (kernel == kernel_auto) {
+        kernel = kernel_scalar;
+#if defined(USE_AVX512_KERNELS)
+        if (args->format != format_sell && !args->compress_colidx && (args->column_major || rowsize >= 8))
+            kernel = kernel_avx512;
+#elif defined(USE_SVE_KERNELS)
+        if (args->format != format_sell && !args->compress_colidx && (args->column_major || rowsize >= (idx_t) svcntd()))
+            kernel = kernel_sve;
+#endif
+    } else if (kernel != kernel_scalar && args->format == format_sell) {
+        fprintf(stderr, "%s: %s\n", program_invocation_short_name,
+                "vectorised kernels are only available for ell and hyb formats");
+        goto cleanup;
+    }
+
+    /*
+     * Otherwise, use a kernel that is specialised for the number of
+     * nonzeros per row, if one is available.
+     */
+    bool specialised = args->format != format_sell && kernel == kernel_scalar && num_vectors == 1 &&
+        args->sw_prefetch_distance <= 0 && !args->nontemporal && !args->column_major && !args->compress_colidx && rowsize > 0 && rowsize <= ELLGEMV_MAX_ROWSIZE;
+
+    char kernelname[32];
+    const char * sd = args->separate_diagonal ? "sd" : "";
+    const char * hyb = args->format == format_hyb ? "hyb" : "";
+    if (args->device == device_gpu) {
+        snprintf(kernelname, sizeof(kernelname), "gemv%s%s_target",
+                 args->column_major ? "cm" : "", sd);
+    } else if (args->sw_prefetch_distance > 0) {
+        snprintf(kernelname, sizeof(kernelname), "%sgemv%s%s_swpf",
+                 hyb, args->column_major ? "cm" : "", sd);
+    } else if (args->nontemporal) {
+        snprintf(kernelname, sizeof(kernelname), "%sgemv%s%s_nt",
+                 hyb, args->column_major ? "cm" : "", sd);
+    } else if (num_vectors > 1) {
+        snprintf(kernelname, sizeof(kernelname), "gemm%s%s",
+                 args->column_major ? "cm" : "", sd);
+    } else if (args->format == format_sell) {
+        snprintf(kernelname, sizeof(kernelname), "sellgemv%s", sd);
+    } else if (kernel == kernel_avx512 || kernel == kernel_sve) {
+        snprintf(kernelname, sizeof(kernelname), "%sgemv%s%s_%s",
+                 hyb, args->column_major ? "cm" : "", sd,
+                 kernel == kernel_avx512 ? "avx512" : "sve");
+    } else if (args->compress_colidx) {
+        snprintf(kernelname, sizeof(kernelname), "%sgemv%s_cz", hyb, sd);
+    } else if (specialised) {
+        snprintf(kernelname, sizeof(kernelname), "%sgemv%"PRIdx"%s", hyb, rowsize, sd);
+    } else {
+        snprintf(kernelname, sizeof(kernelname), "%sgemv%s%s",
+                 hyb, args->column_major ? "cm" : "", sd);
+    }
+
+    /*
+     * For hybrid format, the coordinate part is multiplied after the
+     * ELLPACK part, and the time at which the latter is done is
+     * recorded in ‘t2’.
+     */
+    struct timespec t2;
+
+    /*
+     * With ‘--device=gpu’, the matrix and vectors are copied to the
+     * device once, and they remain there for the warmup iterations and
+     * every repetition, until the result is copied back.
+     */
+    double to_device_seconds = 0, from_device_seconds = 0;
+#ifdef _OPENMP
+    if (args->device == device_gpu) {
+        if (args->verbose > 0) fprintf(stderr, "omp_target_enter_data: ");
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        #pragma omp target enter data map(to: ellcolidx[0:ellsize], ella[0:ellsize], \
+            ellad[0:diagsize], x[0:num_columns], y[0:num_rows])
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        to_device_seconds = timespec_duration(t0, t1);
+        if (args->verbose > 0) {
+            int64_t bytes = ellsize*(sizeof(*ellcolidx)+sizeof(*ella)) + diagsize*sizeof(*ellad)
+                + num_columns*sizeof(*x) + num_rows*sizeof(*y);
+            fprintf(stderr, "%'.6f seconds (%'.1f MB/s) to device %d of %d\n",
+                    to_device_seconds, (double) bytes * 1e-6 / to_device_seconds,
+                    omp_get_default_device(), omp_get_num_devices());
+        }
+        if (omp_get_num_devices() == 0 && !args->quiet) {
+            fprintf(stderr, "%s: warning: no device is available for --device=gpu, "
+                    "so the kernel runs on the host\n", program_invocation_short_name);
+        }
+    }
+#endif
+
     /* perform warmup iterations */
 #ifdef _OPENMP
     #pragma omp parallel
 #endif
-    for (int repeat = 0; repeat < args.warmup; repeat++) {
+    for (int repeat = 0; repeat < args->warmup; repeat++) {
         #pragma omp master
-        if (args.verbose > 0) {
-            if (args.separate_diagonal && rowsize == 16) fprintf(stderr, "gemv16sd (warmup): ");
-            else if (args.separate_diagonal) fprintf(stderr, "gemvsd (warmup): ");
-            else fprintf(stderr, "gemv (warmup): ");
+        if (args->verbose > 0) {
+            fprintf(stderr, "%s (warmup): ", kernelname);
             clock_gettime(CLOCK_MONOTONIC, &t0);
         }
 
-        int priverr;
-        if (args.separate_diagonal && rowsize == 16) {
-            priverr = ellgemv16sd(
+        int priverr = 0;
+#ifdef _OPENMP
+        if (args->device == device_gpu) {
+            #pragma omp master
+            priverr = ellgemv_target(
+                num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella,
+                args->separate_diagonal ? ellad : NULL, args->column_major);
+        } else
+#endif
+        if (args->sw_prefetch_distance > 0) {
+            priverr = ellgemv_swpf(
+                num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella,
+                args->separate_diagonal ? ellad : NULL, args->column_major,
+                args->sw_prefetch_distance);
+        } else if (args->nontemporal) {
+            priverr = ellgemv_nt(
+                num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella,
+                args->separate_diagonal ? ellad : NULL, args->column_major);
+        } else if (num_vectors > 1 && args->column_major && args->separate_diagonal) {
+            priverr = ellgemmcmsd(
+                num_rows, y, num_columns, x, num_vectors, ellsize, rowsize, ellcolidx, ella, ellad);
+        } else if (num_vectors > 1 && args->column_major) {
+            priverr = ellgemmcm(
+                num_rows, y, num_columns, x, num_vectors, ellsize, rowsize, ellcolidx, ella);
+        } else if (num_vectors > 1 && args->separate_diagonal) {
+            priverr = ellgemmsd(
+                num_rows, y, num_columns, x, num_vectors, ellsize, rowsize, ellcolidx, ella, ellad);
+        } else if (num_vectors > 1) {
+            priverr = ellgemm(
+                num_rows, y, num_columns, x, num_vectors, ellsize, rowsize, ellcolidx, ella);
+        } else
+#ifdef USE_AVX512_KERNELS
+        if (kernel == kernel_avx512) {
+            if (args->column_major && args->separate_diagonal) {
+                priverr = ellgemvcmsd_avx512(
+                    num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella, ellad);
+            } else if (args->column_major) {
+                priverr = ellgemvcm_avx512(
+                    num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella);
+            } else if (args->separate_diagonal) {
+                priverr = ellgemvsd_avx512(
+                    num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella, ellad);
+            } else {
+                priverr = ellgemv_avx512(
+                    num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella);
+            }
+        } else
+#endif
+#ifdef USE_SVE_KERNELS
+        if (kernel == kernel_sve) {
+            if (args->column_major && args->separate_diagonal) {
+                priverr = ellgemvcmsd_sve(
+                    num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella, ellad);
+            } else if (args->column_major) {
+                priverr = ellgemvcm_sve(
+                    num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella);
+            } else if (args->separate_diagonal) {
+                priverr = ellgemvsd_sve(
+                    num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella, ellad);
+            } else {
+                priverr = ellgemv_sve(
+                    num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella);
+            }
+        } else
+#endif
+        if (args->compress_colidx) {
+            priverr = ellgemvcz(
+                num_rows, y, num_columns, x, ellsize, rowsize, COLIDX_BLOCK_SIZE,
+                blockbase, blockwideptr, colidx16, colidxwide, ella,
+                args->separate_diagonal ? ellad : NULL);
+        } else if (args->format == format_sell && args->separate_diagonal) {
+            priverr = sellgemvsd(
+                num_rows, y, num_columns, x, ellsize, args->chunk_size,
+                sellchunkptr, sellperm, ellcolidx, ella, ellad);
+        } else if (args->format == format_sell) {
+            priverr = sellgemv(
+                num_rows, y, num_columns, x, ellsize, args->chunk_size,
+                sellchunkptr, sellperm, ellcolidx, ella);
+        } else if (args->column_major && args->separate_diagonal) {
+            priverr = ellgemvcmsd(
+                num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella, ellad);
+        } else if (args->column_major) {
+            priverr = ellgemvcm(
+                num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella);
+        } else if (args->separate_diagonal && specialised) {
+            priverr = ellgemvnsd[rowsize](
                 num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella, ellad);
-        } else if (args.separate_diagonal) {
+        } else if (args->separate_diagonal) {
             priverr = ellgemvsd(
                 num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella, ellad);
+        } else if (specialised) {
+            priverr = ellgemvn[rowsize](
+                num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella);
         } else {
             priverr = ellgemv(
                 num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella);
         }
+        if (args->format == format_hyb) {
+#ifdef _OPENMP
+            #pragma omp barrier
+            #pragma omp master
+#endif
+            if (args->verbose > 0) clock_gettime(CLOCK_MONOTONIC, &t2);
+            int cooerr = coogemv(
+                num_rows, y, num_columns, x, coosize,
+                coorowidx, coocolidx, cooa, coocarryrows, coocarryvals);
+            if (!priverr) priverr = cooerr;
+        }
 
 #ifdef _OPENMP
         #pragma omp barrier
@@ -1770,72 +7555,297 @@ int main(int argc, char *argv[])
 #endif
         if (err) break;
 
-        int64_t num_flops = 2*(ellsize+diagsize);
-        int64_t min_bytes = num_rows*sizeof(*y) + num_columns*sizeof(*x)
-            + ellsize*sizeof(*ellcolidx) + ellsize*sizeof(*ella) + diagsize*sizeof(*ellad);
-        int64_t max_bytes = num_rows*sizeof(*y) + ellsize*sizeof(*x)
-            + ellsize*sizeof(*ellcolidx) + ellsize*sizeof(*ella)
-            + diagsize*sizeof(*ellad) + diagsize*sizeof(*x);
+        int64_t num_flops = 2*(ellsize+diagsize)*num_vectors;
+        int64_t matrix_bytes = ellsize*sizeof(*ellcolidx) + ellsize*sizeof(*ella)
+            + diagsize*sizeof(*ellad);
+        if (args->format == format_sell)
+            matrix_bytes += (num_chunks+1)*sizeof(*sellchunkptr) + num_rows*sizeof(*sellperm);
+        if (args->format == format_hyb) {
+            num_flops += 2*coosize;
+            matrix_bytes += coosize*(sizeof(*coorowidx) + sizeof(*coocolidx) + sizeof(*cooa));
+        }
+        int64_t colidx_saved_bytes = 0;
+        if (args->compress_colidx) {
+            idx_t num_blocks = (num_rows + COLIDX_BLOCK_SIZE - 1) / COLIDX_BLOCK_SIZE;
+            colidx_saved_bytes = ellsize*sizeof(idx_t)
+                - (ellsize-wide_nonzeros)*sizeof(*colidx16) - wide_nonzeros*sizeof(*colidxwide)
+                - num_blocks*(sizeof(*blockbase)+sizeof(*blockwideptr));
+            matrix_bytes -= colidx_saved_bytes;
+        }
+        int64_t min_bytes = (num_rows*sizeof(*y) + num_columns*sizeof(*x))*num_vectors
+            + matrix_bytes;
+        int64_t max_bytes = (num_rows*sizeof(*y) + (ellsize+coosize)*sizeof(*x) + diagsize*sizeof(*x))*num_vectors
+            + matrix_bytes;
+        int64_t y_saved_bytes = args->nontemporal ? num_rows*sizeof(*y) : 0;
 
 #ifdef _OPENMP
         #pragma omp barrier
         #pragma omp master
 #endif
-        if (args.verbose > 0) {
+        if (args->verbose > 0) {
             clock_gettime(CLOCK_MONOTONIC, &t1);
-            fprintf(stderr, "%'.6f seconds (%'.3f Gnz/s, %'.3f Gflop/s, %'.1f to %'.1f GB/s)\n",
+            fprintf(stderr, "%'.6f seconds (%'.3f Gnz/s, %'.3f Gflop/s, %'.1f to %'.1f GB/s",
                     timespec_duration(t0, t1),
-                    (double) num_nonzeros * 1e-9 / (double) timespec_duration(t0, t1),
+                    (double) num_nonzeros * num_vectors * 1e-9 / (double) timespec_duration(t0, t1),
                     (double) num_flops * 1e-9 / (double) timespec_duration(t0, t1),
                     (double) min_bytes * 1e-9 / (double) timespec_duration(t0, t1),
                     (double) max_bytes * 1e-9 / (double) timespec_duration(t0, t1));
+            if (num_vectors > 1) {
+                fprintf(stderr, ", %'.1f GB/s saved compared to %d separate multiplications",
+                        (double) (num_vectors-1) * matrix_bytes * 1e-9 / (double) timespec_duration(t0, t1),
+                        num_vectors);
+            }
+            if (colidx_saved_bytes > 0) {
+                fprintf(stderr, ", %'.1f GB/s saved by compressing column offsets",
+                        (double) colidx_saved_bytes * 1e-9 / (double) timespec_duration(t0, t1));
+            }
+            if (y_saved_bytes > 0) {
+                fprintf(stderr, ", %'.1f GB/s saved by not reading the destination vector",
+                        (double) y_saved_bytes * 1e-9 / (double) timespec_duration(t0, t1));
+            }
+            if (args->format == format_hyb) {
+                fprintf(stderr, ", %'.6f seconds in ell part, %'.6f seconds in coo part",
+                        timespec_duration(t0, t2), timespec_duration(t2, t1));
+            }
+            fprintf(stderr, ")\n");
+        }
+    }
+
+    /*
+     * If requested, allocate storage for per-thread timestamps of
+     * every batch of multiplications. These are also needed for
+     * ‘--thread-stats’, where every multiplication is its own batch,
+     * unless a batch size is given.
+     */
+    if (args->thread_stats && args->batch_size <= 0) args->batch_size = 1;
+    int num_batches = args->batch_size > 0 ? (args->repeat + args->batch_size - 1) / args->batch_size : 0;
+    int num_threads = 1;
+#ifdef _OPENMP
+    #pragma omp parallel
+    #pragma omp master
+    num_threads = omp_get_num_threads();
+#endif
+    if (args->batch_size > 0) {
+        batchticks = calloc((size_t) num_batches * (1 + 2*num_threads), sizeof(uint64_t));
+        if (!batchticks) {
+            fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(errno));
+            goto cleanup;
+        }
+        workticks = &batchticks[num_batches];
+        waitticks = &workticks[(size_t) num_batches * num_threads];
+    }
+
+    /*
+     * For a benchmark report, the average time per multiplication of
+     * every repetition, or every batch, is recorded.
+     */
+    int num_timings = args->batch_size > 0 ? num_batches : args->repeat;
+    struct benchmark_report report = {0};
+    if ((args->output != output_none || args->stream_baseline) && num_timings > 0) {
+        timings = malloc(num_timings * sizeof(double));
+        if (!timings) {
+            fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(errno));
+            goto cleanup;
+        }
+    }
+
+    /*
+     * With ‘--stream-baseline’, the memory bandwidth is measured with
+     * the same threads before the multiplications, so that it can be
+     * compared with the bandwidth that is achieved by the kernel.
+     */
+    if (args->stream_baseline) {
+        err = stream_benchmark(
+            args->hugepages, &report.stream_triad_gbytes_per_second,
+            &report.stream_read_gbytes_per_second);
+        if (err) {
+            fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(err));
+            goto cleanup;
         }
+        fprintf(stderr, "stream: triad %'.1f GB/s, read %'.1f GB/s "
+                "(best of %d, %'"PRId64" elements per array, %d threads)\n",
+                report.stream_triad_gbytes_per_second, report.stream_read_gbytes_per_second,
+                STREAM_NTIMES, (int64_t) STREAM_ARRAY_SIZE, num_threads);
     }
 
     /* enable PAPI hardware performance monitoring */
 #ifdef HAVE_PAPI
     if (papi_opt.event_file) {
-        if (args.verbose > 0)
-            fprintf(stderr, "[PAPI util] start recording events for region \"gemv\"\n");
-        err = PAPI_UTIL_start("gemv", &papierr);
+        if (args->verbose > 0)
+            fprintf(stderr, "[PAPI util] start recording events for region \"%s\"\n", kernelname);
+        err = PAPI_UTIL_start(kernelname, &papierr);
+        if (!err) PAPI_UTIL_region_count("nonzeros", (double) num_nonzeros * args->repeat);
         if (err) {
             fprintf(stderr, "%s: %s\n",
                     program_invocation_short_name, PAPI_UTIL_strerror(err, papierr));
-            free(y); free(x);
-            free(ellad); free(ella); free(ellcolidx);
-            program_options_free(&args);
-            return EXIT_FAILURE;
+            goto cleanup;
         }
     }
 #endif
 
-    /* perform matrix-vector multiplication */
+    /*
+     * perform matrix-vector multiplication. In batch mode, the
+     * multiplications of a batch are performed back-to-back, and each
+     * thread records the time it spends in the kernel and in the
+     * barrier that follows it.
+     */
+    struct timespec batcht0, batcht1;
+    clock_gettime(CLOCK_MONOTONIC, &batcht0);
+    uint64_t batchtick0 = read_timestamp_counter();
 #ifdef _OPENMP
     #pragma omp parallel
 #endif
-    for (int repeat = 0; repeat < args.repeat; repeat++) {
+    for (int repeat = 0; repeat < args->repeat; repeat++) {
+        int batch = args->batch_size > 0 ? repeat / args->batch_size : repeat;
+        bool batchstart = args->batch_size <= 0 || repeat % args->batch_size == 0;
+        bool batchend = args->batch_size <= 0 || (repeat+1) % args->batch_size == 0
+            || repeat+1 == args->repeat;
+        if (batchstart) {
+#ifdef _OPENMP
         #pragma omp master
-        if (args.verbose > 0) {
-            if (args.separate_diagonal && rowsize == 16) fprintf(stderr, "gemv16sd: ");
-            else if (args.separate_diagonal) fprintf(stderr, "gemvsd: ");
-            else fprintf(stderr, "gemv: ");
+#endif
+        if (args->verbose > 0 || timings) {
+            if (args->verbose > 0) fprintf(stderr, "%s: ", kernelname);
             clock_gettime(CLOCK_MONOTONIC, &t0);
         }
+#ifdef _OPENMP
+        #pragma omp barrier
+#endif
+        }
 
-        int priverr;
-        if (args.separate_diagonal && rowsize == 16) {
-            priverr = ellgemv16sd(
+        uint64_t tk0 = args->batch_size > 0 ? read_timestamp_counter() : 0;
+        int priverr = 0;
+#ifdef _OPENMP
+        if (args->device == device_gpu) {
+            #pragma omp master
+            priverr = ellgemv_target(
+                num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella,
+                args->separate_diagonal ? ellad : NULL, args->column_major);
+        } else
+#endif
+        if (args->sw_prefetch_distance > 0) {
+            priverr = ellgemv_swpf(
+                num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella,
+                args->separate_diagonal ? ellad : NULL, args->column_major,
+                args->sw_prefetch_distance);
+        } else if (args->nontemporal) {
+            priverr = ellgemv_nt(
+                num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella,
+                args->separate_diagonal ? ellad : NULL, args->column_major);
+        } else if (num_vectors > 1 && args->column_major && args->separate_diagonal) {
+            priverr = ellgemmcmsd(
+                num_rows, y, num_columns, x, num_vectors, ellsize, rowsize, ellcolidx, ella, ellad);
+        } else if (num_vectors > 1 && args->column_major) {
+            priverr = ellgemmcm(
+                num_rows, y, num_columns, x, num_vectors, ellsize, rowsize, ellcolidx, ella);
+        } else if (num_vectors > 1 && args->separate_diagonal) {
+            priverr = ellgemmsd(
+                num_rows, y, num_columns, x, num_vectors, ellsize, rowsize, ellcolidx, ella, ellad);
+        } else if (num_vectors > 1) {
+            priverr = ellgemm(
+                num_rows, y, num_columns, x, num_vectors, ellsize, rowsize, ellcolidx, ella);
+        } else
+#ifdef USE_AVX512_KERNELS
+        if (kernel == kernel_avx512) {
+            if (args->column_major && args->separate_diagonal) {
+                priverr = ellgemvcmsd_avx512(
+                    num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella, ellad);
+            } else if (args->column_major) {
+                priverr = ellgemvcm_avx512(
+                    num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella);
+            } else if (args->separate_diagonal) {
+                priverr = ellgemvsd_avx512(
+                    num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella, ellad);
+            } else {
+                priverr = ellgemv_avx512(
+                    num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella);
+            }
+        } else
+#endif
+#ifdef USE_SVE_KERNELS
+        if (kernel == kernel_sve) {
+            if (args->column_major && args->separate_diagonal) {
+                priverr = ellgemvcmsd_sve(
+                    num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella, ellad);
+            } else if (args->column_major) {
+                priverr = ellgemvcm_sve(
+                    num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella);
+            } else if (args->separate_diagonal) {
+                priverr = ellgemvsd_sve(
+                    num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella, ellad);
+            } else {
+                priverr = ellgemv_sve(
+                    num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella);
+            }
+        } else
+#endif
+        if (args->compress_colidx) {
+            priverr = ellgemvcz(
+                num_rows, y, num_columns, x, ellsize, rowsize, COLIDX_BLOCK_SIZE,
+                blockbase, blockwideptr, colidx16, colidxwide, ella,
+                args->separate_diagonal ? ellad : NULL);
+        } else if (args->format == format_sell && args->separate_diagonal) {
+            priverr = sellgemvsd(
+                num_rows, y, num_columns, x, ellsize, args->chunk_size,
+                sellchunkptr, sellperm, ellcolidx, ella, ellad);
+        } else if (args->format == format_sell) {
+            priverr = sellgemv(
+                num_rows, y, num_columns, x, ellsize, args->chunk_size,
+                sellchunkptr, sellperm, ellcolidx, ella);
+        } else if (args->column_major && args->separate_diagonal) {
+            priverr = ellgemvcmsd(
                 num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella, ellad);
-        } else if (args.separate_diagonal) {
+        } else if (args->column_major) {
+            priverr = ellgemvcm(
+                num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella);
+        } else if (args->separate_diagonal && specialised) {
+            priverr = ellgemvnsd[rowsize](
+                num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella, ellad);
+        } else if (args->separate_diagonal) {
             priverr = ellgemvsd(
                 num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella, ellad);
+        } else if (specialised) {
+            priverr = ellgemvn[rowsize](
+                num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella);
         } else {
             priverr = ellgemv(
                 num_rows, y, num_columns, x, ellsize, rowsize, ellcolidx, ella);
         }
+        if (args->format == format_hyb) {
+#ifdef _OPENMP
+            #pragma omp barrier
+            #pragma omp master
+#endif
+            if (args->verbose > 0) clock_gettime(CLOCK_MONOTONIC, &t2);
+            int cooerr = coogemv(
+                num_rows, y, num_columns, x, coosize,
+                coorowidx, coocolidx, cooa, coocarryrows, coocarryvals);
+            if (!priverr) priverr = cooerr;
+        }
+        uint64_t tk1 = args->batch_size > 0 ? read_timestamp_counter() : 0;
 
 #ifdef _OPENMP
         #pragma omp barrier
+#endif
+        if (args->batch_size > 0) {
+            uint64_t tk2 = read_timestamp_counter();
+#ifdef _OPENMP
+            int p = omp_get_thread_num();
+#else
+            int p = 0;
+#endif
+            workticks[p*num_batches+batch] += tk1-tk0;
+            waitticks[p*num_batches+batch] += tk2-tk1;
+            if (p == 0 && batchstart) batchticks[batch] -= tk0;
+            if (p == 0 && batchend) batchticks[batch] += tk2;
+        }
+
+        /*
+         * Kernels fail in the same way for every multiplication, so
+         * errors are only checked at the end of each batch.
+         */
+        if (!batchend) continue;
+#ifdef _OPENMP
         for (int t = 0; t < omp_get_num_threads(); t++) {
             if (t == omp_get_thread_num() && !err && priverr) err = priverr;
             #pragma omp barrier
@@ -1845,65 +7855,403 @@ int main(int argc, char *argv[])
 #endif
         if (err) break;
 
-        int64_t num_flops = 2*(ellsize+diagsize);
-        int64_t min_bytes = num_rows*sizeof(*y) + num_columns*sizeof(*x)
-            + ellsize*sizeof(*ellcolidx) + ellsize*sizeof(*ella) + diagsize*sizeof(*ellad);
-        int64_t max_bytes = num_rows*sizeof(*y) + ellsize*sizeof(*x)
-            + ellsize*sizeof(*ellcolidx) + ellsize*sizeof(*ella)
-            + diagsize*sizeof(*ellad) + diagsize*sizeof(*x);
+        int64_t num_flops = 2*(ellsize+diagsize)*num_vectors;
+        int64_t matrix_bytes = ellsize*sizeof(*ellcolidx) + ellsize*sizeof(*ella)
+            + diagsize*sizeof(*ellad);
+        if (args->format == format_sell)
+            matrix_bytes += (num_chunks+1)*sizeof(*sellchunkptr) + num_rows*sizeof(*sellperm);
+        if (args->format == format_hyb) {
+            num_flops += 2*coosize;
+            matrix_bytes += coosize*(sizeof(*coorowidx) + sizeof(*coocolidx) + sizeof(*cooa));
+        }
+        int64_t colidx_saved_bytes = 0;
+        if (args->compress_colidx) {
+            idx_t num_blocks = (num_rows + COLIDX_BLOCK_SIZE - 1) / COLIDX_BLOCK_SIZE;
+            colidx_saved_bytes = ellsize*sizeof(idx_t)
+                - (ellsize-wide_nonzeros)*sizeof(*colidx16) - wide_nonzeros*sizeof(*colidxwide)
+                - num_blocks*(sizeof(*blockbase)+sizeof(*blockwideptr));
+            matrix_bytes -= colidx_saved_bytes;
+        }
+        int64_t min_bytes = (num_rows*sizeof(*y) + num_columns*sizeof(*x))*num_vectors
+            + matrix_bytes;
+        int64_t max_bytes = (num_rows*sizeof(*y) + (ellsize+coosize)*sizeof(*x) + diagsize*sizeof(*x))*num_vectors
+            + matrix_bytes;
+        int64_t y_saved_bytes = args->nontemporal ? num_rows*sizeof(*y) : 0;
 
+        int n = args->batch_size > 0 ? repeat - batch*args->batch_size + 1 : 1;
 #ifdef _OPENMP
         #pragma omp barrier
         #pragma omp master
 #endif
-        if (args.verbose > 0) {
+        if (args->verbose > 0 || timings) {
             clock_gettime(CLOCK_MONOTONIC, &t1);
-            fprintf(stderr, "%'.6f seconds (%'.3f Gnz/s, %'.3f Gflop/s, %'.1f to %'.1f GB/s)\n",
-                    timespec_duration(t0, t1),
-                    (double) num_nonzeros * 1e-9 / (double) timespec_duration(t0, t1),
-                    (double) num_flops * 1e-9 / (double) timespec_duration(t0, t1),
-                    (double) min_bytes * 1e-9 / (double) timespec_duration(t0, t1),
-                    (double) max_bytes * 1e-9 / (double) timespec_duration(t0, t1));
+            if (timings) timings[batch] = timespec_duration(t0, t1) / n;
+            report.num_flops = num_flops;
+            report.min_bytes = min_bytes;
+            report.max_bytes = max_bytes;
+        }
+#ifdef _OPENMP
+        #pragma omp master
+#endif
+        if (args->verbose > 0) {
+            double duration = timespec_duration(t0, t1) / n;
+            fprintf(stderr, "%'.6f seconds (%'.3f Gnz/s, %'.3f Gflop/s, %'.1f to %'.1f GB/s",
+                    duration,
+                    (double) num_nonzeros * num_vectors * 1e-9 / duration,
+                    (double) num_flops * 1e-9 / duration,
+                    (double) min_bytes * 1e-9 / duration,
+                    (double) max_bytes * 1e-9 / duration);
+            if (num_vectors > 1) {
+                fprintf(stderr, ", %'.1f GB/s saved compared to %d separate multiplications",
+                        (double) (num_vectors-1) * matrix_bytes * 1e-9 / duration,
+                        num_vectors);
+            }
+            if (colidx_saved_bytes > 0) {
+                fprintf(stderr, ", %'.1f GB/s saved by compressing column offsets",
+                        (double) colidx_saved_bytes * 1e-9 / duration);
+            }
+            if (y_saved_bytes > 0) {
+                fprintf(stderr, ", %'.1f GB/s saved by not reading the destination vector",
+                        (double) y_saved_bytes * 1e-9 / duration);
+            }
+            if (args->format == format_hyb && args->batch_size <= 0) {
+                fprintf(stderr, ", %'.6f seconds in ell part, %'.6f seconds in coo part",
+                        timespec_duration(t0, t2), timespec_duration(t2, t1));
+            }
+            if (args->batch_size > 0)
+                fprintf(stderr, ", average of %'d multiplications", n);
+            fprintf(stderr, ")\n");
         }
     }
+    uint64_t batchtick1 = read_timestamp_counter();
+    clock_gettime(CLOCK_MONOTONIC, &batcht1);
+#ifdef HAVE_PAPI
+    if (papi_opt.event_file) PAPI_UTIL_finish();
+#endif
+
+    /* summarise the per-thread timings of every batch */
+    if (args->verbose > 0 && args->batch_size > 0 && !err) {
+        double ticks_per_second = (batchtick1 - batchtick0) / timespec_duration(batcht0, batcht1);
+        err = fprint_batch_timing(
+            stderr, kernelname, num_threads, num_batches, args->batch_size, args->repeat,
+            batchticks, workticks, waitticks, ticks_per_second);
+    }
 
-#if defined(__FCC_version__) && defined(USE_A64FX_SECTOR_CACHE)
-    #pragma statement end_scache_isolate_way
+    /*
+     * With ‘--thread-stats’, show the work that is assigned to every
+     * thread and the time it takes.
+     */
+    if (args->thread_stats && !err) {
+        double ticks_per_second = (batchtick1 - batchtick0) / timespec_duration(batcht0, batcht1);
+        void * threadbuf = malloc(num_threads * (2*sizeof(idx_t) + sizeof(int64_t) + sizeof(double)));
+        if (!threadbuf) err = errno;
+        idx_t * threadrows = threadbuf;
+        idx_t * threadcolumns = threadrows ? &threadrows[num_threads] : NULL;
+        int64_t * threadnonzeros = threadcolumns ? (int64_t *) &threadcolumns[num_threads] : NULL;
+        double * threadseconds = threadnonzeros ? (double *) &threadnonzeros[num_threads] : NULL;
+        if (!err) {
+            err = ell_thread_partition(
+                num_threads, num_rows, num_columns, rowsize, ellcolidx, args->column_major,
+                args->separate_diagonal, threadrows, threadnonzeros, threadcolumns);
+        }
+        if (!err) {
+            err = fprint_thread_stats(
+                stderr, kernelname, num_threads, num_batches, args->repeat,
+                threadrows, threadnonzeros, threadcolumns, workticks, waitticks,
+                ticks_per_second, threadseconds);
+        }
+        free(threadbuf);
+    }
+
+    /* copy the result back from the device */
+#ifdef _OPENMP
+    if (args->device == device_gpu) {
+        if (args->verbose > 0) fprintf(stderr, "omp_target_exit_data: ");
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        #pragma omp target exit data map(from: y[0:num_rows]) map(release: ellcolidx[0:ellsize], \
+            ella[0:ellsize], ellad[0:diagsize], x[0:num_columns])
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        from_device_seconds = timespec_duration(t0, t1);
+        if (args->verbose > 0) {
+            fprintf(stderr, "%'.6f seconds (%'.1f MB/s)\n", from_device_seconds,
+                    (double) num_rows*sizeof(*y) * 1e-6 / from_device_seconds);
+        }
+    }
 #endif
 
+    /* complete the benchmark report */
+    report.program = program_invocation_short_name;
+    report.matrix = args->load_binary_path ? args->load_binary_path
+        : (args->generate != generate_none ? args->generate_spec : args->Apath);
+    report.kernel = kernelname;
+    report.num_rows = num_rows;
+    report.num_columns = num_columns;
+    report.num_nonzeros = num_nonzeros;
+    report.matrix_size = ellsize + diagsize + coosize;
+    report.rowsize = rowsize;
+    report.rowsizemin = rowlenmin;
+    report.rowsizemax = rowlenmax;
+    report.padding = num_padding;
+    report.num_vectors = num_vectors;
+    report.num_threads = num_threads;
+    report.batch_size = args->batch_size;
+    report.num_timings = num_timings;
+    report.seconds = timings;
+    report.device = args->device == device_gpu ? "gpu" : "host";
+    report.to_device_seconds = to_device_seconds;
+    report.from_device_seconds = from_device_seconds;
 #ifdef HAVE_PAPI
-    if (papi_opt.event_file) {
-        PAPI_UTIL_finish();
-        PAPI_UTIL_finalize();
-    }
+    report.papi_regions = papi_opt.event_file != NULL;
+#endif
+    if (args->stream_baseline && timings && !err) fprint_roofline(stderr, &report);
+
+#if defined(__FCC_version__) && defined(USE_A64FX_SECTOR_CACHE)
+    #pragma statement end_scache_isolate_way
 #endif
 
     if (err) {
+#ifdef HAVE_PAPI
+        if (papi_opt.event_file) PAPI_UTIL_finalize();
+#endif
         fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(err));
-        free(y); free(x);
-        free(ellad); free(ella); free(ellcolidx);
-        program_options_free(&args);
-        return EXIT_FAILURE;
+        goto cleanup;
+    }
+
+    /*
+     * The result is written unless a benchmark report is written
+     * instead, or, with ‘--result-file’, in addition to the report.
+     * If several reports are combined, it is only written once.
+     */
+    bool write_result = report_index == 0 && !args->quiet &&
+        (args->output == output_none || args->result_path);
+
+    /* restore the original order of the rows of the result */
+    if (rowperm && write_result) {
+        err = vector_permute(num_rows, num_vectors, y, rowperm, true);
+        if (err) {
+            fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(err));
+            goto cleanup;
+        }
+    }
+
+    /* write a benchmark report */
+    if (timings && args->output != output_none) {
+        err = fprint_benchmark_report(stdout, args->output, &report, report_index, num_reports);
+        if (err) {
+            fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(err));
+#ifdef HAVE_PAPI
+            if (papi_opt.event_file) PAPI_UTIL_finalize();
+#endif
+            goto cleanup;
+        }
     }
-    free(x); free(ellad); free(ella); free(ellcolidx);
+#ifdef HAVE_PAPI
+    if (papi_opt.event_file) PAPI_UTIL_finalize();
+#endif
 
     /* 6. write the result vector to a file */
-    if (!args.quiet) {
-        if (args.verbose > 0) {
+    if (write_result) {
+        if (args->verbose > 0) {
             fprintf(stderr, "mtxfile_write:\n");
             clock_gettime(CLOCK_MONOTONIC, &t0);
         }
 
-        fprintf(stdout, "%%%%MatrixMarket vector array real general\n");
-        fprintf(stdout, "%"PRIdx"\n", num_rows);
-        for (idx_t i = 0; i < num_rows; i++) fprintf(stdout, "%.*g\n", DBL_DIG, y[i]);
-        if (args.verbose > 0) {
+        FILE * f = stdout;
+        if (args->result_path && (f = fopen(args->result_path, "w")) == NULL) {
+            fprintf(stderr, "%s: %s: %s\n",
+                    program_invocation_short_name, args->result_path, strerror(errno));
+            goto cleanup;
+        }
+        if (num_vectors == 1) {
+            fprintf(f, "%%%%MatrixMarket vector array real general\n");
+            fprintf(f, "%"PRIdx"\n", num_rows);
+            for (idx_t i = 0; i < num_rows; i++) fprintf(f, "%.*g\n", VEC_DIG, y[i]);
+        } else {
+            /* dense matrices are written in column-major order */
+            fprintf(f, "%%%%MatrixMarket matrix array real general\n");
+            fprintf(f, "%"PRIdx" %d\n", num_rows, num_vectors);
+            for (int v = 0; v < num_vectors; v++) {
+                for (idx_t i = 0; i < num_rows; i++)
+                    fprintf(f, "%.*g\n", VEC_DIG, y[(int64_t) i*num_vectors+v]);
+            }
+        }
+        if (f != stdout && fclose(f) == EOF) {
+            fprintf(stderr, "%s: %s: %s\n",
+                    program_invocation_short_name, args->result_path, strerror(errno));
+            goto cleanup;
+        }
+        if (args->verbose > 0) {
             clock_gettime(CLOCK_MONOTONIC, &t1);
             fprintf(stderr, "mtxfile_write done in %'.6f seconds\n", timespec_duration(t0, t1));
         }
     }
+    status = EXIT_SUCCESS;
 
-    free(y);
-    program_options_free(&args);
+cleanup:
+    free(timings); free(batchticks);
+    free(colidxwide); free(colidx16); free(blockwideptr); free(blockbase);
+    array_free(y); array_free(x);
+    return status;
+}
+
+#ifdef SPMV_DRIVER
+/*
+ * phases of a benchmark that are run by the ‘spmv’ driver
+ */
+
+/**
+ * ‘driver_options()’ parses the program options when the ‘spmv’
+ * driver benchmarks several formats, which rules out the options
+ * that tune, load or save a single format.
+ */
+static int driver_options(
+    int argc,
+    char * argv[],
+    struct program_options * args)
+{
+    program_invocation_name = argv[0];
+    program_invocation_short_name = (
+        strrchr(program_invocation_name, '/')
+        ? strrchr(program_invocation_name, '/') + 1
+        : program_invocation_name);
+    if (benchmark_options(argc, argv, args) != EXIT_SUCCESS) return EXIT_FAILURE;
+    if (args->autotune || args->tuning_file ||
+        args->load_binary_path || args->save_binary_path)
+    {
+        fprintf(stderr, "%s: %s\n", program_invocation_short_name,
+                "--autotune, --tuning-file, --load-binary and --save-binary "
+                "can only be used with a single format");
+        program_options_free(args);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int ellspmv_read(
+    int argc,
+    char * argv[],
+    struct spmv_problem * A)
+{
+    struct benchmark b = {0};
+    if (driver_options(argc, argv, &b.args) != EXIT_SUCCESS) return EXIT_FAILURE;
+    int status = benchmark_read(&b, A);
+    benchmark_free(&b);
+    return status;
+}
+
+int ellspmv_convert(
+    int argc,
+    char * argv[],
+    const struct spmv_problem * A,
+    void ** state)
+{
+    struct benchmark * b = malloc(sizeof(*b));
+    if (!b) {
+        fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    *b = (struct benchmark) {0};
+    if (driver_options(argc, argv, &b->args) != EXIT_SUCCESS) {
+        free(b);
+        return EXIT_FAILURE;
+    }
+    if (A->idxsize != sizeof(idx_t) || A->vecsize != sizeof(vec_t) ||
+        A->num_vectors != b->args.num_vectors)
+    {
+        fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(EINVAL));
+        goto cleanup;
+    }
+#ifdef HAVE_PAPI
+    if (benchmark_papi_setup(b) != EXIT_SUCCESS) goto cleanup;
+#endif
+    if (benchmark_convert(b, A) != EXIT_SUCCESS) goto cleanup;
+    *state = b;
     return EXIT_SUCCESS;
+
+cleanup:
+    benchmark_free(b);
+    free(b);
+    return EXIT_FAILURE;
+}
+
+int ellspmv_spmv(
+    void * state,
+    const struct spmv_problem * A,
+    int report_index,
+    int num_reports)
+{
+    return benchmark_run(state, A, report_index, num_reports);
+}
+
+void ellspmv_free(
+    void * state)
+{
+    if (!state) return;
+    benchmark_free(state);
+    free(state);
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+    int err;
+    int status = EXIT_FAILURE;
+    setlocale(LC_ALL, "");
+
+    /* Set program invocation name. */
+    program_invocation_name = argv[0];
+    program_invocation_short_name = (
+        strrchr(program_invocation_name, '/')
+        ? strrchr(program_invocation_name, '/') + 1
+        : program_invocation_name);
+
+    /* 1. Parse program options. */
+    struct benchmark b = {0};
+    struct spmv_problem A = {0};
+    if (benchmark_options(argc, argv, &b.args) != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+
+    /*
+     * If requested, search for the fastest options by running the
+     * program with each of the candidate options.
+     */
+    if (b.args.autotune) {
+        err = autotune(argc, argv, "ellspmv", &b.args);
+        status = err ? EXIT_FAILURE : EXIT_SUCCESS;
+        goto cleanup;
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel
+    {
+      /*
+       * This empty parallel section is used to make the OpenMP
+       * runtime output its configuration now if the environment
+       * variable OMP_DISPLAY_ENV is set.
+       */
+    }
+#endif
+
+    /*
+     * Configure hardware performance monitoring with PAPI before the
+     * matrix is read, so that reading and conversion are also measured.
+     */
+#ifdef HAVE_PAPI
+    if (benchmark_papi_setup(&b) != EXIT_SUCCESS) goto cleanup;
+#endif
+
+    /*
+     * Read the matrix and vectors, convert the matrix, which means
+     * that the matrix in coordinate format is no longer needed, and
+     * then perform the multiplications.
+     */
+    if (benchmark_read(&b, &A) != EXIT_SUCCESS) goto cleanup;
+    if (benchmark_convert(&b, &A) != EXIT_SUCCESS) goto cleanup;
+    spmv_problem_free_matrix(&A);
+    status = benchmark_run(&b, &A, 0, 1);
+
+cleanup:
+    spmv_problem_free(&A);
+    benchmark_free(&b);
+    return status;
 }
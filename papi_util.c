@@ -46,6 +46,7 @@ const char * PAPI_UTIL_strerror(int err, int papierr)
 #else
     case PAPI_UTIL_PAPI_ERROR: return "PAPI not supported; please rebuild with PAPI support";
 #endif
+    case PAPI_UTIL_REGION_ERROR: return "too many regions, or region ended without being begun";
     default: return "unknown error";
     }
 }
@@ -68,6 +69,34 @@ void PAPI_UTIL_finish(void)
 void PAPI_UTIL_finalize(void)
 {
 }
+
+int PAPI_UTIL_region_begin(const char *region_name, int *papierr)
+{
+    return PAPI_UTIL_PAPI_NOT_SUPPORTED;
+}
+
+int PAPI_UTIL_region_end(int *papierr)
+{
+    return PAPI_UTIL_PAPI_NOT_SUPPORTED;
+}
+
+int PAPI_UTIL_region_count(const char *name, double value)
+{
+    return PAPI_UTIL_PAPI_NOT_SUPPORTED;
+}
+
+void PAPI_UTIL_fprint_regions_json(FILE *f, const char *indent)
+{
+    fprintf(f, "[]");
+}
+
+void PAPI_UTIL_fprint_regions_csv_header(FILE *f)
+{
+}
+
+void PAPI_UTIL_fprint_regions_csv(FILE *f)
+{
+}
 #else
 
 /* TODO: cleanup */
@@ -80,6 +109,9 @@ void PAPI_UTIL_finalize(void)
 #define MAX_THREADS 500
 #define MAX_EVENTS 50
 #define MAX_FORMULAS 20
+#define MAX_REGIONS 32
+#define MAX_REGION_DEPTH 8
+#define MAX_VARIABLES 8
 
 /* print defines */
 
@@ -144,6 +176,8 @@ struct measurement {
     char **event_names;
     long long *values;
     double time;
+    char **variable_names;
+    const double *variables;
 };
 
 struct user_formula {
@@ -192,19 +226,27 @@ static double _get_value(struct exptree_node *node, struct measurement *meas)
     if (node->event == NULL) {
         return node->value;
     }
+    if (!strcasecmp("time", node->event)) {
+        return meas->time;
+    }
     char **event_names = meas->event_names;
 
     int i = 0;
     while (*event_names) {
-        if (!strcasecmp("time", node->event)) {
-            return meas->time;
-        } else if (!strcmp(*event_names, node->event)) {
+        if (!strcmp(*event_names, node->event)) {
             return (double)meas->values[i];
         }
         event_names++;
         i++;
     }
 
+    // quantities counted for a region are not a number elsewhere
+    for (i = 0; meas->variable_names && meas->variable_names[i]; i++) {
+        if (!strcmp(meas->variable_names[i], node->event)) {
+            return meas->variables ? meas->variables[i] : NAN;
+        }
+    }
+
     eprintf("event not found: %s\n", node->event);
     return -1.0; // TODO
 }
@@ -364,6 +406,7 @@ static void _destroy_exptree(struct exptree_node *self)
 /* file scope globals */
 
 static long long _thread_values[MAX_THREADS][MAX_EVENTS];
+static long long _thread_start_values[MAX_THREADS][MAX_EVENTS];
 static long long _region_values[MAX_EVENTS];
 static long long _total_values[MAX_EVENTS];
 static int _event_sets[MAX_THREADS];
@@ -379,6 +422,31 @@ static int _num_formulas = 0;
 static double _time_measured = 0.0;
 static int _initialized = 0;
 
+/**
+ * Counters of a named region, summed over all threads and over every
+ * time the region was entered. The name of a nested region is
+ * prefixed by the name of its parent and a slash, and the quantities
+ * that are counted with PAPI_UTIL_region_count are not a number
+ * until they are first counted.
+ */
+struct region {
+    char *name;
+    int depth;
+    int count;
+    double time;
+    long long values[MAX_EVENTS];
+    double variables[MAX_VARIABLES];
+};
+
+static struct region _regions[MAX_REGIONS];
+static int _num_regions = 0;
+static int _region_stack[MAX_REGION_DEPTH];
+static double _region_stack_time[MAX_REGION_DEPTH];
+static long long _region_stack_values[MAX_REGION_DEPTH][MAX_EVENTS];
+static int _region_depth = 0;
+static char *_variable_names[MAX_VARIABLES + 1]; // NULL-terminated
+static int _num_variables = 0;
+
 // values that can be set by user
 static const char *_region_name;
 static struct papi_util_opt _opt = {.event_file = NULL,
@@ -421,10 +489,31 @@ static void event_init(int *event_set, int thread_num)
 }
 #endif
 
+/**
+ * Evaluates the i-th formula for the given counters and the
+ * quantities counted for a region, if any. If the counters are
+ * summed over all threads, then frequencies are averaged instead.
+ */
+static double evaluate_formula(int i, double time, long long *values,
+                               const double *variables, int summed)
+{
+    double value = evaluate_exptree(
+        _formulas[i].root,
+        &(struct measurement){
+            .event_names = _event_names, .values = values, .time = time,
+            .variable_names = _variable_names, .variables = variables});
+
+    // TODO: stupid workaround to print avg. frequency per thread
+    if (summed && !strncasecmp(_formulas[i].metric, "frequency", strlen("frequency"))) {
+        value /= omp_get_max_threads();
+    }
+    return value;
+}
+
 /**
  *
  */
-static void print_values(double time, long long *values)
+static void print_values(double time, long long *values, const double *variables)
 {
     // RAW EVENTS
     for (int i = 0; i < _num_events; i++) {
@@ -434,15 +523,9 @@ static void print_values(double time, long long *values)
 
     // DERIVED EVENTS
     for (int i = 0; i < _num_formulas; i++) {
-        double value = evaluate_exptree(
-            _formulas[i].root,
-            &(struct measurement){
-                .event_names = _event_names, .values = values, .time = time});
-
-        // TODO: stupid workaround to print avg. frequency per thread
-        if ((values == _region_values || values == _total_values) && !strncasecmp(_formulas[i].metric, "frequency", strlen("frequency"))) {
-            value /= omp_get_max_threads();
-        }
+        double value = evaluate_formula(
+            i, time, values, variables,
+            values == _region_values || values == _total_values);
 
         pprintf("%45s : %15.4lf [%s]\n", _formulas[i].metric, value,
                 _formulas[i].unit);
@@ -454,7 +537,7 @@ static void print_values(double time, long long *values)
     }
 }
 
-static void print_values_csv(double time, long long *values)
+static void print_values_csv(double time, long long *values, const double *variables)
 {
     // RAW EVENTS
     for (int i = 0; i < _num_events; i++) {
@@ -463,15 +546,9 @@ static void print_values_csv(double time, long long *values)
 
     // DERIVED EVENTS
     for (int i = 0; i < _num_formulas; i++) {
-        double value = evaluate_exptree(
-            _formulas[i].root,
-            &(struct measurement){
-                .event_names = _event_names, .values = values, .time = time});
-
-        // TODO: stupid workaround to print avg. frequency per thread
-        if ((values == _region_values || values == _total_values) && !strncasecmp(_formulas[i].metric, "frequency", strlen("frequency"))) {
-            value /= omp_get_max_threads();
-        }
+        double value = evaluate_formula(
+            i, time, values, variables,
+            values == _region_values || values == _total_values);
 
         pprintf(",%lf", value);
     }
@@ -569,16 +646,16 @@ int PAPI_UTIL_start(const char *region_name, int *papierr)
     memset(_region_values, 0x0, _num_events * sizeof(long long));
     memset(_thread_values, 0x0, _num_threads * _num_events * sizeof(long long));
 
-// everything is setup so we just have to start the counters for each thread
+// the counters of each thread are already running, so we just read them
 #pragma omp parallel
     if (PAPI_num_events(_event_sets[omp_get_thread_num()]) > 0) {
-        assert(!_thread_counter_started);
-        CHECK_PAPI_ERROR(PAPI_start(_event_sets[omp_get_thread_num()]));
-        _thread_counter_started = 1;
+        assert(_thread_counter_started);
+        CHECK_PAPI_ERROR(PAPI_read(_event_sets[omp_get_thread_num()],
+                                   _thread_start_values[omp_get_thread_num()]));
     }
 
     _time_start = omp_get_wtime();
-    return PAPI_UTIL_OK;
+    return PAPI_UTIL_region_begin(region_name, papierr);
 }
 
 #if START_IN_PARALLEL_REGION_IMPLEMENTED
@@ -662,10 +739,202 @@ int PAPI_UTIL_setup(const struct papi_util_opt *opt, int *papierr)
 #pragma omp parallel
     event_init(_event_sets, omp_get_thread_num());
 
+    // start the counters, which run until PAPI_UTIL_finalize, so that
+    // regions only need to read them and can be nested
+#pragma omp parallel
+    if (PAPI_num_events(_event_sets[omp_get_thread_num()]) > 0) {
+        assert(!_thread_counter_started);
+        CHECK_PAPI_ERROR(PAPI_start(_event_sets[omp_get_thread_num()]));
+        _thread_counter_started = 1;
+    }
+
     _initialized = 1;
     return PAPI_UTIL_OK;
 }
 
+/**
+ * Reads the counters of every thread and sums them.
+ */
+static void read_counters(long long *values)
+{
+    memset(values, 0x0, _num_events * sizeof(long long));
+#pragma omp parallel
+    if (PAPI_num_events(_event_sets[omp_get_thread_num()]) > 0) {
+        long long thread_values[MAX_EVENTS];
+        CHECK_PAPI_ERROR(PAPI_read(_event_sets[omp_get_thread_num()], thread_values));
+        for (int e = 0; e < _num_events; e++) {
+#pragma omp atomic
+            values[e] += thread_values[e];
+        }
+    }
+}
+
+/**
+ * Begins a named region, which must be outside of any parallel region.
+ */
+int PAPI_UTIL_region_begin(const char *region_name, int *papierr)
+{
+    if (!_initialized) return PAPI_UTIL_OK;
+    if (_region_depth >= MAX_REGION_DEPTH) return PAPI_UTIL_REGION_ERROR;
+
+    // find the region with the same name and parent, or add it
+    const char *parent = _region_depth > 0 ? _regions[_region_stack[_region_depth - 1]].name : NULL;
+    char *name = malloc((parent ? strlen(parent) + 1 : 0) + strlen(region_name) + 1);
+    if (!name) return PAPI_UTIL_ERRNO;
+    if (parent) sprintf(name, "%s/%s", parent, region_name);
+    else strcpy(name, region_name);
+    int r = 0;
+    while (r < _num_regions && strcmp(_regions[r].name, name)) r++;
+    if (r < _num_regions) {
+        free(name);
+    } else if (_num_regions >= MAX_REGIONS) {
+        free(name);
+        return PAPI_UTIL_REGION_ERROR;
+    } else {
+        struct region *region = &_regions[_num_regions++];
+        region->name = name;
+        region->depth = _region_depth;
+        region->count = 0;
+        region->time = 0.0;
+        memset(region->values, 0x0, sizeof(region->values));
+        for (int v = 0; v < MAX_VARIABLES; v++) region->variables[v] = NAN;
+    }
+
+    _region_stack[_region_depth] = r;
+    read_counters(_region_stack_values[_region_depth]);
+    _region_stack_time[_region_depth] = omp_get_wtime();
+    _region_depth++;
+    return PAPI_UTIL_OK;
+}
+
+/**
+ * Ends the innermost region and adds its counters to the region.
+ */
+int PAPI_UTIL_region_end(int *papierr)
+{
+    if (!_initialized) return PAPI_UTIL_OK;
+    if (_region_depth <= 0) return PAPI_UTIL_REGION_ERROR;
+
+    double time = omp_get_wtime();
+    long long values[MAX_EVENTS];
+    read_counters(values);
+    _region_depth--;
+    struct region *region = &_regions[_region_stack[_region_depth]];
+    region->count++;
+    region->time += time - _region_stack_time[_region_depth];
+    for (int e = 0; e < _num_events; e++)
+        region->values[e] += values[e] - _region_stack_values[_region_depth][e];
+    return PAPI_UTIL_OK;
+}
+
+/**
+ * Adds to a named quantity of the innermost region.
+ */
+int PAPI_UTIL_region_count(const char *name, double value)
+{
+    if (!_initialized || _region_depth <= 0) return PAPI_UTIL_OK;
+    int v = 0;
+    while (v < _num_variables && strcmp(_variable_names[v], name)) v++;
+    if (v == _num_variables) {
+        if (_num_variables >= MAX_VARIABLES) return PAPI_UTIL_REGION_ERROR;
+        _variable_names[v] = strdup(name);
+        if (!_variable_names[v]) return PAPI_UTIL_ERRNO;
+        _num_variables++;
+    }
+    struct region *region = &_regions[_region_stack[_region_depth - 1]];
+    if (isnan(region->variables[v])) region->variables[v] = 0.0;
+    region->variables[v] += value;
+    return PAPI_UTIL_OK;
+}
+
+/**
+ * Prints a string with its trailing white space removed, which is
+ * left by the formula parser, either quoted as a JSON string or as a
+ * CSV field.
+ */
+static void fputs_trimmed(const char *s, FILE *f, int json)
+{
+    size_t n = strlen(s);
+    while (n > 0 && isspace((unsigned char) s[n - 1])) n--;
+    fputc('"', f);
+    for (size_t i = 0; i < n; i++) {
+        if (json && (s[i] == '"' || s[i] == '\\')) fprintf(f, "\\%c", s[i]);
+        else if (json && (unsigned char) s[i] < 0x20) fprintf(f, "\\u%04x", (unsigned char) s[i]);
+        else if (!json && s[i] == '"') fputs("\"\"", f);
+        else fputc(s[i], f);
+    }
+    fputc('"', f);
+}
+
+void PAPI_UTIL_fprint_regions_json(FILE *f, const char *indent)
+{
+    fprintf(f, "[");
+    for (int r = 0; r < _num_regions; r++) {
+        struct region *region = &_regions[r];
+        fprintf(f, "%s\n%s  {\"name\": ", r > 0 ? "," : "", indent);
+        fputs_trimmed(region->name, f, 1);
+        fprintf(f, ", \"depth\": %d, \"count\": %d, \"seconds\": %.9g,\n",
+                region->depth, region->count, region->time);
+        fprintf(f, "%s   \"events\": {", indent);
+        for (int e = 0; e < _num_events; e++) {
+            fprintf(f, "%s", e > 0 ? ", " : "");
+            fputs_trimmed(_event_names[e], f, 1);
+            fprintf(f, ": %lld", region->values[e]);
+        }
+        fprintf(f, "},\n%s   \"counts\": {", indent);
+        for (int v = 0; v < _num_variables; v++) {
+            fprintf(f, "%s", v > 0 ? ", " : "");
+            fputs_trimmed(_variable_names[v], f, 1);
+            if (isfinite(region->variables[v])) fprintf(f, ": %.9g", region->variables[v]);
+            else fprintf(f, ": null");
+        }
+        fprintf(f, "},\n%s   \"metrics\": [", indent);
+        for (int i = 0; i < _num_formulas; i++) {
+            double value = evaluate_formula(i, region->time, region->values, region->variables, 1);
+            fprintf(f, "%s\n%s    {\"name\": ", i > 0 ? "," : "", indent);
+            fputs_trimmed(_formulas[i].metric, f, 1);
+            fprintf(f, ", \"unit\": ");
+            fputs_trimmed(_formulas[i].unit, f, 1);
+            if (isfinite(value)) fprintf(f, ", \"value\": %.9g}", value);
+            else fprintf(f, ", \"value\": null}");
+        }
+        fprintf(f, "]}");
+    }
+    if (_num_regions > 0) fprintf(f, "\n%s", indent);
+    fprintf(f, "]");
+}
+
+void PAPI_UTIL_fprint_regions_csv_header(FILE *f)
+{
+    for (int r = 0; r < _num_regions; r++) {
+        for (int e = 0; e < _num_events; e++) {
+            fprintf(f, ",\"%s:%s\"", _regions[r].name, _event_names[e]);
+        }
+        for (int i = 0; i < _num_formulas; i++) {
+            size_t n = strlen(_formulas[i].metric);
+            while (n > 0 && isspace((unsigned char) _formulas[i].metric[n - 1])) n--;
+            fprintf(f, ",\"%s:%.*s\"", _regions[r].name, (int) n, _formulas[i].metric);
+        }
+        fprintf(f, ",\"%s:seconds\"", _regions[r].name);
+    }
+}
+
+void PAPI_UTIL_fprint_regions_csv(FILE *f)
+{
+    for (int r = 0; r < _num_regions; r++) {
+        struct region *region = &_regions[r];
+        for (int e = 0; e < _num_events; e++) {
+            fprintf(f, ",%lld", region->values[e]);
+        }
+        for (int i = 0; i < _num_formulas; i++) {
+            double value = evaluate_formula(i, region->time, region->values, region->variables, 1);
+            if (isfinite(value)) fprintf(f, ",%.9g", value);
+            else fprintf(f, ",");
+        }
+        fprintf(f, ",%.9g", region->time);
+    }
+}
+
 /**
  *
  */
@@ -677,6 +946,8 @@ void PAPI_UTIL_finish(void)
         eprintf("error: not initialized\n");
         return;
     }
+    const double *variables = _region_depth > 0
+        ? _regions[_region_stack[_region_depth - 1]].variables : NULL;
     if (_opt.print_csv) {
         print_header_csv();
     }
@@ -684,9 +955,13 @@ void PAPI_UTIL_finish(void)
     _time_measured += time;
 #pragma omp parallel
     {
-        if (PAPI_num_events(_event_sets[omp_get_thread_num()]) > 0)
-            CHECK_PAPI_ERROR(PAPI_stop(_event_sets[omp_get_thread_num()],
+        if (PAPI_num_events(_event_sets[omp_get_thread_num()]) > 0) {
+            CHECK_PAPI_ERROR(PAPI_read(_event_sets[omp_get_thread_num()],
                                        _thread_values[omp_get_thread_num()]));
+            for (int e = 0; e < _num_events; e++)
+                _thread_values[omp_get_thread_num()][e] -=
+                    _thread_start_values[omp_get_thread_num()][e];
+        }
 
 #pragma omp barrier
 
@@ -697,15 +972,16 @@ void PAPI_UTIL_finish(void)
             {
                 if (_opt.print_csv) {
                     pprintf("%s,%d", _region_name, omp_get_thread_num());
-                    print_values_csv(time, _thread_values[omp_get_thread_num()]);
+                    print_values_csv(time, _thread_values[omp_get_thread_num()], variables);
                 } else {
                     pprintf(STATSSEP "   Thread %d Counters:\n" STATSSEP,
                             omp_get_thread_num());
-                    print_values(time, _thread_values[omp_get_thread_num()]);
+                    print_values(time, _thread_values[omp_get_thread_num()], variables);
                 }
             }
         }
     } // end parallel region
+    PAPI_UTIL_region_end(NULL);
 
     // accumulate values from all threads and regions
     for (int e = 0; e < _num_events; e++) {
@@ -720,11 +996,11 @@ void PAPI_UTIL_finish(void)
     if (_opt.print_region) {
         if (_opt.print_csv) {
             pprintf("%s,%d", _region_name, -1);
-            print_values_csv(time, _region_values);
+            print_values_csv(time, _region_values, variables);
         } else {
             pprintf(STATSSEP "   Region %s Summary (%d Threads):\n" STATSSEP,
                     _region_name, omp_get_max_threads());
-            print_values(time, _region_values);
+            print_values(time, _region_values, variables);
         }
     }
 }
@@ -740,17 +1016,22 @@ void PAPI_UTIL_finalize(void)
     if (_opt.print_summary) {
         if (_opt.print_csv) {
             pprintf("%s,%d", "total", -1);
-            print_values_csv(_time_measured, _total_values);
+            print_values_csv(_time_measured, _total_values, NULL);
         } else {
             pprintf(STATSSEP "   Total Summary (%d Threads):\n" STATSSEP,
                     omp_get_max_threads());
-            print_values(_time_measured, _total_values);
+            print_values(_time_measured, _total_values, NULL);
         }
     }
 
-    // cleanup events and buffers for thread counters
+    // stop counters and cleanup events and buffers for thread counters
 #pragma omp parallel
     {
+        if (_thread_counter_started) {
+            long long values[MAX_EVENTS];
+            CHECK_PAPI_ERROR(PAPI_stop(_event_sets[omp_get_thread_num()], values));
+            _thread_counter_started = 0;
+        }
         CHECK_PAPI_ERROR(PAPI_cleanup_eventset(_event_sets[omp_get_thread_num()]));
         CHECK_PAPI_ERROR(PAPI_destroy_eventset(&_event_sets[omp_get_thread_num()]));
     } // end parallel region
@@ -763,6 +1044,18 @@ void PAPI_UTIL_finalize(void)
     // free binary expression trees
     for (int i = 0; i < _num_formulas; i++)
         destroy_formula(&_formulas[i]);
+    _num_formulas = 0;
+
+    // free regions and the names of counted quantities
+    for (int r = 0; r < _num_regions; r++)
+        free(_regions[r].name);
+    for (int v = 0; v < _num_variables; v++) {
+        free(_variable_names[v]);
+        _variable_names[v] = NULL;
+    }
+    _num_regions = _num_variables = _region_depth = 0;
+    memset(_total_values, 0x0, sizeof(_total_values));
+    _time_measured = 0.0;
 
     // free(_event_name);
     _initialized = 0;
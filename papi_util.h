@@ -20,7 +20,8 @@ enum papi_util_err_t {
    PAPI_UTIL_PARSE_ERROR,
    PAPI_UTIL_PAPI_NOT_SUPPORTED,
    PAPI_UTIL_PAPI_VERSION_MISMATCH,
-   PAPI_UTIL_PAPI_ERROR };
+   PAPI_UTIL_PAPI_ERROR,
+   PAPI_UTIL_REGION_ERROR };
 
 struct papi_util_opt {
     const char *event_file;
@@ -43,6 +44,30 @@ int PAPI_UTIL_start(const char *region_name, int *papierr);
 void PAPI_UTIL_finish(void);
 void PAPI_UTIL_finalize(void);
 
+/*
+ * Named regions may be nested, and the counters of every region are
+ * accumulated over all threads and over every time the region is
+ * entered, until ‘PAPI_UTIL_finalize’ is called. ‘PAPI_UTIL_start’
+ * and ‘PAPI_UTIL_finish’ also begin and end a region. The regions
+ * are ignored if ‘PAPI_UTIL_setup’ has not been called.
+ *
+ * ‘PAPI_UTIL_region_count’ adds to a named quantity of the innermost
+ * region, such as the number of nonzeros that it processes, which
+ * can then be used by name in the formulas of the event file.
+ */
+int PAPI_UTIL_region_begin(const char *region_name, int *papierr);
+int PAPI_UTIL_region_end(int *papierr);
+int PAPI_UTIL_region_count(const char *name, double value);
+
+/*
+ * Print the events and derived metrics of every region, as a JSON
+ * array, or as extra columns of a CSV table, named after the region
+ * and the event or metric.
+ */
+void PAPI_UTIL_fprint_regions_json(FILE *f, const char *indent);
+void PAPI_UTIL_fprint_regions_csv_header(FILE *f);
+void PAPI_UTIL_fprint_regions_csv(FILE *f);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -0,0 +1,304 @@
+/*
+ * Benchmark programs for sparse matrix-vector multiply
+ *
+ * Copyright (C) 2023 James D. Trotter
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ *
+ * Driver program that benchmarks sparse matrix-vector multiplication
+ * (SpMV) with several matrix storage formats in a single process.
+ *
+ * Every format is registered in the table ‘spmv_formats’ below,
+ * together with the benchmark program that implements it. If there
+ * are several formats, the matrix and vectors are read only once, by
+ * the program of the first format. Each format is then converted from
+ * the same matrix in coordinate format, in the same way as when the
+ * programs are run separately, and multiplied with the same vectors.
+ * The matrix in coordinate format is freed after the last conversion,
+ * and the benchmark reports are combined into a single report.
+ *
+ * If the driver is invoked under the name of one of the programs,
+ * for example, through a symbolic link named ‘csrspmv’, then it
+ * behaves exactly like that program.
+ */
+
+#include "spmv.h"
+
+#include <errno.h>
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char * program_name = "spmv";
+const char * program_version = "1.8";
+const char * program_copyright =
+    "Copyright (C) 2023 James D. Trotter";
+const char * program_license =
+    "License GPLv3+: GNU GPL version 3 or later <https://gnu.org/licenses/gpl.html>\n"
+    "This is free software: you are free to change and redistribute it.\n"
+    "There is NO WARRANTY, to the extent permitted by law.";
+const char * program_invocation_name;
+const char * program_invocation_short_name;
+
+/*
+ * format registry
+ */
+
+/**
+ * ‘spmv_format’ describes a matrix storage format and the program
+ * that implements its conversion, kernels and byte-count model. The
+ * program is run with ‘--format=NAME’ to select the format, either
+ * as a whole, through ‘main’, or one phase at a time, through the
+ * other functions, which are declared in ‘spmv.h’.
+ */
+struct spmv_format
+{
+    const char * name;
+    const char * program;
+    int (* main)(int, char *[]);
+    int (* read)(int, char *[], struct spmv_problem *);
+    int (* convert)(int, char *[], const struct spmv_problem *, void **);
+    int (* spmv)(void *, const struct spmv_problem *, int, int);
+    void (* free)(void *);
+    const char * description;
+};
+
+#define CSRSPMV "csrspmv", csrspmv_main, csrspmv_read, csrspmv_convert, csrspmv_spmv, csrspmv_free
+#define ELLSPMV "ellspmv", ellspmv_main, ellspmv_read, ellspmv_convert, ellspmv_spmv, ellspmv_free
+
+static const struct spmv_format spmv_formats[] = {
+    {"csr", CSRSPMV, "compressed sparse row"},
+    {"bcsr", CSRSPMV, "register-blocked compressed sparse row"},
+    {"ell", ELLSPMV, "ELLPACK"},
+    {"sell", ELLSPMV, "sliced ELLPACK (SELL-C-sigma)"},
+    {"hyb", ELLSPMV, "hybrid ELLPACK and coordinate"},
+};
+
+#undef ELLSPMV
+#undef CSRSPMV
+
+static const int num_spmv_formats =
+    sizeof(spmv_formats) / sizeof(*spmv_formats);
+
+/**
+ * ‘spmv_format_find()’ finds the format whose name is given by the
+ * first ‘len’ characters of ‘name’, or returns ‘NULL’ if there is no
+ * such format.
+ */
+static const struct spmv_format * spmv_format_find(
+    const char * name,
+    size_t len)
+{
+    for (int i = 0; i < num_spmv_formats; i++) {
+        if (strlen(spmv_formats[i].name) == len &&
+            strncmp(spmv_formats[i].name, name, len) == 0)
+            return &spmv_formats[i];
+    }
+    return NULL;
+}
+
+/*
+ * program options
+ */
+
+/**
+ * ‘program_options_print_usage()’ prints a short usage text.
+ */
+static void program_options_print_usage(
+    FILE * f)
+{
+    fprintf(f, "Usage: %s [--format=FORMAT[,FORMAT..]] [OPTION..] A [x] [y]\n", program_name);
+}
+
+/**
+ * ‘program_options_print_help()’ prints a help text.
+ */
+static void program_options_print_help(
+    FILE * f)
+{
+    program_options_print_usage(f);
+    fprintf(f, "\n");
+    fprintf(f, " Multiply a matrix with a vector in several matrix storage formats.\n");
+    fprintf(f, "\n");
+    fprintf(f, " The matrix and vectors are read only once, and each format is then\n");
+    fprintf(f, " converted and benchmarked in turn. The reports are combined into a\n");
+    fprintf(f, " single JSON array or CSV table, and the result is written once.\n");
+    fprintf(f, " All other options and arguments are passed on to the program that\n");
+    fprintf(f, " implements each format, and must therefore be understood by every\n");
+    fprintf(f, " one of these programs. The options --autotune, --tuning-file,\n");
+    fprintf(f, " --load-binary, --save-binary and --mpi require a single format.\n");
+    fprintf(f, "\n");
+    fprintf(f, " Options are:\n");
+    fprintf(f, "  --format=FORMAT[,FORMAT..]  comma-separated list of formats. [csr,ell]\n");
+    fprintf(f, "  -h, --help                  display this help and exit\n");
+    fprintf(f, "  --version                   display version information and exit\n");
+    fprintf(f, "\n");
+    fprintf(f, " Formats are:\n");
+    for (int i = 0; i < num_spmv_formats; i++) {
+        fprintf(f, "  %-6s %-9s %s\n", spmv_formats[i].name,
+                spmv_formats[i].program, spmv_formats[i].description);
+    }
+    fprintf(f, "\n");
+    fprintf(f, " Run ‘csrspmv --help’ or ‘ellspmv --help’ for other options.\n");
+    fprintf(f, "\n");
+    fprintf(f, "Report bugs to: <james@simula.no>\n");
+}
+
+/**
+ * ‘program_options_print_version()’ prints version information.
+ */
+static void program_options_print_version(
+    FILE * f)
+{
+    fprintf(f, "%s %s\n", program_name, program_version);
+    fprintf(f, "formats:");
+    for (int i = 0; i < num_spmv_formats; i++)
+        fprintf(f, " %s", spmv_formats[i].name);
+    fprintf(f, "\n");
+    fprintf(f, "\n");
+    fprintf(f, "%s\n", program_copyright);
+    fprintf(f, "%s\n", program_license);
+}
+
+int main(int argc, char *argv[])
+{
+    int err;
+
+    /* Set program invocation name. */
+    program_invocation_name = argv[0];
+    program_invocation_short_name = (
+        strrchr(program_invocation_name, '/')
+        ? strrchr(program_invocation_name, '/') + 1
+        : program_invocation_name);
+
+    /*
+     * If the driver is invoked under the name of one of the programs,
+     * then run that program. This is also how the programs re-run
+     * themselves with ‘--autotune’.
+     */
+    for (int i = 0; i < num_spmv_formats; i++) {
+        if (strcmp(program_invocation_short_name, spmv_formats[i].program) == 0)
+            return spmv_formats[i].main(argc, argv);
+    }
+
+    /*
+     * Parse the list of formats, and collect the remaining arguments,
+     * which are passed on to each program, after the program name and
+     * the ‘--format’ option.
+     */
+    const char * formats = "csr,ell";
+    char ** childargv = malloc((argc+2) * sizeof(char *));
+    if (!childargv) {
+        fprintf(stderr, "%s: %s\n", program_invocation_short_name, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    int childargc = 2;
+    bool options = true;
+    for (int i = 1; i < argc; i++) {
+        if (options && strcmp(argv[i], "--") == 0) {
+            options = false;
+        } else if (options && strstr(argv[i], "--format") == argv[i]) {
+            int n = strlen("--format");
+            const char * s = &argv[i][n];
+            if (*s == '=') { s++; }
+            else if (*s == '\0' && i+1 < argc) { s = argv[++i]; }
+            else {
+                fprintf(stderr, "%s: %s %s\n", program_invocation_short_name,
+                        strerror(EINVAL), argv[i]);
+                free(childargv);
+                return EXIT_FAILURE;
+            }
+            formats = s;
+            continue;
+        } else if (options && (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0)) {
+            free(childargv);
+            program_options_print_help(stdout);
+            return EXIT_SUCCESS;
+        } else if (options && strcmp(argv[i], "--version") == 0) {
+            free(childargv);
+            program_options_print_version(stdout);
+            return EXIT_SUCCESS;
+        }
+        childargv[childargc++] = argv[i];
+    }
+    childargv[childargc] = NULL;
+
+    /* Check the formats before running any of the programs. */
+    int num_formats = 0;
+    for (const char * s = formats; ; s++) {
+        size_t len = strcspn(s, ",");
+        if (!spmv_format_find(s, len)) {
+            fprintf(stderr, "%s: %s --format=%s\n", program_invocation_short_name,
+                    strerror(EINVAL), formats);
+            free(childargv);
+            return EXIT_FAILURE;
+        }
+        num_formats++;
+        s += len;
+        if (*s == '\0') break;
+    }
+
+    /*
+     * A single format is benchmarked by its program as a whole, which
+     * supports every option of the program.
+     */
+    char formatarg[64];
+    childargv[1] = formatarg;
+    if (num_formats == 1) {
+        const struct spmv_format * format = spmv_format_find(formats, strlen(formats));
+        snprintf(formatarg, sizeof(formatarg), "--format=%s", format->name);
+        childargv[0] = (char *) format->program;
+        err = format->main(childargc, childargv);
+        free(childargv);
+        return err;
+    }
+
+    /*
+     * Otherwise, the program of the first format reads the matrix and
+     * vectors. Then each format is converted from the same matrix and
+     * benchmarked in turn, and the matrix in coordinate format is freed
+     * as soon as the last format has been converted.
+     */
+    int status = EXIT_FAILURE;
+    struct spmv_problem A = {0};
+    const struct spmv_format * format = spmv_format_find(formats, strcspn(formats, ","));
+    snprintf(formatarg, sizeof(formatarg), "--format=%s", format->name);
+    childargv[0] = (char *) format->program;
+    err = format->read(childargc, childargv, &A);
+    if (err != EXIT_SUCCESS) goto cleanup;
+    const char * s = formats;
+    for (int i = 0; i < num_formats; i++, s++) {
+        size_t len = strcspn(s, ",");
+        format = spmv_format_find(s, len);
+        s += len;
+        snprintf(formatarg, sizeof(formatarg), "--format=%s", format->name);
+        childargv[0] = (char *) format->program;
+        void * state = NULL;
+        err = format->convert(childargc, childargv, &A, &state);
+        if (err != EXIT_SUCCESS) goto cleanup;
+        if (i == num_formats-1) spmv_problem_free_matrix(&A);
+        err = format->spmv(state, &A, i, num_formats);
+        format->free(state);
+        if (err != EXIT_SUCCESS) goto cleanup;
+    }
+    status = EXIT_SUCCESS;
+
+cleanup:
+    spmv_problem_free(&A);
+    free(childargv);
+    return status;
+}
@@ -0,0 +1,131 @@
+/*
+ * Benchmark programs for sparse matrix-vector multiply
+ *
+ * Copyright (C) 2023 James D. Trotter
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ *
+ * Interface between the ‘spmv’ driver and the benchmark programs
+ * ‘csrspmv’ and ‘ellspmv’, which are linked into the driver when
+ * they are compiled with SPMV_DRIVER defined. The programs also use
+ * ‘spmv_problem’ between the phases of a benchmark when they are run
+ * on their own.
+ */
+
+#ifndef SPMV_H
+#define SPMV_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * ‘spmv_problem’ is a sparse matrix in coordinate format, together
+ * with the source and destination vectors, as they were read from
+ * Matrix Market files, or generated, by the first of the formats that
+ * are benchmarked by the driver. Every format is then converted from
+ * the same matrix and multiplied with the same vectors.
+ *
+ * The row and column offsets are stored as integers of ‘idxsize’
+ * bytes, and ‘symmetry’ is a value of the enum ‘mtxsymmetry’, which
+ * is the same in both programs. If the rows and columns were
+ * reordered, then ‘rowperm’ is the permutation, which has already
+ * been applied to the matrix and the vectors.
+ *
+ * The vectors consist of ‘num_vectors’ columns of values that are
+ * ‘vecsize’ bytes each, stored in row-major order. They are ‘NULL’
+ * unless they were read from a file, and otherwise the source vector
+ * consists of ones, and the destination vector of zeros.
+ */
+struct spmv_problem
+{
+    int symmetry;
+    int64_t num_rows;
+    int64_t num_columns;
+    int64_t num_nonzeros;
+    size_t idxsize;
+    void * rowidx;
+    void * colidx;
+    double * a;
+    void * rowperm;
+    int num_vectors;
+    size_t vecsize;
+    void * x;
+    void * y;
+};
+
+/**
+ * ‘spmv_problem_free_matrix()’ frees the matrix in coordinate format,
+ * which is no longer needed once it has been converted.
+ */
+static inline void spmv_problem_free_matrix(
+    struct spmv_problem * A)
+{
+    free(A->a); A->a = NULL;
+    free(A->colidx); A->colidx = NULL;
+    free(A->rowidx); A->rowidx = NULL;
+}
+
+/**
+ * ‘spmv_problem_free()’ frees the matrix, the permutation and the
+ * vectors.
+ */
+static inline void spmv_problem_free(
+    struct spmv_problem * A)
+{
+    spmv_problem_free_matrix(A);
+    free(A->y); A->y = NULL;
+    free(A->x); A->x = NULL;
+    free(A->rowperm); A->rowperm = NULL;
+}
+
+/*
+ * Entry points of the benchmark programs.
+ *
+ * Besides ‘main()’, each program has a function for every phase of a
+ * benchmark, which the driver uses to benchmark several formats with
+ * the same matrix and vectors. Every one of them parses the program
+ * options in ‘argv’, prints an error message if something goes wrong,
+ * and returns ‘EXIT_SUCCESS’ or ‘EXIT_FAILURE’.
+ *
+ * ‘*_read()’ reads, or generates, the matrix and vectors.
+ *
+ * ‘*_convert()’ allocates the state of a benchmark, which is stored
+ * in ‘state’, and converts the matrix to the format that is selected
+ * with ‘--format’. The matrix in coordinate format may be freed
+ * afterwards, but not the permutation or the vectors.
+ *
+ * ‘*_spmv()’ performs the multiplications and writes a benchmark
+ * report, which is report number ‘report_index’ out of ‘num_reports’
+ * reports that are combined into one, that is, a JSON array or a
+ * single CSV table. The result vector is only written for the first
+ * report.
+ *
+ * ‘*_free()’ frees the state of a benchmark.
+ */
+
+int csrspmv_main(int argc, char * argv[]);
+int csrspmv_read(int argc, char * argv[], struct spmv_problem * A);
+int csrspmv_convert(int argc, char * argv[], const struct spmv_problem * A, void ** state);
+int csrspmv_spmv(void * state, const struct spmv_problem * A, int report_index, int num_reports);
+void csrspmv_free(void * state);
+
+int ellspmv_main(int argc, char * argv[]);
+int ellspmv_read(int argc, char * argv[], struct spmv_problem * A);
+int ellspmv_convert(int argc, char * argv[], const struct spmv_problem * A, void ** state);
+int ellspmv_spmv(void * state, const struct spmv_problem * A, int report_index, int num_reports);
+void ellspmv_free(void * state);
+
+#endif